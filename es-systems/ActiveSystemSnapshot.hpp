@@ -0,0 +1,52 @@
+#ifndef IAUNS_ES_SYSTEMS_ACTIVESYSTEMSNAPSHOT_HPP
+#define IAUNS_ES_SYSTEMS_ACTIVESYSTEMSNAPSHOT_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <entity-system/ESCoreBase.hpp>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Immutable copy of the active system list, published by SystemCore
+/// whenever the list or a schedule changes. See
+/// BasicSystemCore::getActiveSystems.
+struct ActiveSystemSnapshot
+{
+  struct Entry
+  {
+    std::string                             name;
+    /// The system itself. Other threads may hold on to it, but must not
+    /// call walkComponents. nullptr for a lazily instantiated system that
+    /// had not been constructed when the copy was published.
+    std::shared_ptr<CPM_ES_NS::BaseSystem>  system;
+    std::chrono::nanoseconds                interval;
+    /// Reference time of the next execution, as of publication.
+    std::chrono::nanoseconds                nextExecution;
+  };
+
+  ActiveSystemSnapshot() : generation(0) {}
+
+  /// The entry of system \p name, or nullptr if it is not active.
+  const Entry* find(const std::string& name) const
+  {
+    auto it = std::lower_bound(systems.begin(), systems.end(), name,
+                               [](const Entry& e, const std::string& n)
+                               {
+                                 return e.name < n;
+                               });
+    return (it != systems.end() && it->name == name) ? &*it : nullptr;
+  }
+
+  bool isActive(const std::string& name) const {return find(name) != nullptr;}
+
+  uint64_t            generation;   ///< Incremented on every publication.
+  std::vector<Entry>  systems;      ///< Sorted by name.
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef IAUNS_ES_SYSTEMS_ALLOCATIONCOUNTER_HPP
+#define IAUNS_ES_SYSTEMS_ALLOCATIONCOUNTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Per thread count of heap allocations. Nothing is counted unless an
+/// allocation hook reports to it: either CountingAllocator, which only sees
+/// the allocations of the containers it is used in, or the global operator
+/// new replacement in GlobalAllocationHook.hpp, which sees all of them.
+namespace allocation_counter {
+
+inline uint64_t& threadCount()
+{
+  static thread_local uint64_t count = 0;
+  return count;
+}
+
+/// Reports one allocation on the calling thread.
+inline void record() {++threadCount();}
+
+/// Number of allocations reported on the calling thread so far.
+inline uint64_t current() {return threadCount();}
+
+} // namespace allocation_counter
+
+/// std::allocator that reports every allocation to allocation_counter.
+/// Suitable as the AllocatorPolicy of BasicSystemCore.
+template <typename T>
+class CountingAllocator : public std::allocator<T>
+{
+public:
+  template <typename U>
+  struct rebind {typedef CountingAllocator<U> other;};
+
+  CountingAllocator() {}
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>&) {}
+
+  T* allocate(size_t n, const void* hint = 0)
+  {
+    allocation_counter::record();
+    (void)hint;
+    return std::allocator<T>::allocate(n);
+  }
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
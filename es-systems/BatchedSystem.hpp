@@ -0,0 +1,222 @@
+#ifndef IAUNS_ES_SYSTEMS_BATCHEDSYSTEM_HPP
+#define IAUNS_ES_SYSTEMS_BATCHEDSYSTEM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <entity-system/ESCoreBase.hpp>
+#include <entity-system/ComponentContainer.hpp>
+#include <entity-system/TemplateID.hpp>
+
+#include "EntityCountingSystem.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Values of one component type inside a component container, stride bytes
+/// apart. Indexing reads the container's storage in place.
+template <typename T>
+class BatchColumn
+{
+public:
+  BatchColumn(const T* first, size_t stride) :
+      mFirst(reinterpret_cast<const char*>(first)),
+      mStride(stride)
+  {}
+
+  const T& operator[](size_t i) const
+  {
+    return *reinterpret_cast<const T*>(mFirst + i * mStride);
+  }
+
+  /// Address of the first value.
+  const T* data() const {return reinterpret_cast<const T*>(mFirst);}
+
+  /// Distance between consecutive values, in bytes.
+  size_t stride() const {return mStride;}
+
+private:
+  const char* mFirst;
+  size_t      mStride;
+};
+
+namespace batch_detail {
+
+template <size_t... Is> struct IndexList {};
+
+template <size_t N, size_t... Is>
+struct MakeIndexList : MakeIndexList<N - 1, N - 1, Is...> {};
+
+template <size_t... Is>
+struct MakeIndexList<0, Is...> { typedef IndexList<Is...> type; };
+
+/// Sorted component array of one type, as the core stores it: size items,
+/// each holding an entity's sequence and its component, itemSize bytes
+/// apart.
+struct ItemArray
+{
+  ItemArray() : items(nullptr), size(0), itemSize(0), sequenceOffset(0) {}
+
+  uint64_t sequence(size_t i) const
+  {
+    return *reinterpret_cast<const uint64_t*>(items + i * itemSize + sequenceOffset);
+  }
+
+  const char* items;
+  size_t      size;
+  size_t      itemSize;
+  size_t      sequenceOffset;
+};
+
+template <typename T>
+ItemArray itemArrayOf(CPM_ES_NS::ESCoreBase& core)
+{
+  typedef typename CPM_ES_NS::ComponentContainer<T>::ComponentItem Item;
+
+  ItemArray array;
+  CPM_ES_NS::ComponentContainer<T>* container = dynamic_cast<CPM_ES_NS::ComponentContainer<T>*>(
+      core.getComponentContainer(CPM_ES_NS::TemplateID<T>::getID()));
+  if (container != nullptr && container->getNumComponents() > 0)
+  {
+    const Item* items = container->getComponentArray();
+    array.items = reinterpret_cast<const char*>(items);
+    array.size = static_cast<size_t>(container->getNumComponents());
+    array.itemSize = sizeof(Item);
+    array.sequenceOffset = reinterpret_cast<const char*>(&items->sequence) - array.items;
+  }
+  return array;
+}
+
+template <typename T>
+BatchColumn<T> columnOf(const ItemArray& array, size_t i)
+{
+  typedef typename CPM_ES_NS::ComponentContainer<T>::ComponentItem Item;
+  const Item* item = reinterpret_cast<const Item*>(array.items + i * array.itemSize);
+  return BatchColumn<T>(&item->component, sizeof(Item));
+}
+
+inline BatchColumn<uint64_t> sequencesOf(const ItemArray& array, size_t i)
+{
+  return BatchColumn<uint64_t>(reinterpret_cast<const uint64_t*>(
+      array.items + i * array.itemSize + array.sequenceOffset), array.itemSize);
+}
+
+} // namespace batch_detail
+
+/// System that processes its entities in batches instead of one at a time.
+/// walkComponents joins the component arrays of Ts... directly and hands
+/// executeBatch runs of up to batchSize entities whose components sit at
+/// consecutive positions in every array, so there is no call per entity and
+/// nothing is copied. Kernels written as plain loops over the columns can be
+/// unrolled and vectorized by the compiler.
+///
+/// Derive from BatchedSystem<Ts...> instead of GenericSystem<false, Ts...>
+/// and implement executeBatch. Columns point into the core's storage and
+/// are read only; write results back through the core. An entity holding
+/// several components of one type is batched with the first of them when
+/// more than one type is joined.
+template <typename... Ts>
+class BatchedSystem : public CPM_ES_NS::BaseSystem,
+                      public EntityCountingSystem
+{
+public:
+
+  static const size_t DefaultBatchSize = 256;
+
+  explicit BatchedSystem(size_t batchSize = DefaultBatchSize) :
+      mBatchSize(batchSize == 0 ? 1 : batchSize),
+      mWalked(0)
+  {}
+
+  /// Process \p count entities. \p entityIDs[i] owns the i'th element of
+  /// every component column.
+  virtual void executeBatch(CPM_ES_NS::ESCoreBase& core, size_t count,
+                            BatchColumn<uint64_t> entityIDs,
+                            BatchColumn<Ts>... components) = 0;
+
+  void walkComponents(CPM_ES_NS::ESCoreBase& core) override
+  {
+    mWalked = 0;
+    walk(core, typename batch_detail::MakeIndexList<sizeof...(Ts)>::type());
+  }
+
+  size_t getBatchSize() const {return mBatchSize;}
+
+  uint64_t getWalkedEntityCount() const override {return mWalked;}
+
+private:
+
+  static const size_t NumTypes = sizeof...(Ts);
+
+  template <size_t... Is>
+  void walk(CPM_ES_NS::ESCoreBase& core, batch_detail::IndexList<Is...>)
+  {
+    batch_detail::ItemArray arrays[NumTypes] = {batch_detail::itemArrayOf<Ts>(core)...};
+    size_t cursor[NumTypes] = {};
+    for (size_t k = 0; k < NumTypes; ++k)
+    {
+      if (arrays[k].size == 0)
+        return;
+    }
+
+    for (;;)
+    {
+      // Step every array up to the highest entity any of them is at, until
+      // they agree.
+      uint64_t target = 0;
+      for (size_t k = 0; k < NumTypes; ++k)
+      {
+        uint64_t seq = arrays[k].sequence(cursor[k]);
+        if (seq > target)
+          target = seq;
+      }
+      bool aligned = true;
+      for (size_t k = 0; k < NumTypes; ++k)
+      {
+        while (arrays[k].sequence(cursor[k]) < target)
+        {
+          if (++cursor[k] == arrays[k].size)
+            return;
+        }
+        aligned = aligned && arrays[k].sequence(cursor[k]) == target;
+      }
+      if (!aligned)
+        continue;
+
+      // Extend the run while every array holds the same entity next.
+      size_t run = 1;
+      for (bool extends = true; extends; )
+      {
+        for (size_t k = 0; k < NumTypes && extends; ++k)
+          extends = cursor[k] + run < arrays[k].size;
+        for (size_t k = 1; k < NumTypes && extends; ++k)
+          extends = arrays[k].sequence(cursor[k] + run) == arrays[0].sequence(cursor[0] + run);
+        if (extends)
+          ++run;
+      }
+
+      for (size_t offset = 0; offset < run; offset += mBatchSize)
+      {
+        size_t count = run - offset < mBatchSize ? run - offset : mBatchSize;
+        executeBatch(core, count, batch_detail::sequencesOf(arrays[0], cursor[0] + offset),
+                     batch_detail::columnOf<Ts>(arrays[Is], cursor[Is] + offset)...);
+        mWalked += count;
+      }
+
+      for (size_t k = 0; k < NumTypes; ++k)
+      {
+        cursor[k] += run;
+        if (cursor[k] == arrays[k].size)
+          return;
+      }
+    }
+  }
+
+  size_t                          mBatchSize;
+  uint64_t                        mWalked;    ///< Entities in the current walk.
+};
+
+template <typename... Ts>
+const size_t BatchedSystem<Ts...>::DefaultBatchSize;
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
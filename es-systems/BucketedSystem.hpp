@@ -0,0 +1,29 @@
+#ifndef IAUNS_ES_SYSTEMS_BUCKETEDSYSTEM_HPP
+#define IAUNS_ES_SYSTEMS_BUCKETEDSYSTEM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <entity-system/ESCoreBase.hpp>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Optional interface for systems that update their entities at different
+/// rates. Derive from this alongside GenericSystem. When the system has
+/// entity buckets, see SystemCore::addEntityBucket, the scheduler hands it
+/// the entities of the buckets that are due instead of calling
+/// walkComponents, so its cost follows the update rate rather than the
+/// entity count.
+class BucketedSystem
+{
+public:
+  virtual ~BucketedSystem() {}
+
+  /// Update the \p count entities in \p entityIDs, for example by looking
+  /// up each entity's components.
+  virtual void walkEntities(CPM_ES_NS::ESCoreBase& core, const uint64_t* entityIDs,
+                            size_t count) = 0;
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef IAUNS_ES_SYSTEMS_COMPONENTSIGNATURE_HPP
+#define IAUNS_ES_SYSTEMS_COMPONENTSIGNATURE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include <entity-system/GenericSystem.hpp>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+template <typename... Ts> class BatchedSystem;
+
+namespace signature_detail {
+
+inline uint64_t nextComponentTypeID()
+{
+  static uint64_t counter = 0;
+  return ++counter;
+}
+
+template <typename T>
+struct ComponentTypeID
+{
+  static uint64_t id()
+  {
+    static const uint64_t typeID = nextComponentTypeID();
+    return typeID;
+  }
+};
+
+template <bool GroupComponents, typename... Ts>
+std::vector<uint64_t> signatureOf(const CPM_ES_NS::GenericSystem<GroupComponents, Ts...>*)
+{
+  std::vector<uint64_t> sig = {ComponentTypeID<typename std::remove_cv<Ts>::type>::id()...};
+  std::sort(sig.begin(), sig.end());
+  return sig;
+}
+
+template <typename... Ts>
+std::vector<uint64_t> signatureOf(const BatchedSystem<Ts...>*)
+{
+  std::vector<uint64_t> sig = {ComponentTypeID<typename std::remove_cv<Ts>::type>::id()...};
+  std::sort(sig.begin(), sig.end());
+  return sig;
+}
+
+/// Systems that derive from neither GenericSystem nor BatchedSystem have no
+/// known signature.
+inline std::vector<uint64_t> signatureOf(const void*)
+{
+  return std::vector<uint64_t>();
+}
+
+} // namespace signature_detail
+
+/// Returns the sorted list of component type IDs that system \p T walks.
+/// The IDs are only meaningful within a single process.
+template <typename T>
+std::vector<uint64_t> getComponentSignature()
+{
+  return signature_detail::signatureOf(static_cast<const T*>(nullptr));
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
@@ -0,0 +1,66 @@
+#include "CostProfile.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+namespace {
+
+void fail(const std::string& message, const std::string& path)
+{
+  std::cerr << "cpm-es-system: " << message << ": " << path << std::endl;
+  throw std::runtime_error("cpm-es-system: " + message + ".");
+}
+
+} // namespace
+
+void CostProfile::load(const std::string& path)
+{
+  std::ifstream in(path.c_str());
+  if (!in)
+    fail("Unable to read cost profile", path);
+
+  // Names may hold spaces, so the cost follows the last one.
+  std::string line;
+  while (std::getline(in, line))
+  {
+    if (line.empty())
+      continue;
+    size_t split = line.rfind(' ');
+    if (split == std::string::npos || split == 0 || split + 1 == line.size())
+      fail("Malformed cost profile", path);
+
+    const char* number = line.c_str() + split + 1;
+    char* end = nullptr;
+    unsigned long long cost = std::strtoull(number, &end, 10);
+    if (*end != '\0' || *number == '-')
+      fail("Malformed cost profile", path);
+    costs[line.substr(0, split)] = static_cast<uint64_t>(cost);
+  }
+  if (in.bad())
+    fail("Unable to read cost profile", path);
+}
+
+void CostProfile::save(const std::string& path) const
+{
+  std::string partial = path + ".tmp";
+  {
+    std::ofstream out(partial.c_str(), std::ios::trunc);
+    for (const CostMap::value_type& entry : costs)
+      out << entry.first << ' ' << entry.second << '\n';
+    out.flush();
+    if (!out)
+      fail("Unable to write cost profile", partial);
+  }
+  if (std::rename(partial.c_str(), path.c_str()) != 0)
+  {
+    std::remove(partial.c_str());
+    fail("Unable to write cost profile", path);
+  }
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
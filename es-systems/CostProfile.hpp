@@ -0,0 +1,32 @@
+#ifndef IAUNS_ES_SYSTEMS_COSTPROFILE_HPP
+#define IAUNS_ES_SYSTEMS_COSTPROFILE_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Smoothed execution costs by system name, kept next to a world so that a
+/// restarted or migrated world schedules from measured costs on its first
+/// frame. Stored as text, one line of name and cost in nanoseconds per
+/// system.
+class CostProfile
+{
+public:
+  typedef std::map<std::string, uint64_t> CostMap;
+
+  /// Reads \p path, merging its costs into costs. Throws
+  /// std::runtime_error if the file cannot be read or is malformed.
+  void load(const std::string& path);
+
+  /// Writes costs to \p path, replacing it only once the new profile is
+  /// complete. Throws std::runtime_error if it cannot be written.
+  void save(const std::string& path) const;
+
+  CostMap costs;
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
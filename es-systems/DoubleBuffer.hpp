@@ -0,0 +1,111 @@
+#ifndef IAUNS_ES_SYSTEMS_DOUBLEBUFFER_HPP
+#define IAUNS_ES_SYSTEMS_DOUBLEBUFFER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ComponentSignature.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Type erased interface to a DoubleBufferedComponent, through which
+/// SystemCore swaps buffers at the frame boundary.
+class DoubleBufferBase
+{
+public:
+  virtual ~DoubleBufferBase() {}
+
+  /// Publishes all writes made since the previous swap.
+  virtual void swap() = 0;
+
+  /// Component type ID of the buffered type, see getComponentSignature.
+  virtual uint64_t componentTypeID() const = 0;
+};
+
+/// Double buffered copy of component type \p T. Systems read the front
+/// buffer, which holds the values published at the last frame boundary,
+/// and write into the back buffer. Writes become visible only after
+/// SystemCore swaps the buffers during renormalize, so readers and writers
+/// of the same frame never touch the same data and may run concurrently.
+///
+/// read may be called from any number of threads while at most one thread
+/// writes.
+template <typename T>
+class DoubleBufferedComponent : public DoubleBufferBase
+{
+public:
+
+  /// Value of \p entityID as of the last swap, or nullptr.
+  const T* read(uint64_t entityID) const
+  {
+    auto it = mFront.find(entityID);
+    return (it != mFront.end()) ? &it->second : nullptr;
+  }
+
+  /// Sets the value of \p entityID for the next frame. Later writes to the
+  /// same entity within a frame win.
+  void write(uint64_t entityID, const T& value)
+  {
+    mBack.push_back(std::make_pair(entityID, value));
+  }
+
+  /// Number of entities in the front buffer.
+  size_t size() const {return mFront.size();}
+
+  void swap() override
+  {
+    for (const std::pair<uint64_t, T>& w : mBack)
+      mFront[w.first] = w.second;
+    mBack.clear();
+  }
+
+  uint64_t componentTypeID() const override
+  {
+    return signature_detail::ComponentTypeID<T>::id();
+  }
+
+private:
+  std::unordered_map<uint64_t, T>     mFront;
+  std::vector<std::pair<uint64_t, T>> mBack;    ///< Writes since the last swap.
+};
+
+/// Optional interface declaring which component types a system writes.
+/// GenericSystem only hands out const component pointers, so a system that
+/// does not derive from ComponentWriter is treated as read only. Derive
+/// from WritesComponents instead of implementing this directly.
+class ComponentWriter
+{
+public:
+  virtual ~ComponentWriter() {}
+
+  /// Sorted component type IDs this system writes, through the core or
+  /// through a DoubleBufferedComponent.
+  virtual const std::vector<uint64_t>& writtenComponents() const = 0;
+};
+
+/// Declares that a system writes component types \p Ts.
+template <typename... Ts>
+class WritesComponents : public ComponentWriter
+{
+public:
+  const std::vector<uint64_t>& writtenComponents() const override
+  {
+    static const std::vector<uint64_t> written = sortedIDs();
+    return written;
+  }
+
+private:
+  static std::vector<uint64_t> sortedIDs()
+  {
+    std::vector<uint64_t> ids = {signature_detail::ComponentTypeID<Ts>::id()...};
+    std::sort(ids.begin(), ids.end());
+    return ids;
+  }
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
@@ -0,0 +1,120 @@
+#include "EntityBuckets.hpp"
+#include "ScheduleTable.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+EntityBuckets::EntityBuckets()
+{
+}
+
+uint32_t EntityBuckets::addBucket(uint64_t interval, uint64_t stagger)
+{
+  Bucket bucket;
+  bucket.interval = interval;
+  bucket.stagger = stagger;
+  bucket.nextExecutionTime = 0;
+  bucket.scheduled = false;
+  bucket.ran = false;
+  mBuckets.push_back(bucket);
+  return static_cast<uint32_t>(mBuckets.size() - 1);
+}
+
+void EntityBuckets::assign(uint64_t entityID, uint32_t bucket)
+{
+  if (bucket >= mBuckets.size())
+  {
+    std::cerr << "cpm-es-system: No entity bucket " << bucket << "." << std::endl;
+    throw std::runtime_error("cpm-es-system: No such entity bucket.");
+  }
+
+  auto it = mLocations.find(entityID);
+  if (it != mLocations.end())
+  {
+    if (it->second.bucket == bucket)
+      return;
+    remove(entityID);
+  }
+
+  std::vector<uint64_t>& entities = mBuckets[bucket].entities;
+  Location location;
+  location.bucket = bucket;
+  location.index = entities.size();
+  entities.push_back(entityID);
+  mLocations[entityID] = location;
+}
+
+bool EntityBuckets::remove(uint64_t entityID)
+{
+  auto it = mLocations.find(entityID);
+  if (it == mLocations.end())
+    return false;
+
+  // Fill the hole with the last entity of the bucket.
+  std::vector<uint64_t>& entities = mBuckets[it->second.bucket].entities;
+  size_t index = it->second.index;
+  if (index + 1 != entities.size())
+  {
+    entities[index] = entities.back();
+    mLocations[entities[index]].index = index;
+  }
+  entities.pop_back();
+  mLocations.erase(entityID);
+  return true;
+}
+
+int64_t EntityBuckets::bucketOf(uint64_t entityID) const
+{
+  auto it = mLocations.find(entityID);
+  return it == mLocations.end() ? -1 : static_cast<int64_t>(it->second.bucket);
+}
+
+void EntityBuckets::run(CPM_ES_NS::ESCoreBase& core, BucketedSystem& system,
+                        uint64_t referenceTime)
+{
+  for (Bucket& bucket : mBuckets)
+  {
+    if (bucket.interval > 0 && !bucket.scheduled)
+    {
+      bucket.nextExecutionTime = ScheduleTable::calcNextExecutionTime(
+          referenceTime, bucket.interval, bucket.stagger);
+      bucket.scheduled = true;
+    }
+
+    bucket.ran = referenceTime >= bucket.nextExecutionTime;
+    if (!bucket.ran)
+      continue;
+
+    if (bucket.interval > 0)
+    {
+      bucket.nextExecutionTime = ScheduleTable::calcNextExecutionTime(
+          referenceTime + 1, bucket.interval, bucket.stagger);
+    }
+    if (!bucket.entities.empty())
+      system.walkEntities(core, bucket.entities.data(), bucket.entities.size());
+  }
+
+  if (!mClassifier)
+    return;
+
+  // Collect the moves first and apply them after the pass, so an entity
+  // moved into a later bucket that ran is not classified twice.
+  mMoves.clear();
+  for (uint32_t b = 0; b < mBuckets.size(); ++b)
+  {
+    if (!mBuckets[b].ran)
+      continue;
+    for (uint64_t entityID : mBuckets[b].entities)
+    {
+      uint32_t target = mClassifier(core, entityID, b);
+      if (target != b && target < mBuckets.size())
+        mMoves.push_back(std::make_pair(entityID, target));
+    }
+  }
+  for (const std::pair<uint64_t, uint32_t>& move : mMoves)
+    assign(move.first, move.second);
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
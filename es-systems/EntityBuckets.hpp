@@ -0,0 +1,86 @@
+#ifndef IAUNS_ES_SYSTEMS_ENTITYBUCKETS_HPP
+#define IAUNS_ES_SYSTEMS_ENTITYBUCKETS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <entity-system/ESCoreBase.hpp>
+
+#include "BucketedSystem.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Level of detail buckets of one system. Every bucket holds a set of
+/// entities and runs on its own interval and stagger, in ticks. Moving an
+/// entity between buckets is constant time.
+class EntityBuckets
+{
+public:
+  /// Picks the bucket of \p entityID, currently in \p bucket, right after
+  /// the entity was updated. Return \p bucket to keep it. Read a component
+  /// of the entity to drive buckets from component data.
+  typedef std::function<uint32_t(CPM_ES_NS::ESCoreBase& core, uint64_t entityID,
+                                 uint32_t bucket)> Classifier;
+
+  EntityBuckets();
+
+  /// Adds a bucket and returns its index. It first runs at its first
+  /// stagger point once the system runs.
+  uint32_t addBucket(uint64_t interval, uint64_t stagger);
+
+  size_t numBuckets() const {return mBuckets.size();}
+
+  /// Puts \p entityID into \p bucket, adding it if it is in no bucket.
+  /// Throws if \p bucket does not exist.
+  void assign(uint64_t entityID, uint32_t bucket);
+
+  /// Takes \p entityID out of its bucket. Returns false if it had none.
+  bool remove(uint64_t entityID);
+
+  /// Bucket of \p entityID, or -1 if it is in none.
+  int64_t bucketOf(uint64_t entityID) const;
+
+  /// Entities of \p bucket, in no particular order.
+  const std::vector<uint64_t>& entities(uint32_t bucket) const
+  {
+    return mBuckets[bucket].entities;
+  }
+
+  /// Reclassifies the entities of every bucket after it ran. Pass an empty
+  /// classifier to only move entities through assign.
+  void setClassifier(Classifier classifier) {mClassifier = classifier;}
+
+  /// Hands the entities of every bucket due at \p referenceTime to
+  /// \p system, then reclassifies them. Every entity is classified once
+  /// per run, by the bucket it was in when the run started.
+  void run(CPM_ES_NS::ESCoreBase& core, BucketedSystem& system, uint64_t referenceTime);
+
+private:
+  struct Bucket
+  {
+    uint64_t              interval;
+    uint64_t              stagger;
+    uint64_t              nextExecutionTime;
+    bool                  scheduled;        ///< nextExecutionTime is set.
+    bool                  ran;              ///< Ran in the current run.
+    std::vector<uint64_t> entities;
+  };
+
+  struct Location
+  {
+    uint32_t  bucket;
+    size_t    index;
+  };
+
+  std::vector<Bucket>                     mBuckets;
+  std::unordered_map<uint64_t, Location>  mLocations;
+  Classifier                              mClassifier;
+  std::vector<std::pair<uint64_t, uint32_t> > mMoves; ///< Pending moves of run.
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
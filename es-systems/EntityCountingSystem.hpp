@@ -0,0 +1,23 @@
+#ifndef IAUNS_ES_SYSTEMS_ENTITYCOUNTINGSYSTEM_HPP
+#define IAUNS_ES_SYSTEMS_ENTITYCOUNTINGSYSTEM_HPP
+
+#include <cstdint>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Optional interface for systems that know how many entities they
+/// visited. Derive from this alongside GenericSystem. Hardware counter
+/// statistics use it to report events per entity. BatchedSystem implements
+/// it already.
+class EntityCountingSystem
+{
+public:
+  virtual ~EntityCountingSystem() {}
+
+  /// Number of entities visited by the most recent walkComponents.
+  virtual uint64_t getWalkedEntityCount() const = 0;
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
@@ -0,0 +1,92 @@
+#include "FramePool.hpp"
+
+#include <new>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+namespace {
+
+const size_t MinBlockShift = 6;
+
+} // namespace
+
+FramePool::FramePool()
+{
+}
+
+FramePool::~FramePool()
+{
+  for (void* chunk : mChunks)
+    ::operator delete(chunk);
+}
+
+size_t FramePool::classIndex(size_t size)
+{
+  size_t index = 0;
+  while ((static_cast<size_t>(1) << (index + MinBlockShift)) < size)
+    ++index;
+  return index;
+}
+
+size_t FramePool::blockSize(size_t size)
+{
+  return static_cast<size_t>(1) << (classIndex(size) + MinBlockShift);
+}
+
+void* FramePool::allocate(size_t size)
+{
+  size_t index = classIndex(size);
+  if (index >= mClasses.size() || mClasses[index].free == nullptr)
+  {
+    size_t blocks = index < mClasses.size() ? mClasses[index].blocks : 0;
+    grow(index, blocks > 0 ? blocks : 1);
+  }
+
+  SizeClass& sizeClass = mClasses[index];
+  FreeBlock* block = sizeClass.free;
+  sizeClass.free = block->next;
+  return block;
+}
+
+void FramePool::release(void* frame, size_t size)
+{
+  SizeClass& sizeClass = mClasses[classIndex(size)];
+  FreeBlock* block = static_cast<FreeBlock*>(frame);
+  block->next = sizeClass.free;
+  sizeClass.free = block;
+}
+
+void FramePool::reserve(size_t size, size_t count)
+{
+  size_t index = classIndex(size);
+  size_t blocks = index < mClasses.size() ? mClasses[index].blocks : 0;
+  if (count > blocks)
+    grow(index, count - blocks);
+}
+
+size_t FramePool::capacity(size_t size) const
+{
+  size_t index = classIndex(size);
+  return index < mClasses.size() ? mClasses[index].blocks : 0;
+}
+
+void FramePool::grow(size_t index, size_t count)
+{
+  if (index >= mClasses.size())
+    mClasses.resize(index + 1);
+
+  size_t bytes = static_cast<size_t>(1) << (index + MinBlockShift);
+  char* chunk = static_cast<char*>(::operator new(bytes * count));
+  mChunks.push_back(chunk);
+
+  SizeClass& sizeClass = mClasses[index];
+  for (size_t i = 0; i < count; ++i)
+  {
+    FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + i * bytes);
+    block->next = sizeClass.free;
+    sizeClass.free = block;
+  }
+  sizeClass.blocks += count;
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
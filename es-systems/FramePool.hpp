@@ -0,0 +1,62 @@
+#ifndef IAUNS_ES_SYSTEMS_FRAMEPOOL_HPP
+#define IAUNS_ES_SYSTEMS_FRAMEPOOL_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Pool of fixed size blocks holding the frames of resumable systems.
+/// Blocks come in power of two size classes of at least 64 bytes, are
+/// aligned for any fundamental type and are only returned to the heap when
+/// the pool is destroyed. Not thread safe.
+class FramePool
+{
+public:
+  FramePool();
+  ~FramePool();
+
+  /// Size of the blocks that hold frames of \p size bytes.
+  static size_t blockSize(size_t size);
+
+  /// A block for a frame of \p size bytes. Only touches the heap if every
+  /// block of its size class is in use.
+  void* allocate(size_t size);
+
+  /// Returns \p frame, allocated for \p size bytes, to the pool.
+  void release(void* frame, size_t size);
+
+  /// Grows the size class holding \p size byte frames to at least \p count
+  /// blocks.
+  void reserve(size_t size, size_t count);
+
+  /// Number of blocks in the size class holding \p size byte frames.
+  size_t capacity(size_t size) const;
+
+private:
+  FramePool(const FramePool&);
+  FramePool& operator=(const FramePool&);
+
+  struct FreeBlock
+  {
+    FreeBlock* next;
+  };
+
+  struct SizeClass
+  {
+    SizeClass() : free(nullptr), blocks(0) {}
+
+    FreeBlock*  free;
+    size_t      blocks;
+  };
+
+  static size_t classIndex(size_t size);
+  void grow(size_t index, size_t count);
+
+  std::vector<SizeClass>  mClasses;
+  std::vector<void*>      mChunks;
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
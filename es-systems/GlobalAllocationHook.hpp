@@ -0,0 +1,56 @@
+#ifndef IAUNS_ES_SYSTEMS_GLOBALALLOCATIONHOOK_HPP
+#define IAUNS_ES_SYSTEMS_GLOBALALLOCATIONHOOK_HPP
+
+// Replaces the global operator new and delete so that every heap
+// allocation is reported to allocation_counter. Include this header in
+// exactly one translation unit of an application (or test binary) that
+// wants BasicSystemCore's allocation tracking to see allocations made by
+// systems and by the standard library.
+
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.hpp"
+
+// The replacements below pair malloc with free, which GCC cannot see once
+// they are inlined into a new expression.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size)
+{
+  CPM_ES_SYSTEMS_NS::allocation_counter::record();
+  void* p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](std::size_t size)
+{
+  return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+  CPM_ES_SYSTEMS_NS::allocation_counter::record();
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+  return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept                          {std::free(p);}
+void operator delete[](void* p) noexcept                        {std::free(p);}
+void operator delete(void* p, const std::nothrow_t&) noexcept   {std::free(p);}
+void operator delete[](void* p, const std::nothrow_t&) noexcept {std::free(p);}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+#endif
@@ -0,0 +1,12 @@
+#include "HyperperiodSchedule.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+void HyperperiodSchedule::clear()
+{
+  mHyperperiod = 0;
+  mOffsets.clear();
+  mEntries.clear();
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
@@ -0,0 +1,170 @@
+#ifndef IAUNS_ES_SYSTEMS_HYPERPERIODSCHEDULE_HPP
+#define IAUNS_ES_SYSTEMS_HYPERPERIODSCHEDULE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ScheduleTable.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Precompiled schedule for a fully periodic set of systems. The
+/// hyperperiod is the least common multiple of all system intervals. For
+/// every tick offset within the hyperperiod we store the indices of the
+/// systems that are due at that offset, taking stagger into account. This
+/// turns the per-frame due check into a single table lookup.
+///
+/// The table is stored in compressed sparse row form: mOffsets[t] and
+/// mOffsets[t + 1] delimit the run of mEntries that are due at offset t.
+class HyperperiodSchedule
+{
+public:
+  HyperperiodSchedule() : mHyperperiod(0) {}
+
+  /// Attempts to build a schedule for \p table. Returns false, and leaves
+  /// the schedule invalid, if the hyperperiod is larger than
+  /// \p maxHyperperiod or the table would hold more than \p maxEntries
+  /// entries. \p table may be any scheduler exposing ScheduleTable's
+  /// size, interval and stagger accessors.
+  template <typename Table>
+  bool build(const Table& table, uint64_t maxHyperperiod, size_t maxEntries);
+
+  /// Invalidates the schedule.
+  void clear();
+
+  /// True if build succeeded and the schedule may be used.
+  bool valid() const {return mHyperperiod != 0;}
+
+  /// Length of the hyperperiod in ticks.
+  uint64_t hyperperiod() const {return mHyperperiod;}
+
+  /// Retrieves the indices of all systems that are due at \p referenceTime,
+  /// in ascending order.
+  void dueRange(uint64_t referenceTime, const uint32_t*& first,
+                const uint32_t*& last) const
+  {
+    uint64_t t = referenceTime % mHyperperiod;
+    first = mEntries.data() + mOffsets[t];
+    last  = mEntries.data() + mOffsets[t + 1];
+  }
+
+  /// Replaces \p due with the indices of all systems that are due at any
+  /// tick in (\p since, \p referenceTime], each once and in ascending
+  /// order. \p seen holds a zeroed flag per system and is left zeroed.
+  template <typename List, typename Flags>
+  void dueBetween(uint64_t since, uint64_t referenceTime, List& due, Flags& seen) const;
+
+private:
+
+  static uint64_t gcd(uint64_t a, uint64_t b)
+  {
+    while (b != 0)
+    {
+      uint64_t t = a % b;
+      a = b;
+      b = t;
+    }
+    return a;
+  }
+
+  /// First tick offset, relative to the start of the hyperperiod, at which a
+  /// system with the given interval and stagger is due.
+  static uint64_t firstOffset(uint64_t interval, uint64_t stagger)
+  {
+    return (interval - (stagger % interval)) % interval;
+  }
+
+  uint64_t              mHyperperiod; ///< LCM of all intervals. 0 if invalid.
+  std::vector<uint32_t> mOffsets;     ///< Start of each tick's run in mEntries.
+  std::vector<uint32_t> mEntries;     ///< System indices, grouped by tick.
+};
+
+template <typename Table>
+bool HyperperiodSchedule::build(const Table& table, uint64_t maxHyperperiod,
+                                size_t maxEntries)
+{
+  clear();
+
+  // Systems with an interval of 0 run every tick, so they do not
+  // contribute to the hyperperiod.
+  uint64_t hyperperiod = 1;
+  for (size_t i = 0; i < table.size(); ++i)
+  {
+    uint64_t interval = table.interval(i);
+    if (interval == 0)
+      continue;
+
+    uint64_t factor = interval / gcd(hyperperiod, interval);
+    if (hyperperiod > maxHyperperiod / factor)
+      return false;
+    hyperperiod *= factor;
+  }
+
+  // Count the entries for each tick so the table can be laid out in one
+  // allocation.
+  uint64_t numEntries = 0;
+  for (size_t i = 0; i < table.size(); ++i)
+  {
+    uint64_t interval = table.interval(i);
+    numEntries += (interval == 0) ? hyperperiod : hyperperiod / interval;
+  }
+  if (numEntries > maxEntries)
+    return false;
+
+  mOffsets.assign(hyperperiod + 1, 0);
+  for (size_t i = 0; i < table.size(); ++i)
+  {
+    uint64_t interval = table.interval(i);
+    uint64_t step = (interval == 0) ? 1 : interval;
+    uint64_t first = (interval == 0) ? 0 : firstOffset(interval, table.stagger(i));
+    for (uint64_t t = first; t < hyperperiod; t += step)
+      ++mOffsets[t + 1];
+  }
+  for (uint64_t t = 0; t < hyperperiod; ++t)
+    mOffsets[t + 1] += mOffsets[t];
+
+  // Systems are visited in index order, so every tick's run ends up sorted.
+  mEntries.resize(numEntries);
+  std::vector<uint32_t> cursor(mOffsets.begin(), mOffsets.end() - 1);
+  for (size_t i = 0; i < table.size(); ++i)
+  {
+    uint64_t interval = table.interval(i);
+    uint64_t step = (interval == 0) ? 1 : interval;
+    uint64_t first = (interval == 0) ? 0 : firstOffset(interval, table.stagger(i));
+    for (uint64_t t = first; t < hyperperiod; t += step)
+      mEntries[cursor[t]++] = static_cast<uint32_t>(i);
+  }
+
+  mHyperperiod = hyperperiod;
+  return true;
+}
+
+template <typename List, typename Flags>
+void HyperperiodSchedule::dueBetween(uint64_t since, uint64_t referenceTime,
+                                     List& due, Flags& seen) const
+{
+  due.clear();
+  for (uint64_t time = since + 1; time <= referenceTime; ++time)
+  {
+    const uint32_t* first;
+    const uint32_t* last;
+    dueRange(time, first, last);
+    for (; first != last; ++first)
+    {
+      if (!seen[*first])
+      {
+        seen[*first] = 1;
+        due.push_back(*first);
+      }
+    }
+  }
+  std::sort(due.begin(), due.end());
+  for (uint32_t i : due)
+    seen[i] = 0;
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
@@ -0,0 +1,188 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "MetricsExporter.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+namespace {
+
+/// How often the socket thread checks for shutdown.
+const int PollTimeoutMS = 100;
+
+/// How long a client gets to send its request before it is served the
+/// bare text.
+const int RequestTimeoutMS = 50;
+
+bool sendAll(int fd, const char* data, size_t size)
+{
+#ifdef MSG_NOSIGNAL
+  const int flags = MSG_NOSIGNAL;
+#else
+  const int flags = 0;
+#endif
+  while (size > 0)
+  {
+    ssize_t sent = send(fd, data, size, flags);
+    if (sent < 0 && errno == EINTR)
+      continue;
+    if (sent <= 0)
+      return false;
+    data += sent;
+    size -= static_cast<size_t>(sent);
+  }
+  return true;
+}
+
+} // anonymous namespace
+
+MetricsExporter::MetricsExporter(const SchedulerMetrics& metrics, const std::string& path,
+                                 Mode mode, std::chrono::milliseconds period) :
+    mMetrics(metrics),
+    mPath(path),
+    mMode(mode),
+    mPeriod(period),
+    mListenFd(-1),
+    mQuit(false)
+{
+  if (mMode == SERVE_SOCKET)
+  {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    if (path.size() >= sizeof(address.sun_path))
+    {
+      std::cerr << "cpm-es-system: Metrics socket path too long: " << path << std::endl;
+      throw std::runtime_error("cpm-es-system: Metrics socket path too long.");
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    unlink(path.c_str());
+    mListenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (mListenFd < 0
+        || bind(mListenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || listen(mListenFd, 8) != 0)
+    {
+      std::cerr << "cpm-es-system: Unable to listen on metrics socket " << path
+                << ": " << std::strerror(errno) << std::endl;
+      if (mListenFd >= 0)
+        close(mListenFd);
+      throw std::runtime_error("cpm-es-system: Unable to listen on metrics socket.");
+    }
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(mListenFd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+  }
+
+  mThread = std::thread(&MetricsExporter::run, this);
+}
+
+MetricsExporter::~MetricsExporter()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mQuit = true;
+  }
+  mCondition.notify_all();
+  mThread.join();
+
+  if (mMode == SERVE_SOCKET)
+  {
+    close(mListenFd);
+    unlink(mPath.c_str());
+  }
+  else
+  {
+    writeFile();
+  }
+}
+
+void MetricsExporter::run()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  while (!mQuit)
+  {
+    if (mMode == WRITE_FILE)
+    {
+      lock.unlock();
+      writeFile();
+      lock.lock();
+      mCondition.wait_for(lock, mPeriod, [this] {return mQuit;});
+      continue;
+    }
+
+    lock.unlock();
+    pollfd listener;
+    listener.fd = mListenFd;
+    listener.events = POLLIN;
+    listener.revents = 0;
+    if (poll(&listener, 1, PollTimeoutMS) > 0 && (listener.revents & POLLIN))
+    {
+      int client = accept(mListenFd, nullptr, nullptr);
+      if (client >= 0)
+      {
+        serveClient(client);
+        close(client);
+      }
+    }
+    lock.lock();
+  }
+}
+
+void MetricsExporter::serveClient(int fd)
+{
+  bool http = false;
+  pollfd request;
+  request.fd = fd;
+  request.events = POLLIN;
+  request.revents = 0;
+  if (poll(&request, 1, RequestTimeoutMS) > 0 && (request.revents & POLLIN))
+  {
+    char buffer[1024];
+    ssize_t bytes = recv(fd, buffer, sizeof(buffer), 0);
+    http = bytes >= 4 && std::memcmp(buffer, "GET ", 4) == 0;
+  }
+
+  std::string body = mMetrics.format();
+  if (http)
+  {
+    std::string head = "HTTP/1.0 200 OK\r\n"
+                       "Content-Type: text/plain; version=0.0.4\r\n"
+                       "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                       "Connection: close\r\n\r\n";
+    if (!sendAll(fd, head.data(), head.size()))
+      return;
+  }
+  sendAll(fd, body.data(), body.size());
+}
+
+void MetricsExporter::writeFile()
+{
+  std::string body = mMetrics.format();
+  std::string temp = mPath + ".tmp";
+
+  FILE* file = std::fopen(temp.c_str(), "w");
+  if (file == nullptr)
+  {
+    std::cerr << "cpm-es-system: Unable to write metrics file " << temp << std::endl;
+    return;
+  }
+  bool ok = std::fwrite(body.data(), 1, body.size(), file) == body.size();
+  ok = (std::fclose(file) == 0) && ok;
+  if (!ok || std::rename(temp.c_str(), mPath.c_str()) != 0)
+  {
+    std::cerr << "cpm-es-system: Unable to write metrics file " << mPath << std::endl;
+    std::remove(temp.c_str());
+  }
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
@@ -0,0 +1,69 @@
+#ifndef IAUNS_ES_SYSTEMS_METRICSEXPORTER_HPP
+#define IAUNS_ES_SYSTEMS_METRICSEXPORTER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "SchedulerMetrics.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Publishes SchedulerMetrics in the Prometheus text format from a thread
+/// of its own, so the simulation thread is never involved. Either serves
+/// the metrics on a Unix domain socket or rewrites a file periodically,
+/// for example for node_exporter's textfile collector. POSIX only.
+class MetricsExporter
+{
+public:
+  enum Mode
+  {
+    /// Listen on a Unix domain socket at the path. Clients that send an
+    /// HTTP GET receive an HTTP response, as with
+    /// curl --unix-socket <path> http://localhost/metrics. Clients that
+    /// send nothing receive the bare text.
+    SERVE_SOCKET,
+
+    /// Replace the file at the path every period. The file is written next
+    /// to it and renamed, so readers never see a partial file.
+    WRITE_FILE
+  };
+
+  /// Starts exporting \p metrics, which must outlive the exporter, to
+  /// \p path. An existing socket at \p path is replaced. Throws if the
+  /// socket cannot be created.
+  MetricsExporter(const SchedulerMetrics& metrics, const std::string& path, Mode mode,
+                  std::chrono::milliseconds period = std::chrono::milliseconds(1000));
+
+  /// Stops the thread. Removes the socket, or writes the file a last time.
+  ~MetricsExporter();
+
+private:
+  MetricsExporter(const MetricsExporter&);
+  MetricsExporter& operator=(const MetricsExporter&);
+
+  void run();
+
+  /// Answers one client connected on \p fd.
+  void serveClient(int fd);
+
+  /// Writes the metrics to mPath atomically.
+  void writeFile();
+
+  const SchedulerMetrics&   mMetrics;
+  const std::string         mPath;
+  const Mode                mMode;
+  const std::chrono::milliseconds mPeriod;
+  int                       mListenFd;
+
+  std::mutex                mMutex;
+  std::condition_variable   mCondition;
+  bool                      mQuit;
+  std::thread               mThread;
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
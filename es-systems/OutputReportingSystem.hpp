@@ -0,0 +1,21 @@
+#ifndef IAUNS_ES_SYSTEMS_OUTPUTREPORTINGSYSTEM_HPP
+#define IAUNS_ES_SYSTEMS_OUTPUTREPORTINGSYSTEM_HPP
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Optional interface for producers in output driven execution. Derive
+/// from this alongside GenericSystem. A producer that does not implement it
+/// counts as having produced output every time it runs.
+class OutputReportingSystem
+{
+public:
+  virtual ~OutputReportingSystem() {}
+
+  /// True if the most recent walkComponents produced anything that the
+  /// system's consumers need to see.
+  virtual bool producedOutput() const = 0;
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
@@ -0,0 +1,62 @@
+#include "OverlapWorker.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+OverlapWorker::OverlapWorker() :
+    mJob(nullptr),
+    mContext(nullptr),
+    mQuit(false)
+{
+  mThread = std::thread(&OverlapWorker::run, this);
+}
+
+OverlapWorker::~OverlapWorker()
+{
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait(lock, [this] {return mJob == nullptr;});
+    mQuit = true;
+  }
+  mCondition.notify_all();
+  mThread.join();
+}
+
+void OverlapWorker::submit(Job job, void* context)
+{
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait(lock, [this] {return mJob == nullptr;});
+    mJob = job;
+    mContext = context;
+  }
+  mCondition.notify_all();
+}
+
+void OverlapWorker::wait()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  mCondition.wait(lock, [this] {return mJob == nullptr;});
+}
+
+void OverlapWorker::run()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  for (;;)
+  {
+    mCondition.wait(lock, [this] {return mQuit || mJob != nullptr;});
+    if (mQuit)
+      return;
+
+    Job job = mJob;
+    void* context = mContext;
+
+    lock.unlock();
+    job(context);
+    lock.lock();
+
+    mJob = nullptr;
+    mCondition.notify_all();
+  }
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
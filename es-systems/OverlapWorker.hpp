@@ -0,0 +1,46 @@
+#ifndef IAUNS_ES_SYSTEMS_OVERLAPWORKER_HPP
+#define IAUNS_ES_SYSTEMS_OVERLAPWORKER_HPP
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Helper thread that runs one job at a time alongside the simulation
+/// thread. Used to execute read only systems while the systems that write
+/// run on the simulation thread.
+class OverlapWorker
+{
+public:
+  typedef void (*Job)(void* context);
+
+  OverlapWorker();
+
+  /// Waits for a running job to finish before stopping the thread.
+  ~OverlapWorker();
+
+  /// Runs \p job(\p context) on the helper thread. Waits for the previous
+  /// job to finish first.
+  void submit(Job job, void* context);
+
+  /// Waits until no job is pending or running.
+  void wait();
+
+private:
+  OverlapWorker(const OverlapWorker&);
+  OverlapWorker& operator=(const OverlapWorker&);
+
+  void run();
+
+  std::mutex                mMutex;
+  std::condition_variable   mCondition;
+  Job                       mJob;       ///< Pending or running job, or nullptr.
+  void*                     mContext;
+  bool                      mQuit;
+  std::thread               mThread;
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
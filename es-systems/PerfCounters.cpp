@@ -0,0 +1,109 @@
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "PerfCounters.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+#ifdef __linux__
+namespace {
+
+int openEvent(uint32_t type, uint64_t config, int groupFd)
+{
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = (groupFd == -1) ? 1 : 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+} // anonymous namespace
+#endif
+
+PerfCounterGroup::PerfCounterGroup() :
+    mNumOpen(0)
+{
+  for (int i = 0; i < NumEvents; ++i)
+  {
+    mFds[i] = -1;
+    mSlots[i] = -1;
+  }
+
+#ifdef __linux__
+  const uint64_t events[NumEvents] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+  };
+
+  mFds[0] = openEvent(PERF_TYPE_HARDWARE, events[0], -1);
+  if (mFds[0] < 0)
+  {
+    mFds[0] = -1;
+    return;
+  }
+  mSlots[0] = mNumOpen++;
+
+  // Followers the PMU lacks are left out instead of failing the group.
+  for (int i = 1; i < NumEvents; ++i)
+  {
+    mFds[i] = openEvent(PERF_TYPE_HARDWARE, events[i], mFds[0]);
+    if (mFds[i] < 0)
+      mFds[i] = -1;
+    else
+      mSlots[i] = mNumOpen++;
+  }
+
+  ioctl(mFds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(mFds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+PerfCounterGroup::~PerfCounterGroup()
+{
+#ifdef __linux__
+  for (int i = NumEvents - 1; i >= 0; --i)
+  {
+    if (mFds[i] >= 0)
+      close(mFds[i]);
+  }
+#endif
+}
+
+bool PerfCounterGroup::read(PerfCounterValues& values) const
+{
+#ifdef __linux__
+  if (!available())
+    return false;
+
+  // Group layout: number of events followed by one value per event.
+  uint64_t buffer[1 + NumEvents];
+  ssize_t bytes = ::read(mFds[0], buffer, sizeof(buffer));
+  if (bytes < static_cast<ssize_t>(sizeof(uint64_t) * (1 + mNumOpen)))
+    return false;
+
+  uint64_t* fields[NumEvents] = {
+    &values.cycles, &values.instructions, &values.cacheMisses, &values.branchMisses
+  };
+  for (int i = 0; i < NumEvents; ++i)
+    *fields[i] = (mSlots[i] >= 0) ? buffer[1 + mSlots[i]] : 0;
+  return true;
+#else
+  (void)values;
+  return false;
+#endif
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
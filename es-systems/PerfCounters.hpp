@@ -0,0 +1,107 @@
+#ifndef IAUNS_ES_SYSTEMS_PERFCOUNTERS_HPP
+#define IAUNS_ES_SYSTEMS_PERFCOUNTERS_HPP
+
+#include <cstdint>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Values of the hardware events read by PerfCounterGroup. Events the
+/// machine does not provide stay 0.
+struct PerfCounterValues
+{
+  PerfCounterValues() :
+      cycles(0),
+      instructions(0),
+      cacheMisses(0),
+      branchMisses(0)
+  {}
+
+  uint64_t cycles;
+  uint64_t instructions;
+  uint64_t cacheMisses;     ///< Last level cache misses.
+  uint64_t branchMisses;
+};
+
+/// Per system hardware counter totals, see
+/// BasicSystemCore::setHardwareCounters.
+struct SystemCounterStats
+{
+  SystemCounterStats() :
+      executions(0),
+      entities(0)
+  {}
+
+  /// Records one execution that produced the events in \p delta while
+  /// visiting \p numEntities entities.
+  void record(const PerfCounterValues& delta, uint64_t numEntities)
+  {
+    ++executions;
+    entities += numEntities;
+    totals.cycles += delta.cycles;
+    totals.instructions += delta.instructions;
+    totals.cacheMisses += delta.cacheMisses;
+    totals.branchMisses += delta.branchMisses;
+  }
+
+  /// Instructions per cycle, or 0 if no cycles were counted.
+  double ipc() const
+  {
+    return totals.cycles == 0 ? 0.0
+        : static_cast<double>(totals.instructions) / static_cast<double>(totals.cycles);
+  }
+
+  /// Cache misses per visited entity, or 0 if no entities were reported.
+  double cacheMissesPerEntity() const
+  {
+    return entities == 0 ? 0.0
+        : static_cast<double>(totals.cacheMisses) / static_cast<double>(entities);
+  }
+
+  /// Branch misses per visited entity, or 0 if no entities were reported.
+  double branchMissesPerEntity() const
+  {
+    return entities == 0 ? 0.0
+        : static_cast<double>(totals.branchMisses) / static_cast<double>(entities);
+  }
+
+  uint64_t          executions;   ///< Number of recorded executions.
+  uint64_t          entities;     ///< Entities visited, if the system reports them.
+  PerfCounterValues totals;       ///< Summed events of all executions.
+};
+
+/// A group of hardware counters for the calling thread, opened with
+/// perf_event_open and read with a single system call. Counts user space
+/// only, so it works with perf_event_paranoid up to 2. Linux only; on
+/// other systems, in containers without perf access, or on machines
+/// without a PMU the group is simply unavailable.
+class PerfCounterGroup
+{
+public:
+  PerfCounterGroup();
+  ~PerfCounterGroup();
+
+  /// True if at least the cycle counter is running.
+  bool available() const {return mFds[0] >= 0;}
+
+  /// Reads the current counts, which only ever increase. Returns false if
+  /// the group is unavailable or the read failed.
+  bool read(PerfCounterValues& values) const;
+
+private:
+  PerfCounterGroup(const PerfCounterGroup&);
+  PerfCounterGroup& operator=(const PerfCounterGroup&);
+
+  static const int NumEvents = 4;
+
+  /// One descriptor per event, in PerfCounterValues order. -1 if the event
+  /// could not be opened. mFds[0] leads the group.
+  int mFds[NumEvents];
+
+  /// Position of each event in the group's read buffer, or -1.
+  int mSlots[NumEvents];
+  int mNumOpen;
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
@@ -0,0 +1,64 @@
+#include "PrefetchWorker.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+PrefetchWorker::PrefetchWorker() :
+    mSystem(nullptr),
+    mCore(nullptr),
+    mBusy(false),
+    mQuit(false)
+{
+  mThread = std::thread(&PrefetchWorker::run, this);
+}
+
+PrefetchWorker::~PrefetchWorker()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mQuit = true;
+  }
+  mCondition.notify_all();
+  mThread.join();
+}
+
+void PrefetchWorker::request(PrefetchableSystem* system, CPM_ES_NS::ESCoreBase* core)
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSystem = system;
+    mCore = core;
+  }
+  mCondition.notify_all();
+}
+
+void PrefetchWorker::waitIdle()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  mSystem = nullptr;
+  mCondition.wait(lock, [this] {return !mBusy;});
+}
+
+void PrefetchWorker::run()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  for (;;)
+  {
+    mCondition.wait(lock, [this] {return mQuit || mSystem != nullptr;});
+    if (mQuit)
+      return;
+
+    PrefetchableSystem* system = mSystem;
+    CPM_ES_NS::ESCoreBase* core = mCore;
+    mSystem = nullptr;
+    mBusy = true;
+
+    lock.unlock();
+    system->prefetchComponents(*core);
+    lock.lock();
+
+    mBusy = false;
+    mCondition.notify_all();
+  }
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
@@ -0,0 +1,47 @@
+#ifndef IAUNS_ES_SYSTEMS_PREFETCHWORKER_HPP
+#define IAUNS_ES_SYSTEMS_PREFETCHWORKER_HPP
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "PrefetchableSystem.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Helper thread that runs PrefetchableSystem hooks off the simulation
+/// thread. It holds a single request slot: if the helper is still busy when
+/// a new request arrives, the newer request replaces the older one, since
+/// prefetching for a system that already started is of no use.
+class PrefetchWorker
+{
+public:
+  PrefetchWorker();
+  ~PrefetchWorker();
+
+  /// Asks the helper thread to call \p system's prefetch hook. Never waits
+  /// for the hook to run.
+  void request(PrefetchableSystem* system, CPM_ES_NS::ESCoreBase* core);
+
+  /// Drops any pending request and waits for a running hook to return.
+  /// Call before destroying a system the helper may still be touching.
+  void waitIdle();
+
+private:
+  PrefetchWorker(const PrefetchWorker&);
+  PrefetchWorker& operator=(const PrefetchWorker&);
+
+  void run();
+
+  std::mutex                mMutex;
+  std::condition_variable   mCondition;
+  PrefetchableSystem*       mSystem;    ///< Pending request, or nullptr.
+  CPM_ES_NS::ESCoreBase*    mCore;
+  bool                      mBusy;      ///< True while a hook is running.
+  bool                      mQuit;
+  std::thread               mThread;
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
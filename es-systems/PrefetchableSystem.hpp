@@ -0,0 +1,46 @@
+#ifndef IAUNS_ES_SYSTEMS_PREFETCHABLESYSTEM_HPP
+#define IAUNS_ES_SYSTEMS_PREFETCHABLESYSTEM_HPP
+
+#include <cstddef>
+#include <entity-system/ESCoreBase.hpp>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Optional interface for systems that know where their component data
+/// lives. Derive from this alongside GenericSystem. When prefetching is
+/// enabled on the SystemCore, prefetchComponents is called for the next due
+/// system while the current one is still walking its components, so the
+/// start of the next walk does not stall on cold memory.
+class PrefetchableSystem
+{
+public:
+  virtual ~PrefetchableSystem() {}
+
+  /// Bring the first pages of this system's component arrays into cache.
+  /// Only addresses should be touched here, never values that other
+  /// systems may be writing: in PREFETCH_HELPER_THREAD mode this runs
+  /// concurrently with the system that is currently executing.
+  virtual void prefetchComponents(CPM_ES_NS::ESCoreBase& core) = 0;
+
+  /// Issues a software prefetch for every cache line in
+  /// [\p data, \p data + \p bytes), capped at \p maxBytes.
+  static void prefetchRange(const void* data, size_t bytes, size_t maxBytes = 2 * 4096)
+  {
+    if (bytes > maxBytes) bytes = maxBytes;
+    const char* p = static_cast<const char*>(data);
+    for (size_t offset = 0; offset < bytes; offset += 64)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+      __builtin_prefetch(p + offset, 0, 3);
+#else
+      // Touching the line pulls it into cache just the same.
+      volatile char c = p[offset];
+      (void)c;
+#endif
+    }
+  }
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
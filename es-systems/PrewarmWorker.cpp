@@ -0,0 +1,78 @@
+#include "PrewarmWorker.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+PrewarmWorker::PrewarmWorker() :
+    mQuit(false)
+{
+  mThread = std::thread(&PrewarmWorker::run, this);
+}
+
+PrewarmWorker::~PrewarmWorker()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mQuit = true;
+  }
+  mCondition.notify_all();
+  mThread.join();
+}
+
+void PrewarmWorker::request(std::shared_ptr<Request> request)
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mQueue.push_back(request);
+  }
+  mCondition.notify_all();
+}
+
+std::shared_ptr<CPM_ES_NS::BaseSystem> PrewarmWorker::take(Request& request)
+{
+  // Not started: build it here rather than wait for the queue to drain.
+  int expected = QUEUED;
+  if (request.state.compare_exchange_strong(expected, CANCELLED))
+    return request.factory.newSystemFromName(request.name);
+
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait(lock, [&request] {return request.state.load() == DONE;});
+  }
+  if (request.error)
+    std::rethrow_exception(request.error);
+  return request.system;
+}
+
+void PrewarmWorker::run()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  for (;;)
+  {
+    mCondition.wait(lock, [this] {return mQuit || !mQueue.empty();});
+    if (mQuit)
+      return;
+
+    std::shared_ptr<Request> request = mQueue.front();
+    mQueue.pop_front();
+
+    int expected = QUEUED;
+    if (!request->state.compare_exchange_strong(expected, BUILDING))
+      continue;
+
+    lock.unlock();
+    try
+    {
+      request->system = request->factory.newSystemFromName(request->name);
+    }
+    catch (...)
+    {
+      request->error = std::current_exception();
+    }
+    lock.lock();
+
+    request->state.store(DONE);
+    mCondition.notify_all();
+  }
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
@@ -0,0 +1,66 @@
+#ifndef IAUNS_ES_SYSTEMS_PREWARMWORKER_HPP
+#define IAUNS_ES_SYSTEMS_PREWARMWORKER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "SystemFactory.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Helper thread that constructs lazily instantiated systems shortly before
+/// they are first due, so heavy constructors do not run on the simulation
+/// thread. Systems must not be registered while the helper may be
+/// constructing.
+class PrewarmWorker
+{
+public:
+  enum State {QUEUED, BUILDING, DONE, CANCELLED};
+
+  /// One construction, shared by the simulation thread and the helper.
+  struct Request
+  {
+    Request(SystemFactory& f, const char* n) : factory(f), name(n), state(QUEUED) {}
+
+    SystemFactory&                          factory;
+    const char*                             name;     ///< Owned by the factory.
+    std::shared_ptr<CPM_ES_NS::BaseSystem>  system;   ///< Valid once DONE.
+    std::exception_ptr                      error;    ///< Set if construction threw.
+    std::atomic<int>                        state;
+  };
+
+  PrewarmWorker();
+  ~PrewarmWorker();
+
+  /// Queues \p request. Never waits for a construction.
+  void request(std::shared_ptr<Request> request);
+
+  /// The system built for \p request. Constructs it on the calling thread
+  /// if the helper has not started on it yet, and waits if the helper is
+  /// in the middle of it. Rethrows what the constructor threw.
+  std::shared_ptr<CPM_ES_NS::BaseSystem> take(Request& request);
+
+private:
+  PrewarmWorker(const PrewarmWorker&);
+  PrewarmWorker& operator=(const PrewarmWorker&);
+
+  void run();
+
+  std::mutex                            mMutex;
+  std::condition_variable               mCondition;
+  std::deque<std::shared_ptr<Request> > mQueue;
+  bool                                  mQuit;
+  std::thread                           mThread;
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef IAUNS_ES_SYSTEMS_PUBLISHEDVALUE_HPP
+#define IAUNS_ES_SYSTEMS_PUBLISHEDVALUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Single writer, many reader publication of immutable values, in the
+/// style of read-copy-update. The writer publishes a new value instead of
+/// changing the current one; readers pin whichever value is current.
+///
+/// Acquiring is wait-free: one atomic increment on a word holding the
+/// current slot and its acquisition count. Releasing is one atomic
+/// increment on the slot. Publishing swaps the word, which tells the
+/// writer exactly how many readers pinned the old value, and the old value
+/// is freed by a later publish or reclaim once that many have released.
+/// Neither side ever waits for the other.
+///
+/// Values pinned for a long time occupy one of \p capacity slots. If all
+/// are taken, publish keeps the new value and retries on the next publish
+/// or reclaim, so readers briefly see the previous value.
+template <typename T>
+class PublishedValue
+{
+  struct Slot;
+
+public:
+  /// Pins a published value until destroyed. Movable, not copyable.
+  class Reference
+  {
+  public:
+    Reference() : mSlot(nullptr) {}
+    Reference(Reference&& other) : mSlot(other.mSlot) {other.mSlot = nullptr;}
+    ~Reference() {reset();}
+
+    Reference& operator=(Reference&& other)
+    {
+      if (this != &other)
+      {
+        reset();
+        mSlot = other.mSlot;
+        other.mSlot = nullptr;
+      }
+      return *this;
+    }
+
+    /// The pinned value, or nullptr if nothing was published yet.
+    const T* get() const          {return mSlot ? mSlot->value : nullptr;}
+    const T& operator*() const    {return *mSlot->value;}
+    const T* operator->() const   {return mSlot->value;}
+    explicit operator bool() const {return get() != nullptr;}
+
+    /// Unpins the value.
+    void reset()
+    {
+      if (mSlot)
+        mSlot->releases.fetch_add(1, std::memory_order_release);
+      mSlot = nullptr;
+    }
+
+  private:
+    friend class PublishedValue;
+    explicit Reference(Slot* slot) : mSlot(slot) {}
+
+    Reference(const Reference&);
+    Reference& operator=(const Reference&);
+
+    Slot* mSlot;
+  };
+
+  explicit PublishedValue(size_t capacity = 64) :
+      mCapacity(capacity < 2 ? 2 : capacity),
+      mSlots(new Slot[mCapacity]),
+      mCurrent(0)
+  {
+    // Slot 0 starts out current and empty.
+    mSlots[0].state = SLOT_CURRENT;
+  }
+
+  /// Frees every value. No Reference may outlive the publisher.
+  ~PublishedValue()
+  {
+    for (size_t i = 0; i < mCapacity; ++i)
+      delete mSlots[i].value;
+  }
+
+  /// Pins the current value. Safe on any thread.
+  Reference acquire() const
+  {
+    uint64_t word = mCurrent.fetch_add(1, std::memory_order_acquire);
+    return Reference(&mSlots[word >> CountBits]);
+  }
+
+  /// Makes \p value current. Writer thread only. Never blocks.
+  void publish(std::unique_ptr<T> value)
+  {
+    mPending = std::move(value);
+    reclaim();
+  }
+
+  /// Frees retired values that no reader pins any more, and publishes a
+  /// value deferred for lack of slots. Writer thread only. Never blocks or
+  /// allocates.
+  void reclaim()
+  {
+    for (size_t i = 0; i < mCapacity; ++i)
+    {
+      Slot& slot = mSlots[i];
+      if (slot.state == SLOT_RETIRED
+          && slot.releases.load(std::memory_order_acquire) == slot.acquired)
+      {
+        delete slot.value;
+        slot.value = nullptr;
+        slot.releases.store(0, std::memory_order_relaxed);
+        slot.state = SLOT_FREE;
+      }
+    }
+
+    if (!mPending)
+      return;
+
+    for (size_t i = 0; i < mCapacity; ++i)
+    {
+      Slot& slot = mSlots[i];
+      if (slot.state != SLOT_FREE)
+        continue;
+
+      slot.value = mPending.release();
+      slot.state = SLOT_CURRENT;
+      uint64_t old = mCurrent.exchange(static_cast<uint64_t>(i) << CountBits,
+                                       std::memory_order_acq_rel);
+      Slot& previous = mSlots[old >> CountBits];
+      previous.acquired = old & CountMask;
+      previous.state = SLOT_RETIRED;
+      return;
+    }
+  }
+
+  /// Number of values that are neither current nor free. Writer thread
+  /// only.
+  size_t retiredCount() const
+  {
+    size_t count = 0;
+    for (size_t i = 0; i < mCapacity; ++i)
+      count += mSlots[i].state == SLOT_RETIRED ? 1 : 0;
+    return count;
+  }
+
+  /// True if a value is waiting for a free slot. Writer thread only.
+  bool hasPending() const {return mPending != nullptr;}
+
+private:
+  PublishedValue(const PublishedValue&);
+  PublishedValue& operator=(const PublishedValue&);
+
+  /// The current word holds the slot index above CountBits and the number
+  /// of acquisitions of that slot below.
+  static const unsigned CountBits = 48;
+  static const uint64_t CountMask = (uint64_t(1) << CountBits) - 1;
+
+  enum SlotState {SLOT_FREE, SLOT_CURRENT, SLOT_RETIRED};
+
+  struct Slot
+  {
+    Slot() : value(nullptr), releases(0), acquired(0), state(SLOT_FREE) {}
+
+    T*                    value;
+    std::atomic<uint64_t> releases;   ///< Incremented by readers.
+    uint64_t              acquired;   ///< Set by the writer on retirement.
+    SlotState             state;      ///< Writer thread only.
+  };
+
+  const size_t              mCapacity;
+  std::unique_ptr<Slot[]>   mSlots;
+  mutable std::atomic<uint64_t> mCurrent;
+  std::unique_ptr<T>        mPending;
+};
+
+template <typename T>
+const unsigned PublishedValue<T>::CountBits;
+
+template <typename T>
+const uint64_t PublishedValue<T>::CountMask;
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
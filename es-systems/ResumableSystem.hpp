@@ -0,0 +1,121 @@
+#ifndef IAUNS_ES_SYSTEMS_RESUMABLESYSTEM_HPP
+#define IAUNS_ES_SYSTEMS_RESUMABLESYSTEM_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <entity-system/ESCoreBase.hpp>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Flag a resumable system can wait on. Signal it from any thread, for
+/// example when a background job the system started has finished.
+class CompletionEvent
+{
+public:
+  CompletionEvent() : mSet(false) {}
+
+  void signal()       {mSet.store(true, std::memory_order_release);}
+  void reset()        {mSet.store(false, std::memory_order_relaxed);}
+  bool isSet() const  {return mSet.load(std::memory_order_acquire);}
+
+private:
+  std::atomic<bool> mSet;
+};
+
+/// What a resumable system waits for before it is resumed again.
+struct ResumeWait
+{
+  enum Kind
+  {
+    NEXT_TICK,  ///< The system's next scheduled execution.
+    BUDGET,     ///< Right away, while the time slice lasts.
+    EVENT,      ///< The first scheduled execution after the event is set.
+    DONE        ///< Nothing. The next execution starts a fresh frame.
+  };
+
+  Kind                    kind;
+  uint64_t                budgetNS;
+  const CompletionEvent*  event;
+
+  static ResumeWait nextTick()
+  {
+    return make(NEXT_TICK, 0, nullptr);
+  }
+
+  /// Resume within the same execution unless \p slice has passed since
+  /// the execution began.
+  static ResumeWait budget(std::chrono::nanoseconds slice)
+  {
+    return make(BUDGET, static_cast<uint64_t>(slice.count()), nullptr);
+  }
+
+  static ResumeWait until(const CompletionEvent& event)
+  {
+    return make(EVENT, 0, &event);
+  }
+
+  static ResumeWait done()
+  {
+    return make(DONE, 0, nullptr);
+  }
+
+private:
+  static ResumeWait make(Kind kind, uint64_t budgetNS, const CompletionEvent* event)
+  {
+    ResumeWait wait;
+    wait.kind = kind;
+    wait.budgetNS = budgetNS;
+    wait.event = event;
+    return wait;
+  }
+};
+
+/// Optional interface for systems whose work spans several executions.
+/// Derive from BasicResumableSystem alongside BaseSystem or GenericSystem.
+/// Instead of walkComponents, the scheduler resumes the system's frame,
+/// which holds where the work left off. Frames are owned by the scheduler
+/// and come from a pool, so resuming and restarting never touch the heap.
+/// Frames are not serialized; a restored system starts a fresh frame.
+class ResumableSystem
+{
+public:
+  virtual ~ResumableSystem() {}
+
+  virtual size_t frameSize() const = 0;
+  virtual void constructFrame(void* frame) = 0;
+  virtual void destroyFrame(void* frame) = 0;
+
+  /// Continues the work held in \p frame until it has to wait.
+  virtual ResumeWait resumeFrame(CPM_ES_NS::ESCoreBase& core, void* frame) = 0;
+};
+
+/// Resumable system whose state between executions is a \p Frame,
+/// default constructed when the work starts and destroyed when resume
+/// returns ResumeWait::done(). Write resume as a switch over a state
+/// field of the frame.
+template <typename Frame>
+class BasicResumableSystem : public ResumableSystem
+{
+public:
+  static_assert(alignof(Frame) <= alignof(std::max_align_t),
+                "Frames must not be over-aligned.");
+
+  /// Continues the work held in \p frame until it has to wait.
+  virtual ResumeWait resume(CPM_ES_NS::ESCoreBase& core, Frame& frame) = 0;
+
+  size_t frameSize() const override           {return sizeof(Frame);}
+  void constructFrame(void* frame) override   {new (frame) Frame();}
+  void destroyFrame(void* frame) override     {static_cast<Frame*>(frame)->~Frame();}
+
+  ResumeWait resumeFrame(CPM_ES_NS::ESCoreBase& core, void* frame) override
+  {
+    return resume(core, *static_cast<Frame*>(frame));
+  }
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
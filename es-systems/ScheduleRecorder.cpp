@@ -0,0 +1,297 @@
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "ScheduleRecorder.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+namespace {
+
+const uint8_t Magic[4] = {'E', 'S', 'R', 'C'};
+
+/// Bytes buffered before a file descriptor recorder writes.
+const size_t FlushSize = 1 << 16;
+
+void fail(const char* message)
+{
+  std::cerr << "cpm-es-system: " << message << std::endl;
+  throw std::runtime_error(message);
+}
+
+} // anonymous namespace
+
+//------------------------------------------------------------------------------
+// ScheduleRecorder
+//------------------------------------------------------------------------------
+
+ScheduleRecorder::ScheduleRecorder() :
+    mFD(-1),
+    mHasFrame(false),
+    mLastFrame(0)
+{
+  mData.assign(Magic, Magic + sizeof(Magic));
+}
+
+ScheduleRecorder::ScheduleRecorder(int fd) :
+    mFD(fd),
+    mHasFrame(false),
+    mLastFrame(0)
+{
+  mData.reserve(FlushSize);
+  mData.assign(Magic, Magic + sizeof(Magic));
+}
+
+ScheduleRecorder::~ScheduleRecorder()
+{
+  try
+  {
+    flush();
+  }
+  catch (const std::exception&)
+  {
+  }
+}
+
+void ScheduleRecorder::tickLength(uint64_t tickNS)
+{
+  tag(SCHEDULE_EVENT_TICK);
+  varint(tickNS);
+  written();
+}
+
+void ScheduleRecorder::frame(uint64_t referenceTime)
+{
+  // Frames nearly always move forward by a little, so store the step.
+  if (mHasFrame && referenceTime >= mLastFrame)
+  {
+    tag(SCHEDULE_EVENT_FRAME);
+    varint(referenceTime - mLastFrame);
+  }
+  else
+  {
+    tag(SCHEDULE_EVENT_FRAME_ABS);
+    varint(referenceTime);
+  }
+  mHasFrame = true;
+  mLastFrame = referenceTime;
+  written();
+}
+
+void ScheduleRecorder::execute(const char* registeredName, uint64_t durationUS)
+{
+  uint32_t id;
+  auto it = mRegisteredIDs.find(registeredName);
+  if (it != mRegisteredIDs.end())
+  {
+    id = it->second;
+  }
+  else
+  {
+    id = nameID(registeredName);
+    mRegisteredIDs[registeredName] = id;
+  }
+
+  tag(SCHEDULE_EVENT_EXECUTE);
+  varint(id);
+  varint(durationUS);
+  written();
+}
+
+void ScheduleRecorder::add(const std::string& name, uint64_t interval,
+                           uint64_t stagger, uint64_t referenceTime)
+{
+  uint32_t id = nameID(name);
+  tag(SCHEDULE_EVENT_ADD);
+  varint(id);
+  varint(interval);
+  varint(stagger);
+  varint(referenceTime);
+  written();
+}
+
+void ScheduleRecorder::remove(const std::string& name)
+{
+  uint32_t id = nameID(name);
+  tag(SCHEDULE_EVENT_REMOVE);
+  varint(id);
+  written();
+}
+
+void ScheduleRecorder::slices(const std::string& name, uint32_t numSlices)
+{
+  uint32_t id = nameID(name);
+  tag(SCHEDULE_EVENT_SLICES);
+  varint(id);
+  varint(numSlices);
+  written();
+}
+
+void ScheduleRecorder::renormalize()
+{
+  tag(SCHEDULE_EVENT_RENORMALIZE);
+  written();
+}
+
+void ScheduleRecorder::flush()
+{
+  if (mFD < 0)
+    return;
+
+  size_t done = 0;
+  while (done < mData.size())
+  {
+    ssize_t n = ::write(mFD, mData.data() + done, mData.size() - done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+    {
+      mData.clear();
+      fail("Unable to write schedule recording.");
+    }
+    done += static_cast<size_t>(n);
+  }
+  mData.clear();
+}
+
+uint32_t ScheduleRecorder::nameID(const std::string& name)
+{
+  auto it = mNameIDs.find(name);
+  if (it != mNameIDs.end())
+    return it->second;
+
+  uint32_t id = static_cast<uint32_t>(mNameIDs.size());
+  mNameIDs[name] = id;
+  tag(SCHEDULE_EVENT_NAME);
+  varint(id);
+  varint(name.size());
+  mData.insert(mData.end(), name.begin(), name.end());
+  return id;
+}
+
+void ScheduleRecorder::tag(ScheduleEventType type)
+{
+  mData.push_back(static_cast<uint8_t>(type));
+}
+
+void ScheduleRecorder::varint(uint64_t v)
+{
+  while (v >= 0x80)
+  {
+    mData.push_back(static_cast<uint8_t>(v | 0x80));
+    v >>= 7;
+  }
+  mData.push_back(static_cast<uint8_t>(v));
+}
+
+void ScheduleRecorder::written()
+{
+  if (mFD >= 0 && mData.size() >= FlushSize)
+    flush();
+}
+
+//------------------------------------------------------------------------------
+// ScheduleRecordReader
+//------------------------------------------------------------------------------
+
+ScheduleRecordReader::ScheduleRecordReader(const void* data, size_t size) :
+    mCursor(static_cast<const uint8_t*>(data)),
+    mEnd(static_cast<const uint8_t*>(data) + size),
+    mLastFrame(0)
+{
+  if (size < sizeof(Magic) || std::memcmp(mCursor, Magic, sizeof(Magic)) != 0)
+    fail("Not a schedule recording.");
+  mCursor += sizeof(Magic);
+}
+
+bool ScheduleRecordReader::next(Event& event)
+{
+  for (;;)
+  {
+    if (mCursor == mEnd)
+      return false;
+
+    event.type = static_cast<ScheduleEventType>(*mCursor++);
+    event.name = nullptr;
+    event.referenceTime = 0;
+    event.interval = 0;
+    event.stagger = 0;
+    event.value = 0;
+
+    switch (event.type)
+    {
+      case SCHEDULE_EVENT_NAME:
+      {
+        uint64_t id = varint();
+        uint64_t length = varint();
+        if (id != mNames.size() || length > static_cast<uint64_t>(mEnd - mCursor))
+          fail("Malformed schedule recording.");
+        mNames.push_back(std::string(reinterpret_cast<const char*>(mCursor),
+                                     static_cast<size_t>(length)));
+        mCursor += length;
+        continue;
+      }
+      case SCHEDULE_EVENT_FRAME:
+        mLastFrame += varint();
+        event.referenceTime = mLastFrame;
+        return true;
+      case SCHEDULE_EVENT_FRAME_ABS:
+        mLastFrame = varint();
+        event.type = SCHEDULE_EVENT_FRAME;
+        event.referenceTime = mLastFrame;
+        return true;
+      case SCHEDULE_EVENT_EXECUTE:
+        event.name = name();
+        event.value = varint();
+        return true;
+      case SCHEDULE_EVENT_ADD:
+        event.name = name();
+        event.interval = varint();
+        event.stagger = varint();
+        event.referenceTime = varint();
+        return true;
+      case SCHEDULE_EVENT_REMOVE:
+        event.name = name();
+        return true;
+      case SCHEDULE_EVENT_RENORMALIZE:
+        return true;
+      case SCHEDULE_EVENT_TICK:
+        event.value = varint();
+        return true;
+      case SCHEDULE_EVENT_SLICES:
+        event.name = name();
+        event.value = varint();
+        return true;
+      default:
+        fail("Malformed schedule recording.");
+    }
+  }
+}
+
+uint64_t ScheduleRecordReader::varint()
+{
+  uint64_t v = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7)
+  {
+    if (mCursor == mEnd)
+      fail("Truncated schedule recording.");
+    uint8_t b = *mCursor++;
+    v |= static_cast<uint64_t>(b & 0x7f) << shift;
+    if ((b & 0x80) == 0)
+      return v;
+  }
+  fail("Malformed schedule recording.");
+  return 0;
+}
+
+const std::string* ScheduleRecordReader::name()
+{
+  uint64_t id = varint();
+  if (id >= mNames.size())
+    fail("Malformed schedule recording.");
+  return &mNames[static_cast<size_t>(id)];
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
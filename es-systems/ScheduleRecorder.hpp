@@ -0,0 +1,111 @@
+#ifndef IAUNS_ES_SYSTEMS_SCHEDULERECORDER_HPP
+#define IAUNS_ES_SYSTEMS_SCHEDULERECORDER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Events in a schedule recording. Every event is a one byte tag followed
+/// by unsigned LEB128 varints. System names are written once, in a NAME
+/// event, and referred to by a small ID afterwards.
+enum ScheduleEventType
+{
+  SCHEDULE_EVENT_NAME         = 1,  ///< id, length, name bytes
+  SCHEDULE_EVENT_FRAME        = 2,  ///< reference time minus previous frame's
+  SCHEDULE_EVENT_FRAME_ABS    = 3,  ///< absolute reference time
+  SCHEDULE_EVENT_EXECUTE      = 4,  ///< id, duration in microseconds
+  SCHEDULE_EVENT_ADD          = 5,  ///< id, interval, stagger, reference time
+  SCHEDULE_EVENT_REMOVE       = 6,  ///< id
+  SCHEDULE_EVENT_RENORMALIZE  = 7,  ///< no payload
+  SCHEDULE_EVENT_TICK         = 8,  ///< nanoseconds per tick
+  SCHEDULE_EVENT_SLICES       = 9   ///< id, number of slices
+};
+
+/// Compact binary log of what a SystemCore did: every system execution
+/// with its reference time and duration, every addition and removal and
+/// every renormalize. Times are in ticks. Attach one with
+/// SystemCore::setRecorder and feed the result to ScheduleReplayer.
+///
+/// Records into memory, or into a file descriptor through a 64 KiB buffer.
+/// Not thread safe, it is only called from the simulation thread.
+class ScheduleRecorder
+{
+public:
+  ScheduleRecorder();
+
+  /// Writes to \p fd, which remains owned by the caller.
+  explicit ScheduleRecorder(int fd);
+
+  /// Flushes.
+  ~ScheduleRecorder();
+
+  void tickLength(uint64_t tickNS);
+  void frame(uint64_t referenceTime);
+  void execute(const char* registeredName, uint64_t durationUS);
+  void add(const std::string& name, uint64_t interval, uint64_t stagger,
+           uint64_t referenceTime);
+  void remove(const std::string& name);
+  void slices(const std::string& name, uint32_t numSlices);
+  void renormalize();
+
+  /// Recorded bytes. Only holds everything when recording into memory.
+  const std::vector<uint8_t>& getData() const {return mData;}
+
+  /// Writes buffered bytes to the file descriptor, if any.
+  void flush();
+
+private:
+  ScheduleRecorder(const ScheduleRecorder&);
+  ScheduleRecorder& operator=(const ScheduleRecorder&);
+
+  uint32_t nameID(const std::string& name);
+  void tag(ScheduleEventType type);
+  void varint(uint64_t v);
+  void written();
+
+  int                                           mFD;    ///< -1 if recording into memory.
+  std::vector<uint8_t>                          mData;
+  std::unordered_map<std::string, uint32_t>     mNameIDs;
+  std::unordered_map<const char*, uint32_t>     mRegisteredIDs; ///< Cache for execute.
+  bool                                          mHasFrame;
+  uint64_t                                      mLastFrame;
+};
+
+/// Decodes a schedule recording one event at a time.
+class ScheduleRecordReader
+{
+public:
+  struct Event
+  {
+    ScheduleEventType   type;
+    const std::string*  name;           ///< System, if any. Valid until the next call.
+    uint64_t            referenceTime;  ///< FRAME and ADD.
+    uint64_t            interval;       ///< ADD.
+    uint64_t            stagger;        ///< ADD.
+    uint64_t            value;          ///< Duration, tick length or slices.
+  };
+
+  /// Reads \p size bytes at \p data, which must outlive the reader.
+  ScheduleRecordReader(const void* data, size_t size);
+
+  /// Reads the next event, skipping NAME events. Returns false at the end
+  /// of the recording. Throws std::runtime_error on malformed data.
+  bool next(Event& event);
+
+private:
+  uint64_t varint();
+  const std::string* name();
+
+  const uint8_t*            mCursor;
+  const uint8_t*            mEnd;
+  std::vector<std::string>  mNames;
+  uint64_t                  mLastFrame;
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
@@ -0,0 +1,117 @@
+#include <set>
+#include <string>
+
+#include "ScheduleReplayer.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+namespace {
+
+typedef std::vector<std::vector<std::string> > FrameLog;
+
+/// Systems executed in each frame of \p recording, in order.
+FrameLog executionsPerFrame(const std::vector<uint8_t>& recording)
+{
+  FrameLog frames;
+  ScheduleRecordReader reader(recording.data(), recording.size());
+  ScheduleRecordReader::Event event;
+  while (reader.next(event))
+  {
+    if (event.type == SCHEDULE_EVENT_FRAME)
+      frames.push_back(std::vector<std::string>());
+    else if (event.type == SCHEDULE_EVENT_EXECUTE && !frames.empty())
+      frames.back().push_back(*event.name);
+  }
+  return frames;
+}
+
+} // anonymous namespace
+
+ScheduleReplayer::ScheduleReplayer(const void* data, size_t size) :
+    mData(data),
+    mSize(size)
+{
+}
+
+ScheduleReplayer::Result ScheduleReplayer::replay(SystemCore& systems,
+                                                  CPM_ES_NS::ESCoreBase& core)
+{
+  Result result;
+  FrameLog recorded;
+  std::set<std::string> registered;
+  std::chrono::nanoseconds tick(1000000);
+
+  ScheduleRecorder replayed;
+  systems.setRecorder(&replayed);
+
+  ScheduleRecordReader reader(mData, mSize);
+  ScheduleRecordReader::Event event;
+  while (reader.next(event))
+  {
+    std::chrono::steady_clock::time_point start;
+    switch (event.type)
+    {
+      case SCHEDULE_EVENT_TICK:
+        tick = std::chrono::nanoseconds(event.value);
+        if (event.value == 1)
+          systems.setTickResolution(SystemCore::TICK_NANOSECONDS);
+        else if (event.value == 1000)
+          systems.setTickResolution(SystemCore::TICK_MICROSECONDS);
+        else
+          systems.setTickResolution(SystemCore::TICK_MILLISECONDS);
+        break;
+
+      case SCHEDULE_EVENT_ADD:
+        if (registered.insert(*event.name).second)
+          systems.registerSystemAs<ReplayStubSystem>(*event.name);
+        systems.addActiveSystem(*event.name, tick * event.interval,
+                                tick * event.referenceTime, tick * event.stagger);
+        break;
+
+      case SCHEDULE_EVENT_REMOVE:
+        systems.removeActiveSystem(*event.name);
+        break;
+
+      case SCHEDULE_EVENT_SLICES:
+        systems.setSystemSlices(*event.name, static_cast<uint32_t>(event.value));
+        break;
+
+      case SCHEDULE_EVENT_RENORMALIZE:
+        start = std::chrono::steady_clock::now();
+        systems.renormalize();
+        result.schedulerTime += std::chrono::steady_clock::now() - start;
+        break;
+
+      case SCHEDULE_EVENT_FRAME:
+        recorded.push_back(std::vector<std::string>());
+        start = std::chrono::steady_clock::now();
+        systems.runSystems(core, tick * event.referenceTime);
+        result.schedulerTime += std::chrono::steady_clock::now() - start;
+        ++result.frames;
+        break;
+
+      case SCHEDULE_EVENT_EXECUTE:
+        if (!recorded.empty())
+          recorded.back().push_back(*event.name);
+        ++result.recordedExecutions;
+        result.recordedDurationUS += event.value;
+        break;
+
+      default:
+        break;
+    }
+  }
+  systems.setRecorder(nullptr);
+
+  FrameLog ours = executionsPerFrame(replayed.getData());
+  for (size_t i = 0; i < recorded.size(); ++i)
+  {
+    if (i < ours.size())
+      result.replayedExecutions += ours[i].size();
+    if (i >= ours.size() || ours[i] != recorded[i])
+      ++result.mismatchedFrames;
+  }
+  return result;
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
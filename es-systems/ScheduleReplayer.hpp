@@ -0,0 +1,69 @@
+#ifndef IAUNS_ES_SYSTEMS_SCHEDULEREPLAYER_HPP
+#define IAUNS_ES_SYSTEMS_SCHEDULEREPLAYER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <entity-system/ESCoreBase.hpp>
+
+#include "ScheduleRecorder.hpp"
+#include "SliceableSystem.hpp"
+#include "SystemCore.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Stand in for a recorded system during replay. Does no work, so a replay
+/// measures the scheduler alone.
+class ReplayStubSystem : public CPM_ES_NS::BaseSystem,
+                         public SliceableSystem
+{
+public:
+  void walkComponents(CPM_ES_NS::ESCoreBase&) override {}
+  void walkComponentsSlice(CPM_ES_NS::ESCoreBase&, uint32_t, uint32_t) override {}
+};
+
+/// Replays a ScheduleRecorder recording into a fresh SystemCore. Every
+/// recorded system is registered as a ReplayStubSystem, and the recorded
+/// additions, removals, renormalizes and reference times are fed back in
+/// their original order. The replay is itself recorded and compared with
+/// the original, frame by frame, so scheduler changes can be both checked
+/// and benchmarked against real traffic.
+class ScheduleReplayer
+{
+public:
+  struct Result
+  {
+    Result() :
+        frames(0),
+        recordedExecutions(0),
+        replayedExecutions(0),
+        mismatchedFrames(0),
+        recordedDurationUS(0),
+        schedulerTime(0)
+    {}
+
+    uint64_t frames;
+    uint64_t recordedExecutions;
+    uint64_t replayedExecutions;
+    uint64_t mismatchedFrames;    ///< Frames that ran different systems.
+    uint64_t recordedDurationUS;  ///< Total recorded system time.
+
+    /// Time spent in runSystems and renormalize during the replay.
+    std::chrono::nanoseconds schedulerTime;
+  };
+
+  /// \p data must outlive the replayer.
+  ScheduleReplayer(const void* data, size_t size);
+
+  /// Replays into \p systems, which must have no registered or active
+  /// systems. Throws std::runtime_error on malformed recordings.
+  Result replay(SystemCore& systems, CPM_ES_NS::ESCoreBase& core);
+
+private:
+  const void* mData;
+  size_t      mSize;
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
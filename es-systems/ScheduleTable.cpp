@@ -0,0 +1,309 @@
+#include <atomic>
+#include <limits>
+
+#include "ScheduleTable.hpp"
+
+// The vectorized kernels are compiled for their own instruction sets and
+// picked at runtime, so a default build carries and tests them.
+#if !defined(CPM_ES_SYSTEMS_NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) \
+    && (defined(__GNUC__) || defined(__clang__))
+  #define CPM_ES_SYSTEMS_SIMD_DISPATCH
+  #include <immintrin.h>
+#endif
+
+namespace CPM_ES_SYSTEMS_NS {
+
+namespace {
+
+typedef uint64_t (*ScanFunction)(uint64_t* next, const uint64_t* interval, size_t count,
+                                 uint64_t referenceTime, uint64_t& lateMask);
+
+/// Scalar due check of entries \p i up to \p count. Also the tail of the
+/// vectorized kernels.
+inline uint64_t scanTail(uint64_t* next, const uint64_t* interval, size_t i, size_t count,
+                         uint64_t referenceTime, uint64_t dueMask, uint64_t& lateMask)
+{
+  for (; i < count; ++i)
+  {
+    if (next[i] <= referenceTime)
+    {
+      dueMask |= uint64_t(1) << i;
+      if (interval[i] != 0 && referenceTime - next[i] >= interval[i])
+        lateMask |= uint64_t(1) << i;
+      next[i] += interval[i];
+    }
+  }
+  return dueMask;
+}
+
+uint64_t scanScalar(uint64_t* next, const uint64_t* interval, size_t count,
+                    uint64_t referenceTime, uint64_t& lateMask)
+{
+  lateMask = 0;
+  return scanTail(next, interval, 0, count, referenceTime, 0, lateMask);
+}
+
+#ifdef CPM_ES_SYSTEMS_SIMD_DISPATCH
+__attribute__((target("avx2")))
+uint64_t scanAVX2(uint64_t* next, const uint64_t* interval, size_t count,
+                  uint64_t referenceTime, uint64_t& lateMask)
+{
+  uint64_t dueMask = 0;
+  lateMask = 0;
+  size_t i = 0;
+
+  // There is no unsigned 64 bit compare, so flip the sign bit of both sides
+  // and use the signed compare instead.
+  const __m256i signBit = _mm256_set1_epi64x(static_cast<long long>(0x8000000000000000ULL));
+  const __m256i ref     = _mm256_xor_si256(_mm256_set1_epi64x(static_cast<long long>(referenceTime)), signBit);
+  const __m256i zero    = _mm256_setzero_si256();
+  for (; i + 4 <= count; i += 4)
+  {
+    __m256i n   = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(next + i));
+    __m256i ivl = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(interval + i));
+
+    // due = !(next > ref)
+    __m256i notDue = _mm256_cmpgt_epi64(_mm256_xor_si256(n, signBit), ref);
+    __m256i due    = _mm256_andnot_si256(notDue, _mm256_set1_epi64x(-1));
+
+    // late = due && interval != 0 && !(interval > ref - next)
+    __m256i diff   = _mm256_sub_epi64(_mm256_set1_epi64x(static_cast<long long>(referenceTime)), n);
+    __m256i onTime = _mm256_cmpgt_epi64(_mm256_xor_si256(ivl, signBit),
+                                        _mm256_xor_si256(diff, signBit));
+    __m256i late   = _mm256_andnot_si256(_mm256_or_si256(onTime, _mm256_cmpeq_epi64(ivl, zero)), due);
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(next + i),
+                        _mm256_add_epi64(n, _mm256_and_si256(ivl, due)));
+
+    dueMask  |= static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(due))) << i;
+    lateMask |= static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(late))) << i;
+  }
+
+  return scanTail(next, interval, i, count, referenceTime, dueMask, lateMask);
+}
+
+__attribute__((target("sse4.2")))
+uint64_t scanSSE42(uint64_t* next, const uint64_t* interval, size_t count,
+                   uint64_t referenceTime, uint64_t& lateMask)
+{
+  uint64_t dueMask = 0;
+  lateMask = 0;
+  size_t i = 0;
+
+  const __m128i signBit = _mm_set1_epi64x(static_cast<long long>(0x8000000000000000ULL));
+  const __m128i ref     = _mm_xor_si128(_mm_set1_epi64x(static_cast<long long>(referenceTime)), signBit);
+  const __m128i zero    = _mm_setzero_si128();
+  for (; i + 2 <= count; i += 2)
+  {
+    __m128i n   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(next + i));
+    __m128i ivl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(interval + i));
+
+    __m128i notDue = _mm_cmpgt_epi64(_mm_xor_si128(n, signBit), ref);
+    __m128i due    = _mm_andnot_si128(notDue, _mm_set1_epi64x(-1));
+
+    __m128i diff   = _mm_sub_epi64(_mm_set1_epi64x(static_cast<long long>(referenceTime)), n);
+    __m128i onTime = _mm_cmpgt_epi64(_mm_xor_si128(ivl, signBit),
+                                     _mm_xor_si128(diff, signBit));
+    __m128i late   = _mm_andnot_si128(_mm_or_si128(onTime, _mm_cmpeq_epi64(ivl, zero)), due);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(next + i),
+                     _mm_add_epi64(n, _mm_and_si128(ivl, due)));
+
+    dueMask  |= static_cast<uint64_t>(_mm_movemask_pd(_mm_castsi128_pd(due))) << i;
+    lateMask |= static_cast<uint64_t>(_mm_movemask_pd(_mm_castsi128_pd(late))) << i;
+  }
+
+  return scanTail(next, interval, i, count, referenceTime, dueMask, lateMask);
+}
+#endif
+
+ScanFunction scanFunction(ScheduleTable::ScanKernel kernel)
+{
+  switch (kernel)
+  {
+#ifdef CPM_ES_SYSTEMS_SIMD_DISPATCH
+    case ScheduleTable::SCAN_AVX2:  return scanAVX2;
+    case ScheduleTable::SCAN_SSE42: return scanSSE42;
+#endif
+    default:                        return scanScalar;
+  }
+}
+
+/// The widest kernel this CPU supports.
+ScanFunction bestScan()
+{
+  if (ScheduleTable::isScanKernelSupported(ScheduleTable::SCAN_AVX2))
+    return scanFunction(ScheduleTable::SCAN_AVX2);
+  if (ScheduleTable::isScanKernelSupported(ScheduleTable::SCAN_SSE42))
+    return scanFunction(ScheduleTable::SCAN_SSE42);
+  return scanScalar;
+}
+
+uint64_t scanDetect(uint64_t* next, const uint64_t* interval, size_t count,
+                    uint64_t referenceTime, uint64_t& lateMask);
+
+/// The kernel in use. Starts out as scanDetect, which picks the best
+/// supported kernel on first use. Constant initialized, so tables used
+/// during static initialization are safe.
+std::atomic<ScanFunction> gScan(scanDetect);
+
+uint64_t scanDetect(uint64_t* next, const uint64_t* interval, size_t count,
+                    uint64_t referenceTime, uint64_t& lateMask)
+{
+  // Leaves a kernel set by setScanKernel in the meantime alone.
+  ScanFunction expected = scanDetect;
+  gScan.compare_exchange_strong(expected, bestScan(), std::memory_order_relaxed);
+  return gScan.load(std::memory_order_relaxed)(next, interval, count, referenceTime, lateMask);
+}
+
+} // namespace
+
+void ScheduleTable::clear()
+{
+  mNextExecutionTime.clear();
+  mInterval.clear();
+  mStagger.clear();
+  mLateMask.clear();
+  mLateScheduledTime.clear();
+}
+
+void ScheduleTable::reserve(size_t count)
+{
+  mNextExecutionTime.reserve(count);
+  mInterval.reserve(count);
+  mStagger.reserve(count);
+  mLateScheduledTime.reserve(count);
+}
+
+void ScheduleTable::push_back(uint64_t interval, uint64_t stagger,
+                              uint64_t nextExecutionTime)
+{
+  mNextExecutionTime.push_back(nextExecutionTime);
+  mInterval.push_back(interval);
+  mStagger.push_back(stagger);
+  mLateScheduledTime.push_back(0);
+}
+
+void ScheduleTable::recalcNextExecutionTimes(uint64_t referenceTime)
+{
+  // Systems with no interval are due on every frame, leave them be.
+  for (size_t i = 0; i < mNextExecutionTime.size(); ++i)
+  {
+    if (mInterval[i] != 0)
+      mNextExecutionTime[i] = calcNextExecutionTime(referenceTime, mInterval[i], mStagger[i]);
+  }
+}
+
+size_t ScheduleTable::computeDueMask(uint64_t referenceTime,
+                                     std::vector<uint64_t>& dueMask)
+{
+  size_t numEntries = mNextExecutionTime.size();
+  size_t numWords = (numEntries + BitsPerWord - 1) / BitsPerWord;
+  if (dueMask.size() < numWords)
+    dueMask.resize(numWords);
+  if (mLateMask.size() < numWords)
+    mLateMask.resize(numWords);
+
+  size_t numDue = 0;
+  for (size_t w = 0; w < numWords; ++w)
+  {
+    size_t begin = w * BitsPerWord;
+    size_t count = numEntries - begin;
+    if (count > BitsPerWord) count = BitsPerWord;
+
+    uint64_t lateMask = 0;
+    uint64_t word = gScan.load(std::memory_order_relaxed)(
+        &mNextExecutionTime[begin], &mInterval[begin], count, referenceTime, lateMask);
+    mLateMask[w] = lateMask;
+
+    // Systems that fell more than one interval behind snap to the closest
+    // stagger point after the reference time instead of accumulating.
+    // Adding 1 to the reference time ensures the next execution isn't *now*.
+    while (lateMask != 0)
+    {
+      size_t i = begin + lowestSetBit(lateMask);
+      mLateScheduledTime[i] = mNextExecutionTime[i] - mInterval[i];
+      mNextExecutionTime[i] = calcNextExecutionTime(referenceTime + 1,
+                                                    mInterval[i], mStagger[i]);
+      lateMask &= lateMask - 1;
+    }
+
+    dueMask[w] = word;
+    for (uint64_t bits = word; bits != 0; bits &= bits - 1)
+      ++numDue;
+  }
+
+  return numDue;
+}
+
+bool ScheduleTable::isScanKernelSupported(ScanKernel kernel)
+{
+  switch (kernel)
+  {
+    case SCAN_SCALAR:
+      return true;
+#ifdef CPM_ES_SYSTEMS_SIMD_DISPATCH
+    case SCAN_SSE42:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("sse4.2");
+    case SCAN_AVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+#endif
+    default:
+      return false;
+  }
+}
+
+bool ScheduleTable::setScanKernel(ScanKernel kernel)
+{
+  if (!isScanKernelSupported(kernel))
+    return false;
+  gScan.store(scanFunction(kernel), std::memory_order_relaxed);
+  return true;
+}
+
+ScheduleTable::ScanKernel ScheduleTable::scanKernel()
+{
+  ScanFunction current = gScan.load(std::memory_order_relaxed);
+  if (current == scanDetect)
+    current = bestScan();
+#ifdef CPM_ES_SYSTEMS_SIMD_DISPATCH
+  if (current == scanAVX2)
+    return SCAN_AVX2;
+  if (current == scanSSE42)
+    return SCAN_SSE42;
+#endif
+  return SCAN_SCALAR;
+}
+
+uint64_t ScheduleTable::calcNextExecutionTime(uint64_t referenceTime,
+                                              uint64_t interval, uint64_t stagger)
+{
+  if (interval != 0)
+  {
+    // Recalculate the execution time using mod and stagger. Computed as
+    // (referenceTime + stagger) % interval without forming the sum, so that
+    // large nanosecond reference times cannot wrap.
+    uint64_t refMod     = referenceTime % interval;
+    uint64_t staggerMod = stagger % interval;
+    uint64_t modInterval = (refMod >= interval - staggerMod)
+        ? refMod - (interval - staggerMod)
+        : refMod + staggerMod;
+
+    // This will set the next execution time to the closest stagger point.
+    // Saturate rather than wrap if that point lies past the end of time.
+    if (modInterval == 0)
+      return referenceTime;
+    else if (interval - modInterval > std::numeric_limits<uint64_t>::max() - referenceTime)
+      return std::numeric_limits<uint64_t>::max();
+    else
+      return referenceTime + (interval - modInterval);
+  }
+  else
+  {
+    return referenceTime;
+  }
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
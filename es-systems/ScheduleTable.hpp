@@ -0,0 +1,116 @@
+#ifndef IAUNS_ES_SYSTEMS_SCHEDULETABLE_HPP
+#define IAUNS_ES_SYSTEMS_SCHEDULETABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Structure-of-arrays scheduling table. Holds the timing state of every
+/// active system in contiguous arrays so that the per-frame due check only
+/// streams through the data it actually needs. Index i in the table
+/// corresponds to index i in SystemCore's active system list.
+class ScheduleTable
+{
+public:
+
+  /// Number of systems tracked by one word of the due mask.
+  static const size_t BitsPerWord = 64;
+
+  /// Remove all entries from the table. Does not release memory.
+  void clear();
+
+  /// Reserve space for \p count entries.
+  void reserve(size_t count);
+
+  /// Append an entry to the end of the table.
+  void push_back(uint64_t interval, uint64_t stagger, uint64_t nextExecutionTime);
+
+  /// Number of entries in the table.
+  size_t size() const {return mNextExecutionTime.size();}
+
+  /// Checks every entry against \p referenceTime. Bit (i % 64) of
+  /// dueMask[i / 64] is set if entry i should execute. The next execution
+  /// time of every due entry is advanced in bulk. \p dueMask is resized to
+  /// fit the table, but is never shrunk, so reusing the same vector across
+  /// frames does not allocate.
+  /// Returns the number of due entries.
+  size_t computeDueMask(uint64_t referenceTime, std::vector<uint64_t>& dueMask);
+
+  /// Snaps the next execution time of every entry with a non-zero interval
+  /// to its first stagger point at or after \p referenceTime.
+  void recalcNextExecutionTimes(uint64_t referenceTime);
+
+  /// The time entry \p i was scheduled to run at. Only valid for entries
+  /// that were due in the most recent call to computeDueMask, made with
+  /// \p referenceTime. Entries with an interval of 0 are due on every call
+  /// and so always run on schedule, at \p referenceTime.
+  uint64_t lastScheduledTime(size_t i, uint64_t referenceTime) const
+  {
+    if (mInterval[i] == 0)
+      return referenceTime;
+    if ((mLateMask[i / BitsPerWord] >> (i % BitsPerWord)) & 1)
+      return mLateScheduledTime[i];
+    else
+      return mNextExecutionTime[i] - mInterval[i];
+  }
+
+  uint64_t interval(size_t i) const           {return mInterval[i];}
+  uint64_t stagger(size_t i) const            {return mStagger[i];}
+  uint64_t nextExecutionTime(size_t i) const  {return mNextExecutionTime[i];}
+
+  /// Index of the lowest set bit in \p word. \p word must be non-zero.
+  static unsigned lowestSetBit(uint64_t word)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctzll(word));
+#else
+    unsigned n = 0;
+    while ((word & 1) == 0) { word >>= 1; ++n; }
+    return n;
+#endif
+  }
+
+  /// Implementations of the due check. Each computes the due mask of up to
+  /// BitsPerWord entries, advances the due entries by their interval and
+  /// reports the entries that fell behind by more than one interval.
+  enum ScanKernel
+  {
+    SCAN_SCALAR,
+    SCAN_SSE42,
+    SCAN_AVX2
+  };
+
+  /// True if \p kernel is compiled in and supported by this CPU. The
+  /// vectorized kernels are left out when CPM_ES_SYSTEMS_NO_SIMD is
+  /// defined or the target is not x86.
+  static bool isScanKernelSupported(ScanKernel kernel);
+
+  /// Switches every table to \p kernel. Returns false, leaving the kernel
+  /// in use alone, if \p kernel is not supported. By default the widest
+  /// supported kernel is used. Meant for tests and benchmarks.
+  static bool setScanKernel(ScanKernel kernel);
+
+  /// The kernel in use.
+  static ScanKernel scanKernel();
+
+  /// Calculate next reference time taking into account the given stagger.
+  static uint64_t calcNextExecutionTime(uint64_t referenceTime, uint64_t interval,
+                                        uint64_t stagger);
+
+private:
+
+  std::vector<uint64_t> mNextExecutionTime; ///< Next execution time in ticks from reference.
+  std::vector<uint64_t> mInterval;          ///< Update interval in ticks.
+  std::vector<uint64_t> mStagger;           ///< Offset into interval.
+
+  /// Entries that fell behind in the most recent computeDueMask, and the
+  /// time they had been scheduled for. Only written for late entries.
+  std::vector<uint64_t> mLateMask;
+  std::vector<uint64_t> mLateScheduledTime;
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
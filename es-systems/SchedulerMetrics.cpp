@@ -0,0 +1,123 @@
+#include <sstream>
+
+#include "SchedulerMetrics.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+namespace {
+
+void header(std::ostringstream& out, const char* name, const char* type, const char* help)
+{
+  out << "# HELP " << name << " " << help << "\n"
+      << "# TYPE " << name << " " << type << "\n";
+}
+
+/// Escapes a label value as the exposition format requires.
+std::string escapeLabel(const std::string& value)
+{
+  std::string escaped;
+  escaped.reserve(value.size());
+  for (char c : value)
+  {
+    if (c == '\\')      escaped += "\\\\";
+    else if (c == '"')  escaped += "\\\"";
+    else if (c == '\n') escaped += "\\n";
+    else                escaped += c;
+  }
+  return escaped;
+}
+
+} // anonymous namespace
+
+SchedulerMetrics::SchedulerMetrics() :
+    mCells(nullptr),
+    mActiveSystems(0),
+    mPendingAdds(0),
+    mPendingRemovals(0),
+    mRenormalizes(0),
+    mRenormalizeUS(0),
+    mLastRenormalizeUS(0)
+{}
+
+SchedulerMetrics::~SchedulerMetrics()
+{
+  Cell* cell = mCells.load(std::memory_order_acquire);
+  while (cell != nullptr)
+  {
+    Cell* next = cell->next;
+    delete cell;
+    cell = next;
+  }
+}
+
+SchedulerMetrics::Cell* SchedulerMetrics::cell(const std::string& name)
+{
+  Cell* head = mCells.load(std::memory_order_relaxed);
+  for (Cell* c = head; c != nullptr; c = c->next)
+  {
+    if (c->name == name)
+      return c;
+  }
+
+  // Only this thread prepends, so publishing is a single release store.
+  Cell* c = new Cell(name);
+  c->next = head;
+  mCells.store(c, std::memory_order_release);
+  return c;
+}
+
+void SchedulerMetrics::publishActive(uint64_t generation)
+{
+  for (Cell* c = mCells.load(std::memory_order_relaxed); c != nullptr; c = c->next)
+    c->active.store(c->generation == generation, std::memory_order_relaxed);
+}
+
+std::string SchedulerMetrics::format() const
+{
+  std::ostringstream out;
+
+  header(out, "es_systems_active", "gauge", "Number of active systems.");
+  out << "es_systems_active " << mActiveSystems.load(std::memory_order_relaxed) << "\n";
+  header(out, "es_systems_pending_additions", "gauge", "Systems waiting for renormalize to be added.");
+  out << "es_systems_pending_additions " << mPendingAdds.load(std::memory_order_relaxed) << "\n";
+  header(out, "es_systems_pending_removals", "gauge", "Systems waiting for renormalize to be removed.");
+  out << "es_systems_pending_removals " << mPendingRemovals.load(std::memory_order_relaxed) << "\n";
+
+  header(out, "es_systems_renormalize_total", "counter", "Renormalizes that applied changes.");
+  out << "es_systems_renormalize_total " << mRenormalizes.load(std::memory_order_relaxed) << "\n";
+  header(out, "es_systems_renormalize_microseconds_total", "counter", "Time spent applying changes.");
+  out << "es_systems_renormalize_microseconds_total "
+      << mRenormalizeUS.load(std::memory_order_relaxed) << "\n";
+  header(out, "es_systems_renormalize_last_microseconds", "gauge", "Duration of the last renormalize that applied changes.");
+  out << "es_systems_renormalize_last_microseconds "
+      << mLastRenormalizeUS.load(std::memory_order_relaxed) << "\n";
+
+  struct PerSystem
+  {
+    const char* name;
+    const char* help;
+    const std::atomic<uint64_t> Cell::* value;
+  };
+  const PerSystem perSystem[] = {
+    {"es_systems_executions_total", "Executions per system.", &Cell::executions},
+    {"es_systems_execution_microseconds_total", "Time spent in walkComponents per system.", &Cell::durationUS},
+    {"es_systems_lateness_ticks_total", "Ticks between scheduled and actual start per system.", &Cell::lateness},
+    {"es_systems_skipped_total", "Executions skipped because a system ran late.", &Cell::skips}
+  };
+
+  Cell* head = mCells.load(std::memory_order_acquire);
+  for (const PerSystem& metric : perSystem)
+  {
+    header(out, metric.name, "counter", metric.help);
+    for (const Cell* c = head; c != nullptr; c = c->next)
+    {
+      if (!c->active.load(std::memory_order_relaxed))
+        continue;
+      out << metric.name << "{system=\"" << escapeLabel(c->name) << "\"} "
+          << (c->*metric.value).load(std::memory_order_relaxed) << "\n";
+    }
+  }
+  return out.str();
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
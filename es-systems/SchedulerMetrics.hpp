@@ -0,0 +1,113 @@
+#ifndef IAUNS_ES_SYSTEMS_SCHEDULERMETRICS_HPP
+#define IAUNS_ES_SYSTEMS_SCHEDULERMETRICS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Live scheduler counters, read by another thread while the simulation
+/// runs. Every value has a single writer, so updates are a relaxed load and
+/// store and never lock or wait. Readers see each value atomically but not
+/// a consistent snapshot across values, which is fine for monitoring.
+///
+/// Attach to a SystemCore with setMetrics and serve with MetricsExporter,
+/// or call format from any thread.
+class SchedulerMetrics
+{
+public:
+  /// Counters of one system. Written only by the thread that executes the
+  /// system.
+  struct Cell
+  {
+    Cell(const std::string& n) :
+        name(n),
+        next(nullptr),
+        generation(0),
+        active(false),
+        executions(0),
+        durationUS(0),
+        lateness(0),
+        skips(0)
+    {}
+
+    /// Adds one execution that ran for \p us microseconds, started \p late
+    /// ticks after it was scheduled and missed \p skipped earlier
+    /// executions.
+    void record(uint64_t us, uint64_t late, uint64_t skipped)
+    {
+      add(executions, 1);
+      add(durationUS, us);
+      add(lateness, late);
+      add(skips, skipped);
+    }
+
+    const std::string     name;
+    Cell*                 next;         ///< Set before the cell is published.
+    uint64_t              generation;   ///< Simulation thread only.
+
+    std::atomic<bool>     active;
+    std::atomic<uint64_t> executions;
+    std::atomic<uint64_t> durationUS;
+    std::atomic<uint64_t> lateness;     ///< In ticks.
+    std::atomic<uint64_t> skips;        ///< Executions lost to lateness.
+  };
+
+  SchedulerMetrics();
+  ~SchedulerMetrics();
+
+  /// Cell of system \p name, created on first use. Cells are never freed
+  /// before the metrics, so a system that is removed and added again keeps
+  /// its counters. Simulation thread only.
+  Cell* cell(const std::string& name);
+
+  /// Marks exactly the cells stamped with \p generation as active.
+  /// Simulation thread only.
+  void publishActive(uint64_t generation);
+
+  /// Sets the active system count and pending queue depths.
+  void setQueues(uint64_t active, uint64_t pendingAdds, uint64_t pendingRemovals)
+  {
+    mActiveSystems.store(active, std::memory_order_relaxed);
+    mPendingAdds.store(pendingAdds, std::memory_order_relaxed);
+    mPendingRemovals.store(pendingRemovals, std::memory_order_relaxed);
+  }
+
+  /// Adds one renormalize that took \p durationUS.
+  void recordRenormalize(uint64_t durationUS)
+  {
+    add(mRenormalizes, 1);
+    add(mRenormalizeUS, durationUS);
+    mLastRenormalizeUS.store(durationUS, std::memory_order_relaxed);
+  }
+
+  /// All metrics in the Prometheus text exposition format. Active systems
+  /// only. Safe to call from any thread.
+  std::string format() const;
+
+private:
+  SchedulerMetrics(const SchedulerMetrics&);
+  SchedulerMetrics& operator=(const SchedulerMetrics&);
+
+  /// Single writer increment.
+  static void add(std::atomic<uint64_t>& counter, uint64_t value)
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+  }
+
+  /// Cells in creation order, newest first. Only ever prepended.
+  std::atomic<Cell*>    mCells;
+
+  std::atomic<uint64_t> mActiveSystems;
+  std::atomic<uint64_t> mPendingAdds;
+  std::atomic<uint64_t> mPendingRemovals;
+  std::atomic<uint64_t> mRenormalizes;
+  std::atomic<uint64_t> mRenormalizeUS;
+  std::atomic<uint64_t> mLastRenormalizeUS;
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
@@ -0,0 +1,322 @@
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ShardCoordinator.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+namespace {
+
+const uint64_t SegmentMagic = 0x63706d2d65732d31ull;
+
+size_t roundUp(size_t bytes)
+{
+  return (bytes + 63) & ~static_cast<size_t>(63);
+}
+
+/// Spins briefly, then sleeps, until \p done returns true or \p timeout
+/// passes.
+template <typename Predicate>
+bool waitUntil(Predicate done, std::chrono::milliseconds timeout)
+{
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+  for (uint32_t spins = 0; !done(); ++spins)
+  {
+    if (std::chrono::steady_clock::now() >= deadline)
+      return false;
+    if (spins < 1000)
+      std::this_thread::yield();
+    else
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+  return true;
+}
+
+} // namespace
+
+/// Start of the segment. Only lock free atomics are shared between
+/// processes.
+struct ShardCoordinator::Header
+{
+  std::atomic<uint64_t> magic;          ///< Set last by the leader.
+  std::atomic<int64_t>  leaderPid;      ///< Process that created the segment.
+  uint32_t              numShards;
+  uint32_t              maxSystems;
+  uint64_t              tableOffset;
+  uint64_t              arenaOffset;
+  uint64_t              arenaBytes;
+
+  std::atomic<uint64_t> frame;
+  std::atomic<uint64_t> referenceTime;
+  std::atomic<uint32_t> stopped;
+  std::atomic<uint64_t> arrived[MaxShards];
+
+  /// Odd while the leader writes the table.
+  std::atomic<uint64_t> tableSequence;
+  std::atomic<uint32_t> tableSize;
+};
+
+ShardCoordinator::ShardCoordinator(const std::string& name, const ShardLayout& layout) :
+    mName(name),
+    mShard(0),
+    mHeader(nullptr),
+    mTable(nullptr),
+    mArena(nullptr),
+    mSize(0),
+    mLastFrame(0)
+{
+  static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Shared atomics must be lock free.");
+
+  if (layout.numShards == 0 || layout.numShards > MaxShards)
+  {
+    std::cerr << "cpm-es-system: Unsupported shard count " << layout.numShards << std::endl;
+    throw std::runtime_error("cpm-es-system: Unsupported shard count.");
+  }
+
+  size_t tableOffset = roundUp(sizeof(Header));
+  size_t arenaOffset = roundUp(tableOffset + layout.maxSystems * sizeof(Entry));
+  size_t size = arenaOffset + roundUp(layout.arenaBytes);
+
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0 && errno == EEXIST && isStale(name))
+  {
+    shm_unlink(name.c_str());
+    fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  }
+  if (fd < 0 && errno == EEXIST)
+  {
+    std::cerr << "cpm-es-system: Shared memory " << name << " exists and its leader is alive."
+              << std::endl;
+    throw std::runtime_error("cpm-es-system: Shared memory already in use.");
+  }
+  if (fd < 0 || ftruncate(fd, static_cast<off_t>(size)) != 0)
+  {
+    std::cerr << "cpm-es-system: Unable to create shared memory " << name << std::endl;
+    if (fd >= 0)
+    {
+      close(fd);
+      shm_unlink(name.c_str());
+    }
+    throw std::runtime_error("cpm-es-system: Unable to create shared memory.");
+  }
+  map(fd, size);
+
+  // The segment is zero filled, which is a valid state for every atomic.
+  mHeader = new (mHeader) Header();
+  mHeader->numShards = layout.numShards;
+  mHeader->maxSystems = layout.maxSystems;
+  mHeader->tableOffset = tableOffset;
+  mHeader->arenaOffset = arenaOffset;
+  mHeader->arenaBytes = layout.arenaBytes;
+  mHeader->frame.store(0);
+  mHeader->referenceTime.store(0);
+  mHeader->stopped.store(0);
+  for (uint32_t i = 0; i < MaxShards; ++i)
+    mHeader->arrived[i].store(0);
+  mHeader->tableSequence.store(0);
+  mHeader->tableSize.store(0);
+  mHeader->leaderPid.store(static_cast<int64_t>(getpid()));
+
+  mTable = reinterpret_cast<Entry*>(static_cast<char*>(static_cast<void*>(mHeader)) + tableOffset);
+  mArena = static_cast<char*>(static_cast<void*>(mHeader)) + arenaOffset;
+  mHeader->magic.store(SegmentMagic, std::memory_order_release);
+}
+
+ShardCoordinator::ShardCoordinator(const std::string& name, uint32_t shard) :
+    mName(name),
+    mShard(shard),
+    mHeader(nullptr),
+    mTable(nullptr),
+    mArena(nullptr),
+    mSize(0),
+    mLastFrame(0)
+{
+  int fd = shm_open(name.c_str(), O_RDWR, 0600);
+  struct stat info;
+  if (fd < 0 || fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header))
+  {
+    std::cerr << "cpm-es-system: Unable to open shared memory " << name << std::endl;
+    if (fd >= 0)
+      close(fd);
+    throw std::runtime_error("cpm-es-system: Unable to open shared memory.");
+  }
+  map(fd, static_cast<size_t>(info.st_size));
+
+  if (mHeader->magic.load(std::memory_order_acquire) != SegmentMagic
+      || shard == 0 || shard >= mHeader->numShards)
+  {
+    std::cerr << "cpm-es-system: Unable to join " << name << " as shard " << shard << std::endl;
+    munmap(mHeader, mSize);
+    throw std::runtime_error("cpm-es-system: Unable to join shared memory.");
+  }
+
+  mTable = reinterpret_cast<Entry*>(static_cast<char*>(static_cast<void*>(mHeader)) + mHeader->tableOffset);
+  mArena = static_cast<char*>(static_cast<void*>(mHeader)) + mHeader->arenaOffset;
+}
+
+ShardCoordinator::~ShardCoordinator()
+{
+  if (isLeader())
+  {
+    stop();
+    shm_unlink(mName.c_str());
+  }
+  munmap(mHeader, mSize);
+}
+
+bool ShardCoordinator::isStale(const std::string& name)
+{
+  int fd = shm_open(name.c_str(), O_RDONLY, 0600);
+  struct stat info;
+  if (fd < 0 || fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header))
+  {
+    // Missing, or a leader has not sized it yet.
+    if (fd >= 0)
+      close(fd);
+    return false;
+  }
+  void* memory = mmap(nullptr, sizeof(Header), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED)
+    return false;
+
+  // Only a finished segment names its leader. A reused pid keeps the
+  // segment alive, which errs on the safe side.
+  const Header* header = static_cast<const Header*>(memory);
+  bool stale = false;
+  if (header->magic.load(std::memory_order_acquire) == SegmentMagic)
+  {
+    pid_t pid = static_cast<pid_t>(header->leaderPid.load(std::memory_order_relaxed));
+    stale = pid > 0 && kill(pid, 0) != 0 && errno == ESRCH;
+  }
+  munmap(memory, sizeof(Header));
+  return stale;
+}
+
+void ShardCoordinator::map(int fd, size_t size)
+{
+  void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED)
+  {
+    std::cerr << "cpm-es-system: Unable to map shared memory " << mName << std::endl;
+    if (isLeader())
+      shm_unlink(mName.c_str());
+    throw std::runtime_error("cpm-es-system: Unable to map shared memory.");
+  }
+  mHeader = static_cast<Header*>(memory);
+  mSize = size;
+}
+
+uint32_t ShardCoordinator::numShards() const
+{
+  return mHeader->numShards;
+}
+
+size_t ShardCoordinator::componentArenaSize() const
+{
+  return mHeader->arenaBytes;
+}
+
+void ShardCoordinator::beginFrame(uint64_t referenceTime)
+{
+  mHeader->referenceTime.store(referenceTime, std::memory_order_relaxed);
+  mLastFrame = mHeader->frame.fetch_add(1, std::memory_order_acq_rel) + 1;
+}
+
+bool ShardCoordinator::waitFrame(uint64_t& referenceTime, std::chrono::milliseconds timeout)
+{
+  Header* header = mHeader;
+  uint64_t last = mLastFrame;
+  bool started = waitUntil([header, last]
+                           {
+                             return header->stopped.load(std::memory_order_acquire) != 0
+                                 || header->frame.load(std::memory_order_acquire) > last;
+                           }, timeout);
+  if (!started || header->stopped.load(std::memory_order_acquire) != 0)
+    return false;
+
+  mLastFrame = header->frame.load(std::memory_order_acquire);
+  referenceTime = header->referenceTime.load(std::memory_order_relaxed);
+  return true;
+}
+
+bool ShardCoordinator::finishFrame(std::chrono::milliseconds timeout)
+{
+  if (!isLeader())
+  {
+    mHeader->arrived[mShard].store(mLastFrame, std::memory_order_release);
+    return true;
+  }
+
+  Header* header = mHeader;
+  uint64_t frame = mLastFrame;
+  return waitUntil([header, frame]
+                   {
+                     for (uint32_t s = 1; s < header->numShards; ++s)
+                     {
+                       if (header->arrived[s].load(std::memory_order_acquire) < frame)
+                         return false;
+                     }
+                     return true;
+                   }, timeout);
+}
+
+void ShardCoordinator::stop()
+{
+  mHeader->stopped.store(1, std::memory_order_release);
+}
+
+void ShardCoordinator::publishTable(const std::vector<Entry>& entries)
+{
+  if (entries.size() > mHeader->maxSystems)
+  {
+    std::cerr << "cpm-es-system: Shard table holds " << mHeader->maxSystems
+              << " systems, " << entries.size() << " are active." << std::endl;
+    throw std::runtime_error("cpm-es-system: Shard table too small.");
+  }
+
+  uint64_t sequence = mHeader->tableSequence.load(std::memory_order_relaxed);
+  mHeader->tableSequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  if (!entries.empty())
+    std::memcpy(mTable, entries.data(), entries.size() * sizeof(Entry));
+  mHeader->tableSize.store(static_cast<uint32_t>(entries.size()), std::memory_order_relaxed);
+  mHeader->tableSequence.store(sequence + 2, std::memory_order_release);
+}
+
+uint64_t ShardCoordinator::tableGeneration() const
+{
+  return mHeader->tableSequence.load(std::memory_order_acquire);
+}
+
+uint64_t ShardCoordinator::readTable(std::vector<Entry>& entries) const
+{
+  for (;;)
+  {
+    uint64_t before = mHeader->tableSequence.load(std::memory_order_acquire);
+    if (before & 1)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    entries.resize(mHeader->tableSize.load(std::memory_order_relaxed));
+    if (!entries.empty())
+      std::memcpy(entries.data(), mTable, entries.size() * sizeof(Entry));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (mHeader->tableSequence.load(std::memory_order_relaxed) == before)
+      return before;
+  }
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
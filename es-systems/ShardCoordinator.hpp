@@ -0,0 +1,117 @@
+#ifndef IAUNS_ES_SYSTEMS_SHARDCOORDINATOR_HPP
+#define IAUNS_ES_SYSTEMS_SHARDCOORDINATOR_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Size of the shared segment created by a leader.
+struct ShardLayout
+{
+  ShardLayout() :
+      numShards(2),
+      maxSystems(1024),
+      arenaBytes(0)
+  {}
+
+  uint32_t  numShards;    ///< Processes, including the leader.
+  uint32_t  maxSystems;   ///< Entries in the shard table.
+  size_t    arenaBytes;   ///< Bytes of shared component storage.
+};
+
+/// Coordinates SystemCores in several processes on one machine, each
+/// running a share of the active systems. The leader, shard 0, creates a
+/// POSIX shared memory segment holding a frame barrier, a table that
+/// assigns every active system to a shard, and an arena for component
+/// data all shards work on. Followers attach to the segment by name. Only
+/// plain data may be placed in the arena, it is mapped at a different
+/// address in every process. POSIX only.
+class ShardCoordinator
+{
+public:
+  static const uint32_t MaxShards = 64;
+
+  /// One row of the shard table.
+  struct Entry
+  {
+    char      name[64];
+    uint32_t  shard;
+  };
+
+  /// Creates segment \p name, a POSIX shared memory name such as
+  /// "/world", as the leader. A segment of the same name is replaced only
+  /// if the leader that created it no longer runs. Throws if the segment
+  /// cannot be created or another leader still owns it.
+  ShardCoordinator(const std::string& name, const ShardLayout& layout);
+
+  /// Attaches to the segment \p name as follower \p shard. Throws if the
+  /// segment does not exist or \p shard is out of range.
+  ShardCoordinator(const std::string& name, uint32_t shard);
+
+  /// Unmaps the segment. The leader stops the followers and removes the
+  /// segment.
+  ~ShardCoordinator();
+
+  bool      isLeader() const  {return mShard == 0;}
+  uint32_t  shard() const     {return mShard;}
+  uint32_t  numShards() const;
+
+  /// Shared component storage, zeroed when the leader creates it.
+  void*     componentArena()  {return mArena;}
+  size_t    componentArenaSize() const;
+
+  /// Leader: starts a frame at \p referenceTime.
+  void beginFrame(uint64_t referenceTime);
+
+  /// Follower: waits for a frame newer than the last one it saw and
+  /// returns its reference time. Returns false if none began within
+  /// \p timeout, or the leader stopped.
+  bool waitFrame(uint64_t& referenceTime, std::chrono::milliseconds timeout);
+
+  /// Follower: reports that its share of the current frame is done.
+  /// Leader: waits until every follower reported the current frame.
+  /// Returns false if that took longer than \p timeout.
+  bool finishFrame(std::chrono::milliseconds timeout);
+
+  /// Leader: tells followers that no more frames follow.
+  void stop();
+
+  /// Leader: replaces the shard table. Throws if a name is too long or
+  /// there are more entries than the layout has room for.
+  void publishTable(const std::vector<Entry>& entries);
+
+  /// Changes every time the table is published.
+  uint64_t tableGeneration() const;
+
+  /// Copies the shard table into \p entries. Returns its generation.
+  uint64_t readTable(std::vector<Entry>& entries) const;
+
+private:
+  ShardCoordinator(const ShardCoordinator&);
+  ShardCoordinator& operator=(const ShardCoordinator&);
+
+  struct Header;
+
+  /// True if segment \p name exists and the leader that created it has
+  /// exited.
+  static bool isStale(const std::string& name);
+
+  void map(int fd, size_t size);
+
+  std::string   mName;
+  uint32_t      mShard;
+  Header*       mHeader;
+  Entry*        mTable;
+  void*         mArena;
+  size_t        mSize;
+  uint64_t      mLastFrame;
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef IAUNS_ES_SYSTEMS_SLICEABLESYSTEM_HPP
+#define IAUNS_ES_SYSTEMS_SLICEABLESYSTEM_HPP
+
+#include <cstdint>
+#include <entity-system/ESCoreBase.hpp>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Optional interface for systems that can process a fraction of their
+/// entities at a time. Derive from this alongside GenericSystem. When a
+/// system is split into N slices with SystemCore::setSystemSlices, the
+/// scheduler runs it N times per interval, passing slices 0 through N - 1
+/// in turn, instead of walking every entity once per interval. This
+/// flattens the per tick cost of long interval systems.
+class SliceableSystem
+{
+public:
+  virtual ~SliceableSystem() {}
+
+  /// Walk slice \p slice of \p numSlices of this system's entities. Every
+  /// entity must belong to exactly one slice, for example by entity ID
+  /// modulo \p numSlices or by splitting the component array into ranges.
+  virtual void walkComponentsSlice(CPM_ES_NS::ESCoreBase& core, uint32_t slice,
+                                   uint32_t numSlices) = 0;
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
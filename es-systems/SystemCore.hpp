@@ -1,11 +1,42 @@
 #ifndef IAUNS_ES_SYSTEMS_SYSTEMCORE_HPP
 #define IAUNS_ES_SYSTEMS_SYSTEMCORE_HPP
 
+#include <chrono>
+#include <exception>
 #include <list>
+#include <map>
+#include <memory>
+#include <set>
 #include <entity-system/ESCoreBase.hpp>
 #include <tny/tny.hpp>
 
 #include "SystemFactory.hpp"
+#include "ScheduleTable.hpp"
+#include "HyperperiodSchedule.hpp"
+#include "PrefetchableSystem.hpp"
+#include "PrefetchWorker.hpp"
+#include "PrewarmWorker.hpp"
+#include "SliceableSystem.hpp"
+#include "SystemTimingStats.hpp"
+#include "PerfCounters.hpp"
+#include "SchedulerMetrics.hpp"
+#include "ActiveSystemSnapshot.hpp"
+#include "PublishedValue.hpp"
+#include "EntityCountingSystem.hpp"
+#include "OutputReportingSystem.hpp"
+#include "ResumableSystem.hpp"
+#include "FramePool.hpp"
+#include "EntityBuckets.hpp"
+#include "ShardCoordinator.hpp"
+#include "SystemWatchdog.hpp"
+#include "DoubleBuffer.hpp"
+#include "WorkerPool.hpp"
+#include "AllocationCounter.hpp"
+#include "SystemSnapshot.hpp"
+#include "SystemRecordStream.hpp"
+#include "ScheduleRecorder.hpp"
+#include "SystemCorePolicies.hpp"
+#include "CostProfile.hpp"
 
 namespace CPM_ES_SYSTEMS_NS {
 
@@ -26,17 +57,385 @@ public:
 
 } // namespace core_detail
 
-class SystemCore
+/// Policy independent types shared by every BasicSystemCore.
+class SystemCoreTypes
 {
 public:
-  
+
+  /// How component data for the next due system is warmed up while the
+  /// current system runs. Only systems deriving from PrefetchableSystem are
+  /// prefetched.
+  enum PrefetchMode
+  {
+    PREFETCH_NONE,          ///< No lookahead (default).
+    PREFETCH_INLINE,        ///< Call the hook on the simulation thread.
+    PREFETCH_HELPER_THREAD  ///< Call the hook on a helper thread.
+  };
+
+  /// Resolution of the scheduler's internal clock. Intervals, staggers and
+  /// reference times are stored as whole ticks of this resolution.
+  enum TickResolution
+  {
+    TICK_NANOSECONDS,
+    TICK_MICROSECONDS,
+    TICK_MILLISECONDS   ///< Default.
+  };
+
+  /// Phases of the scheduler, for allocation tracking.
+  enum SchedulerPhase
+  {
+    PHASE_SCHEDULE,     ///< Deciding which systems are due.
+    PHASE_DISPATCH,     ///< Running due systems, including the systems themselves.
+    PHASE_RENORMALIZE,  ///< Buffer swaps, additions and removals.
+    NUM_SCHEDULER_PHASES
+  };
+};
+
+/// Manages the set of active systems and runs them on their intervals.
+///
+/// The policies select the implementation of each concern at compile time:
+///  - SchedulerPolicy decides which systems are due each frame. It must
+///    expose ScheduleTable's interface.
+///  - ClockPolicy defines the tick length. See SystemCorePolicies.hpp.
+///  - InstrumentationPolicy handles diagnostics. With NullInstrumentation
+///    nothing is logged and the timing statistics and watchdog paths
+///    compile away.
+///  - AllocatorPolicy allocates the system lists and per frame buffers. It
+///    is rebound to each element type.
+///
+/// SystemCore uses the default policies and is compiled into the library.
+/// Other combinations must include SystemCoreImpl.hpp.
+template <typename SchedulerPolicy = ScheduleTable,
+          typename ClockPolicy = RuntimeClock,
+          typename InstrumentationPolicy = StreamInstrumentation,
+          typename AllocatorPolicy = std::allocator<char> >
+class BasicSystemCore : public SystemCoreTypes
+{
+public:
+
+  BasicSystemCore() :
+      mUseAffinityOrdering(false),
+      mPrefetchMode(PREFETCH_NONE),
+      mRecordTiming(false),
+      mCountersUnavailableLogged(false),
+      mTrackAllocations(false),
+      mPhaseAllocations(),
+      mTrackCost(false),
+      mCostSmoothing(0.125),
+      mUsePrecompiledSchedule(false),
+      mMaxHyperperiod(0),
+      mHasLastReferenceTime(false),
+      mLastReferenceTime(0),
+      mScheduleStale(false),
+      mPipelined(false),
+      mOverlapCore(nullptr),
+      mShard(nullptr),
+      mShardTimeout(1000),
+      mShardGeneration(0),
+      mShardStale(false),
+      mRecorder(nullptr),
+      mMetrics(nullptr),
+      mMetricsGeneration(0),
+      mLoadTargetUS(0),
+      mLowWatermark(0.5),
+      mSettleFrames(8),
+      mOverloadedFrames(0),
+      mUnderloadedFrames(0),
+      mLoadLevel(0),
+      mLazy(false),
+      mPrewarm(0),
+      mLazyCursor(0),
+      mOverlapStale(false),
+      mOutputDriven(false),
+      mOutputClock(0),
+      mActiveGeneration(0)
+  {}
+
+  ~BasicSystemCore();
+
   /// Perform requested additions and removals of systems that occured
   /// during the frame.
   void renormalize();
 
-  /// Runs all systems.
+  /// Runs all systems. \p referenceTime is in milliseconds.
   void runSystems(CPM_ES_NS::ESCoreBase& core, uint64_t referenceTime);
 
+  /// Runs all systems. \p referenceTime is truncated to the tick resolution.
+  void runSystems(CPM_ES_NS::ESCoreBase& core, std::chrono::nanoseconds referenceTime);
+
+  /// Sets the tick resolution. May only be changed while no systems are
+  /// active or pending. The millisecond overloads keep working at any
+  /// resolution. Use a finer resolution for systems running faster than
+  /// 1 kHz. Throws if the clock policy does not support \p resolution.
+  void setTickResolution(TickResolution resolution);
+
+  /// Length of one tick.
+  std::chrono::nanoseconds getTickDuration() const
+  {
+    return std::chrono::nanoseconds(mClock.tickNS());
+  }
+
+  /// Enables or disables the precompiled schedule. When enabled, every
+  /// renormalize computes the least common multiple of all system intervals
+  /// (the hyperperiod) and precomputes which systems are due at each tick
+  /// of it. runSystems then becomes a table lookup. If the hyperperiod is
+  /// larger than \p maxHyperperiod ticks, the dynamic scheduler is used
+  /// instead.
+  ///
+  /// A frame that advances several ticks runs every system with a stagger
+  /// point in between once, read from the table. A frame that advances
+  /// more than a hyperperiod, or does not advance at all (a repeated or
+  /// first tick), runs on the dynamic scheduler. The table resumes on the
+  /// next frame that advances.
+  void setPrecompiledSchedule(bool enabled, uint64_t maxHyperperiod = 1 << 16);
+
+  /// True if a precompiled schedule is built and will be used for frames
+  /// that advance by up to a hyperperiod.
+  bool isUsingPrecompiledSchedule() const {return mHyperperiod.valid();}
+
+  /// Enables or disables component affinity ordering. By default systems
+  /// execute in alphabetical order. When enabled, systems are instead
+  /// ordered by their component signature (as declared through
+  /// GenericSystem) so that systems walking the same component types run
+  /// back to back and find that data in cache. Systems with identical
+  /// signatures still execute in alphabetical order.
+  void setComponentAffinityOrdering(bool enabled);
+
+  /// Sets how the next due system's component data is prefetched. See
+  /// PrefetchMode and PrefetchableSystem.
+  void setPrefetchMode(PrefetchMode mode);
+
+  /// Enables or disables recording of per system timing statistics: how
+  /// late each execution started relative to its scheduled time, and how
+  /// long walkComponents took. Recording does not allocate. Has no effect
+  /// if the instrumentation policy is disabled.
+  void setTimingStatistics(bool enabled);
+
+  /// Copies the timing statistics of the active system \p name into
+  /// \p stats. Returns false if the system is not active.
+  bool getTimingStatistics(const std::string& name, SystemTimingStats& stats) const;
+
+  /// Enables or disables hardware counters. While enabled, cycles,
+  /// instructions, last level cache misses and branch misses are read
+  /// around every system executed on the calling thread and summed per
+  /// system. Events per entity are only reported for systems deriving from
+  /// EntityCountingSystem. Returns false, leaving counters off, if the
+  /// instrumentation policy is disabled or perf_event_open is not available
+  /// (non Linux systems, containers without perf access, virtual machines
+  /// without a PMU); that failure is logged only once. Counters belong to
+  /// the thread that enables them.
+  bool setHardwareCounters(bool enabled);
+
+  /// Copies the hardware counter totals of the active system \p name into
+  /// \p stats. Returns false if the system is not active.
+  bool getHardwareCounters(const std::string& name, SystemCounterStats& stats) const;
+
+  /// Enables or disables allocation tracking. While enabled, heap
+  /// allocations made on the calling thread are counted per system and per
+  /// scheduler phase. Allocations are only seen if they are reported to
+  /// allocation_counter, see GlobalAllocationHook.hpp and
+  /// CountingAllocator. Systems on the overlap thread are not counted. Has
+  /// no effect if the instrumentation policy is disabled.
+  void setAllocationTracking(bool enabled);
+
+  /// Copies the number of allocations made by the active system \p name
+  /// into \p count. Returns false if the system is not active.
+  bool getAllocationCount(const std::string& name, uint64_t& count) const;
+
+  /// Number of allocations made during \p phase.
+  uint64_t getPhaseAllocationCount(SchedulerPhase phase) const
+  {
+    return mPhaseAllocations[phase];
+  }
+
+  /// Resets all allocation counts to zero.
+  void resetAllocationCounts();
+
+  /// Enables or disables cost tracking. While enabled, every execution
+  /// folds its duration into an exponentially weighted average cost per
+  /// system, weighting the new sample by \p smoothing. Costs are saved
+  /// with the active systems and in cost profiles, and balance shard
+  /// assignment. Systems on the overlap thread are not measured. Has no
+  /// effect if the instrumentation policy is disabled.
+  void setCostTracking(bool enabled, double smoothing = 0.125);
+
+  /// Copies the smoothed cost of the active system \p name into \p cost.
+  /// Returns false if the system is not active or has no cost yet.
+  bool getSystemCost(const std::string& name, std::chrono::nanoseconds& cost) const;
+
+  /// Writes the cost of every active system, and the loaded costs of
+  /// systems no longer active, to the cost profile \p path. Throws
+  /// std::runtime_error if it cannot be written.
+  void saveCostProfile(const std::string& path) const;
+
+  /// Reads the cost profile \p path. Its costs seed the active systems and
+  /// systems added later, and are refined by tracking from there. Throws
+  /// std::runtime_error if it cannot be read.
+  void loadCostProfile(const std::string& path);
+
+  /// Records every frame, system execution, addition, removal and
+  /// renormalize into \p recorder, which must outlive its use. Pass nullptr
+  /// to stop recording. Systems on the overlap thread are not recorded.
+  /// Has no effect if the instrumentation policy is disabled.
+  void setRecorder(ScheduleRecorder* recorder);
+
+  /// Publishes live counters into \p metrics, which must outlive its use:
+  /// the active system count, pending additions and removals, executions,
+  /// time, lateness and skipped executions per system, and the duration of
+  /// renormalize. The calling thread only stores to atomics it alone
+  /// writes, so it never locks or waits on readers. Serve \p metrics with
+  /// MetricsExporter. Pass nullptr to stop. Systems on the overlap thread
+  /// are not counted. Has no effect if the instrumentation policy is
+  /// disabled.
+  void setMetrics(SchedulerMetrics* metrics);
+
+  /// Starts a watchdog thread that calls \p callback for any system that is
+  /// still inside walkComponents after \p budget. The callback runs on the
+  /// watchdog thread. Replaces any previous watchdog. Has no effect if the
+  /// instrumentation policy is disabled.
+  void setWatchdog(std::chrono::microseconds budget,
+                   SystemWatchdog::OverrunCallback callback);
+
+  /// Stops the watchdog thread, if any.
+  void clearWatchdog();
+
+  /// Registers a double buffered component type. Its buffers are swapped
+  /// at the start of every renormalize, which marks the frame boundary.
+  void addDoubleBuffer(std::shared_ptr<DoubleBufferBase> buffer);
+
+  /// Enables or disables pipelined execution. When enabled, due systems
+  /// that only read components run on a helper thread while the systems
+  /// that write run on the calling thread. The helper is joined before
+  /// runSystems returns, so the core may be changed between frames.
+  ///
+  /// A system is read only unless it derives from ComponentWriter, since
+  /// GenericSystem only hands out const components. A read only system is
+  /// moved to the helper thread unless it walks a component type that
+  /// another active system writes without a double buffer, or it does not
+  /// derive from GenericSystem. Resumable systems are never overlapped.
+  /// Overlapped systems are not prefetched, timed or watched.
+  void setPipelinedExecution(bool enabled);
+
+  /// True if the active system \p name runs on the helper thread while
+  /// pipelined execution is enabled.
+  bool isSystemOverlapped(const std::string& name) const;
+
+  /// Replaces the helper threads used by pipelined execution with a pool
+  /// laid out by \p config: a set of workers per NUMA node, optionally
+  /// pinned to the node or to single cores. Without a pool, pipelined
+  /// execution uses a single unpinned worker. Affinity is Linux only,
+  /// elsewhere workers are not pinned.
+  void setWorkerPool(const WorkerPoolConfig& config);
+
+  /// Prefers NUMA node \p node for system \p name. When overlapped, the
+  /// system runs on a worker of that node. Instances created afterwards
+  /// are constructed on such a worker, so that the kernel's first touch
+  /// policy places their memory on the node. Pass -1 to clear. Requires a
+  /// worker pool for any effect.
+  void setSystemNode(const std::string& name, int node);
+
+  /// Worker that runs the overlapped system \p name, or -1 if it is not
+  /// overlapped.
+  int getSystemWorker(const std::string& name) const;
+
+  /// Enables or disables lazy instantiation. While enabled, systems added
+  /// or restored afterwards hold only their registered name until they are
+  /// first due or sliced, so a cold start with thousands of restored
+  /// systems only constructs the ones that run early. With a nonzero
+  /// \p prewarm, systems due within \p prewarm are constructed ahead of
+  /// time on a helper thread, except those with a preferred node, which
+  /// are constructed on their node when due. The helper reads the factory,
+  /// so register every system before adding lazy ones. Lazy systems are
+  /// not overlapped until constructed.
+  void setLazyInstantiation(bool enabled,
+                            std::chrono::nanoseconds prewarm = std::chrono::nanoseconds(0));
+
+  /// True if the active system \p name has been constructed.
+  bool isSystemInstantiated(const std::string& name) const;
+
+  /// Declares that system \p consumer only consumes what system
+  /// \p producer outputs. Takes effect at the next renormalize, which
+  /// resolves declarations between active systems into a compact graph.
+  /// Declarations naming an inactive system are kept but ignored until
+  /// both systems are active. Systems depending on each other in a cycle
+  /// are logged and run ungated. Throws if either name is not registered.
+  void addSystemDependency(const std::string& producer, const std::string& consumer);
+
+  /// Typed version of addSystemDependency.
+  template <typename Producer, typename Consumer>
+  void addSystemDependencyViaType()
+  {
+    addSystemDependency(Producer::getName(), Consumer::getName());
+  }
+
+  /// Removes a declaration made with addSystemDependency. Takes effect at
+  /// the next renormalize.
+  void removeSystemDependency(const std::string& producer, const std::string& consumer);
+
+  /// Enables or disables output driven execution. When enabled, a due
+  /// system with active producers is skipped unless one of them reported
+  /// new output since the system last ran. A producer reports output by
+  /// implementing OutputReportingSystem, or else by running. Output of a
+  /// producer that runs later in the same frame is seen on the consumer's
+  /// next due tick. Producers and consumers are not overlapped while
+  /// enabled.
+  void setOutputDrivenExecution(bool enabled);
+
+  /// True if the active system \p name is gated on its producers.
+  bool isSystemGated(const std::string& name) const;
+
+  /// Adds a level of detail bucket to system \p name and returns its
+  /// index. Entities in the bucket are updated every \p ms milliseconds,
+  /// offset by \p staggerMS, instead of on the system's own interval.
+  /// Buckets are checked whenever the system runs, so give the system the
+  /// interval of its fastest bucket. The system must implement
+  /// BucketedSystem, otherwise its buckets are ignored. Bucketed systems
+  /// are not overlapped, and buckets are not serialized.
+  uint32_t addEntityBucket(const std::string& name, uint64_t ms, uint64_t staggerMS = 0);
+
+  /// Typed version of addEntityBucket.
+  uint32_t addEntityBucket(const std::string& name, std::chrono::nanoseconds interval,
+                           std::chrono::nanoseconds stagger = std::chrono::nanoseconds(0));
+
+  /// Moves \p entityID of system \p name into \p bucket in constant time,
+  /// adding it if it is in no bucket. Entities in no bucket are not
+  /// updated.
+  void setEntityBucket(const std::string& name, uint64_t entityID, uint32_t bucket);
+
+  /// Stops updating \p entityID in system \p name.
+  void removeBucketedEntity(const std::string& name, uint64_t entityID);
+
+  /// Lets \p classifier move the entities of system \p name between
+  /// buckets each time their bucket runs. Classification cost follows the
+  /// update rate as well.
+  void setBucketClassifier(const std::string& name, EntityBuckets::Classifier classifier);
+
+  /// Removes all buckets of system \p name. It walks all of its components
+  /// again.
+  void clearEntityBuckets(const std::string& name);
+
+  /// The buckets of system \p name, or nullptr if it has none.
+  const EntityBuckets* getEntityBuckets(const std::string& name) const;
+
+  /// Runs only this process's share of the active systems, as assigned by
+  /// the leader of \p coordinator, which must outlive its use. Every
+  /// process adds the same systems. The leader assigns them whenever its
+  /// schedule is rebuilt, to the shard set with setSystemShard or else
+  /// round robin in name order. The leader's runSystems opens a frame and
+  /// returns once every follower finished it, or after \p barrierTimeout.
+  /// Followers pass the reference time from ShardCoordinator::waitFrame
+  /// to runSystems. Systems of other shards are neither constructed
+  /// lazily nor overlapped. Pass nullptr to run every system again.
+  void setShardCoordinator(ShardCoordinator* coordinator,
+                           std::chrono::milliseconds barrierTimeout = std::chrono::milliseconds(1000));
+
+  /// Assigns system \p name to shard \p shard. Pass -1 to clear. Only the
+  /// leader's assignments count.
+  void setSystemShard(const std::string& name, int shard);
+
+  /// True if the active system \p name runs in this process.
+  bool isSystemLocal(const std::string& name) const;
+
   /// Registers the system with the serialization system so that a system can
   /// be created on-demand during deserialization.
   template <typename T>
@@ -50,7 +449,7 @@ public:
     // Ensure there is no duplicate system.
     if (mSystemFactory.hasSystem(T::getName()))
     {
-      std::cerr << "cpm-es-systems: System with duplicate name." << " Name: " << T::getName() << std::endl;
+      InstrumentationPolicy::log("cpm-es-systems: System with duplicate name.", " Name: ", T::getName());
       throw std::runtime_error("cpm-es-systems: System with duplicate name.");
       return;
     }
@@ -58,6 +457,20 @@ public:
     mSystemFactory.registerSystem<T>(T::getName());
   }
 
+  /// Registers system type \p T under \p name instead of its own name, for
+  /// example to stand in for a system that is not available.
+  template <typename T>
+  void registerSystemAs(const std::string& name)
+  {
+    if (mSystemFactory.hasSystem(name.c_str()))
+    {
+      InstrumentationPolicy::log("cpm-es-systems: System with duplicate name.", " Name: ", name);
+      throw std::runtime_error("cpm-es-systems: System with duplicate name.");
+    }
+
+    mSystemFactory.registerSystem<T>(name.c_str());
+  }
+
   /// This is only used when testing the system. It has little practical
   /// use outside of registration tests.
   void clearRegisteredSystems()
@@ -73,9 +486,54 @@ public:
   void addActiveSystem(const std::string& name, uint64_t ms = 0,
                        uint64_t referenceTime = 0, uint64_t stagger = 0);
 
+  /// Add active system via name, with typed durations. All durations are
+  /// truncated to the tick resolution.
+  void addActiveSystem(const std::string& name, std::chrono::nanoseconds interval,
+                       std::chrono::nanoseconds referenceTime = std::chrono::nanoseconds(0),
+                       std::chrono::nanoseconds stagger = std::chrono::nanoseconds(0));
+
   /// Remove active system via name.
   void removeActiveSystem(const std::string& name);
 
+  /// Splits the entities of system \p name into \p numSlices slices and
+  /// processes one slice per sub-tick, spreading the work evenly over the
+  /// system's interval. The system must derive from SliceableSystem. Each
+  /// entity is still visited once per interval (at least once, if the
+  /// interval is not a multiple of \p numSlices). Pass 1 to stop slicing.
+  /// Takes effect during the next renormalize.
+  void setSystemSlices(const std::string& name, uint32_t numSlices);
+
+  /// Makes the interval of system \p name elastic: under overload it may
+  /// grow up to \p maxMS, under light load it may shrink down to
+  /// \p minMS. The interval the system was added with must lie in between.
+  /// Pass 0 for both to make the system fixed again. See setLoadTarget.
+  /// Takes effect during the next renormalize.
+  void setSystemElasticity(const std::string& name, uint64_t minMS, uint64_t maxMS);
+
+  /// Makes the interval of system \p name elastic, with typed bounds.
+  void setSystemElasticity(const std::string& name, std::chrono::nanoseconds minInterval,
+                           std::chrono::nanoseconds maxInterval);
+
+  /// Enables overload adaptation. Every runSystems measures the time spent
+  /// scheduling and executing systems on the calling thread. After
+  /// \p settleFrames consecutive frames above \p target, the intervals of
+  /// elastic systems double; after \p settleFrames consecutive frames below
+  /// \p lowWatermark times \p target they halve again, each clamped to its
+  /// bounds. Frames in between reset both counts, so intervals only move
+  /// again once the load clearly changes. A rescaled system keeps its
+  /// stagger phase. Pass a zero \p target to disable adaptation and return
+  /// every elastic system to its requested interval.
+  void setLoadTarget(std::chrono::microseconds target, double lowWatermark = 0.5,
+                     uint32_t settleFrames = 8);
+
+  /// Number of times elastic intervals are currently doubled. Negative if
+  /// they are halved.
+  int getLoadLevel() const {return mLoadLevel;}
+
+  /// Copies the interval system \p name currently runs at into
+  /// \p interval. Returns false if the system is not active.
+  bool getEffectiveInterval(const std::string& name, std::chrono::nanoseconds& interval) const;
+
   /// Remove all active systems. Does not remove the systems immediately.
   /// Waits for a renormalize.
   void removeAllActiveSystems();
@@ -89,6 +547,16 @@ public:
     addActiveSystem(T::getName(), ms, referenceTime, stagger);
   }
 
+  /// Add active system via type, with typed durations.
+  template <typename T>
+  void addActiveSystemViaType(std::chrono::nanoseconds interval,
+                              std::chrono::nanoseconds referenceTime = std::chrono::nanoseconds(0),
+                              std::chrono::nanoseconds stagger = std::chrono::nanoseconds(0))
+  {
+    static_assert( core_detail::has_getname_fun<T>::value, "System does not expose a getName function." );
+    addActiveSystem(T::getName(), interval, referenceTime, stagger);
+  }
+
   /// Remove active system via type.
   template <typename T>
   void removeActiveSystemViaType()
@@ -109,6 +577,26 @@ public:
   /// class use the pointers passed in after the function returns.
   Tny* serializeActiveSystems();
 
+  /// Serializes only the systems that were added, removed or rescheduled
+  /// since the last call to serializeActiveSystems or
+  /// serializeActiveSystemsDelta, which together mark checkpoints. Removed
+  /// systems are written as removal records. Use restoreActiveSystems to
+  /// apply a full snapshot and its deltas, or SystemSnapshot::compact to
+  /// fold deltas into a new full snapshot.
+  /// The caller is responsible for calling Tny_free on the returned Tny*.
+  Tny* serializeActiveSystemsDelta();
+
+  /// Restores active systems from the full snapshot \p base followed by
+  /// \p deltas, in order. The snapshots are folded before any system is
+  /// created, so each system is instantiated once. Systems are placed on
+  /// the active list like with deserializeActiveSystems.
+  void restoreActiveSystems(Tny* base, const std::vector<Tny*>& deltas,
+                            uint64_t referenceTime);
+
+  /// Restores active systems, with a typed reference time.
+  void restoreActiveSystems(Tny* base, const std::vector<Tny*>& deltas,
+                            std::chrono::nanoseconds referenceTime);
+
   /// Deserializes active systems serialized within \p data.
   /// Deserialize systems. This function will create new instances of the
   /// systems serialized out with serializeAllSystems, if the systems have
@@ -121,44 +609,176 @@ public:
   /// list.
   void deserializeActiveSystems(Tny* data, uint64_t referenceTime);
 
-  /// Returns true if the system is currently active.
+  /// Deserializes active systems, with a typed reference time.
+  void deserializeActiveSystems(Tny* data, std::chrono::nanoseconds referenceTime);
+
+  /// Writes all active systems to \p writer as a record stream.
+  void writeActiveSystems(SystemRecordWriter& writer);
+
+  /// Loads the systems in the record stream \p reader, reading one record
+  /// at a time. Systems are created \p batchSize at a time and committed
+  /// straight to the active list, without waiting for renormalize. Memory
+  /// used for loading is bounded by \p batchSize, not by the size of the
+  /// stream. Removal records and systems that are already active are
+  /// skipped.
+  void loadActiveSystems(SystemRecordReader& reader, uint64_t referenceTime,
+                         size_t batchSize = 256);
+
+  /// Loads a record stream, with a typed reference time.
+  void loadActiveSystems(SystemRecordReader& reader, std::chrono::nanoseconds referenceTime,
+                         size_t batchSize = 256);
+
+  /// Returns true if the system is currently active or waiting to be
+  /// added. Simulation thread only, other threads use getActiveSystems.
   bool isSystemActive(const std::string& name) const;
 
+  /// Pins the most recently published copy of the active system list. Safe
+  /// to call from any thread and wait-free; the simulation thread never
+  /// waits for holders of the reference. A new copy is published whenever
+  /// renormalize, a stream load or overload adaptation changes the active
+  /// list or a schedule, and pinned copies are freed by a later
+  /// renormalize once released. Empty until the first such change.
+  typename PublishedValue<ActiveSystemSnapshot>::Reference getActiveSystems() const
+  {
+    return mActiveSnapshot.acquire();
+  }
+
 private:
 
+  /// Vector using the allocator policy.
+  template <typename T>
+  using Vector = std::vector<T, typename std::allocator_traits<AllocatorPolicy>::template rebind_alloc<T> >;
+
   struct SystemItem
   {
     SystemItem(const std::string& n) :
         systemName(n),
+        registeredName(nullptr),
+        prefetcher(nullptr),
+        slicer(nullptr),
+        writer(nullptr),
+        entityCounter(nullptr),
+        outputReporter(nullptr),
+        resumable(nullptr),
+        frame(nullptr),
+        wait(ResumeWait::nextTick()),
+        buckets(nullptr),
+        bucketWalker(nullptr),
+        remote(false),
+        metrics(nullptr),
+        overlapped(false),
+        node(-1),
+        worker(0),
         interval(0),
         stagger(0),
-        nextExecutionTime(0)
+        nextExecutionTime(0),
+        numSlices(1),
+        sliceCursor(0),
+        baseInterval(0),
+        minInterval(0),
+        maxInterval(0),
+        allocations(0),
+        outputStamp(0),
+        consumedStamp(0),
+        costNS(0)
     {}
 
     SystemItem(const std::string& n, std::shared_ptr<CPM_ES_NS::BaseSystem> sys,
                uint64_t updateInterval, uint64_t referenceTime, uint64_t stag) :
-        systemName(n),
         system(sys),
+        systemName(n),
+        registeredName(nullptr),
+        prefetcher(dynamic_cast<PrefetchableSystem*>(sys.get())),
+        slicer(dynamic_cast<SliceableSystem*>(sys.get())),
+        writer(dynamic_cast<ComponentWriter*>(sys.get())),
+        entityCounter(dynamic_cast<EntityCountingSystem*>(sys.get())),
+        outputReporter(dynamic_cast<OutputReportingSystem*>(sys.get())),
+        resumable(dynamic_cast<ResumableSystem*>(sys.get())),
+        frame(nullptr),
+        wait(ResumeWait::nextTick()),
+        buckets(nullptr),
+        bucketWalker(dynamic_cast<BucketedSystem*>(sys.get())),
+        remote(false),
+        metrics(nullptr),
+        overlapped(false),
+        node(-1),
+        worker(0),
         interval(updateInterval),
-        stagger(stag)
+        stagger(stag),
+        numSlices(1),
+        sliceCursor(0),
+        baseInterval(updateInterval),
+        minInterval(0),
+        maxInterval(0),
+        allocations(0),
+        outputStamp(0),
+        consumedStamp(0),
+        costNS(0)
     {
       nextExecutionTime = calcNextExecutionTime(referenceTime);
     }
 
     SystemItem(const SystemItem& other) :
-        systemName(other.systemName),
         system(other.system),
+        systemName(other.systemName),
+        registeredName(other.registeredName),
+        prefetcher(other.prefetcher),
+        slicer(other.slicer),
+        writer(other.writer),
+        entityCounter(other.entityCounter),
+        outputReporter(other.outputReporter),
+        resumable(other.resumable),
+        frame(other.frame),
+        wait(other.wait),
+        buckets(other.buckets),
+        bucketWalker(other.bucketWalker),
+        remote(other.remote),
+        metrics(other.metrics),
+        overlapped(other.overlapped),
+        node(other.node),
+        worker(other.worker),
         interval(other.interval),
         stagger(other.stagger),
-        nextExecutionTime(other.nextExecutionTime)
+        nextExecutionTime(other.nextExecutionTime),
+        numSlices(other.numSlices),
+        sliceCursor(other.sliceCursor),
+        baseInterval(other.baseInterval),
+        minInterval(other.minInterval),
+        maxInterval(other.maxInterval),
+        stats(other.stats),
+        counters(other.counters),
+        allocations(other.allocations),
+        outputStamp(other.outputStamp),
+        consumedStamp(other.consumedStamp),
+        costNS(other.costNS),
+        prewarm(other.prewarm)
     {}
 
-    // This function will modify the next execution time. Only use it when you
-    // are checking whether or not the system should execute.
-    bool shouldExecute(uint64_t referenceTime);
+    /// Sets the system of a lazily created item.
+    void attach(std::shared_ptr<CPM_ES_NS::BaseSystem> sys)
+    {
+      system = sys;
+      prefetcher = dynamic_cast<PrefetchableSystem*>(sys.get());
+      slicer = dynamic_cast<SliceableSystem*>(sys.get());
+      writer = dynamic_cast<ComponentWriter*>(sys.get());
+      entityCounter = dynamic_cast<EntityCountingSystem*>(sys.get());
+      outputReporter = dynamic_cast<OutputReportingSystem*>(sys.get());
+      resumable = dynamic_cast<ResumableSystem*>(sys.get());
+      bucketWalker = dynamic_cast<BucketedSystem*>(sys.get());
+    }
+
+    /// Interval the scheduler runs this item at. A sliced system runs
+    /// numSlices times per interval.
+    uint64_t scheduleInterval() const
+    {
+      return interval / numSlices;
+    }
 
     /// Calculate next reference time taking into account current system stagger.
-    uint64_t calcNextExecutionTime(uint64_t referenceTime);
+    uint64_t calcNextExecutionTime(uint64_t referenceTime)
+    {
+      return SchedulerPolicy::calcNextExecutionTime(referenceTime, scheduleInterval(), stagger);
+    }
 
     /// Pointer to our system.
     std::shared_ptr<CPM_ES_NS::BaseSystem>  system;
@@ -167,29 +787,491 @@ private:
     /// does not expose a getName function. We expose it at compile time.
     std::string systemName;
 
-    uint64_t    interval;           ///< Update interval in MS.
+    /// Copy of systemName owned by the factory. Unlike systemName, this
+    /// pointer stays valid when the item moves, so other threads may hold it.
+    const char* registeredName;
+
+    /// The system's prefetch hook, if it implements one.
+    PrefetchableSystem* prefetcher;
+
+    /// The system's slice walk, if it implements one.
+    SliceableSystem*    slicer;
+
+    /// The system's declared writes, or nullptr if it is read only.
+    const ComponentWriter* writer;
+
+    /// The system's entity count, if it reports one.
+    const EntityCountingSystem* entityCounter;
+
+    /// The system's output report, if it implements one.
+    const OutputReportingSystem* outputReporter;
+
+    /// The system's resumable work, if it has any, its frame from
+    /// mFramePool while the work is in progress, and what it waits for.
+    /// The item in mSystems owns the frame.
+    ResumableSystem*    resumable;
+    void*               frame;
+    ResumeWait          wait;
+
+    /// The system's level of detail buckets, owned by mEntityBuckets, and
+    /// its walk over them.
+    EntityBuckets*      buckets;
+    BucketedSystem*     bucketWalker;
+
+    /// True if another shard runs the system.
+    bool                remote;
+
+    /// The system's live counters, if metrics are attached.
+    SchedulerMetrics::Cell* metrics;
+
+    /// True if the system runs on the overlap thread.
+    bool                overlapped;
+
+    /// Preferred NUMA node, or -1, and the pool worker that runs the
+    /// system when it is overlapped.
+    int                 node;
+    uint32_t            worker;
+
+    uint64_t    interval;           ///< Update interval in ticks.
     uint64_t    stagger;            ///< Offset into interval, relative to reference time,
                                     ///< at which this system should execute.
                                     ///< Used to stagger system execution in a
                                     ///< predictable way.
-    uint64_t    nextExecutionTime;  ///< Next execution time in MS from reference.
+    uint64_t    nextExecutionTime;  ///< Next execution time in ticks from reference.
+    uint32_t    numSlices;          ///< Number of slices per interval. 1 if not sliced.
+    uint32_t    sliceCursor;        ///< Slice walked on the next execution.
+    uint64_t    baseInterval;       ///< Interval the system was added with.
+                                    ///< interval differs only if elastic.
+    uint64_t    minInterval;        ///< Elasticity bounds in ticks. Both 0
+    uint64_t    maxInterval;        ///< if the interval is fixed.
+
+    SystemTimingStats stats;        ///< Only recorded if timing statistics are on.
+    SystemCounterStats counters;    ///< Only recorded if hardware counters are on.
+    uint64_t    allocations;        ///< Only counted if allocation tracking is on.
+    uint64_t    outputStamp;        ///< Output clock when this system last produced.
+    uint64_t    consumedStamp;      ///< Output clock when this system last ran.
+    double      costNS;             ///< Smoothed execution cost, 0 if unknown.
+
+    /// Expected cost per tick, given the average cost \p fallbackNS for
+    /// systems without one.
+    double tickCost(double fallbackNS) const
+    {
+      uint64_t every = scheduleInterval();
+      return (costNS != 0 ? costNS : fallbackNS) / static_cast<double>(every == 0 ? 1 : every);
+    }
+
+    /// Pending construction on the prewarm thread, if any. system is
+    /// nullptr until the item is instantiated.
+    std::shared_ptr<PrewarmWorker::Request> prewarm;
   };
 
   static bool systemCompare(const SystemItem& a, const SystemItem& b);
 
+  /// Conversions from external units to ticks.
+  uint64_t msToTicks(uint64_t ms) const {return ms * (1000000 / mClock.tickNS());}
+  uint64_t toTicks(std::chrono::nanoseconds d) const
+  {
+    return static_cast<uint64_t>(d.count()) / mClock.tickNS();
+  }
+
+  /// Implementations of the public functions above, in ticks.
+  void runTicks(CPM_ES_NS::ESCoreBase& core, uint64_t referenceTime);
+  void addActiveSystemTicks(const std::string& name, uint64_t interval,
+                            uint64_t referenceTime, uint64_t stagger);
+  void deserializeActiveSystemsTicks(Tny* data, uint64_t referenceTime);
+  void restoreActiveSystemsTicks(Tny* base, const std::vector<Tny*>& deltas,
+                                 uint64_t referenceTime);
+
+  /// Snapshot record describing \p item. mSchedule must be synced.
+  SystemSnapshotRecord makeRecord(const SystemItem& item) const;
+
+  void loadActiveSystemsTicks(SystemRecordReader& reader, uint64_t referenceTime,
+                              size_t batchSize);
+
+  /// Merges the systems loadActiveSystems appended behind the first
+  /// \p numSorted, sorted ones into the active list and rebuilds the
+  /// schedule.
+  void commitLoadedSystems(size_t numSorted);
+
+  /// Creates the system \p name as described by \p record and appends it to
+  /// \p out.
+  void applyRecord(const std::string& name, const SystemSnapshotRecord& record,
+                   uint64_t referenceTime, Vector<SystemItem>& out);
+
+  /// Creates the system \p name and appends it to \p out. Returns false if
+  /// \p name is not registered.
+  bool createItem(const std::string& name, uint64_t interval, uint64_t referenceTime,
+                  uint64_t stagger, Vector<SystemItem>& out);
+
+  /// Walks the components of \p item, or its current slice if it is sliced.
+  static void executeItem(SystemItem& item, CPM_ES_NS::ESCoreBase& core)
+  {
+    if (item.numSlices > 1)
+    {
+      item.slicer->walkComponentsSlice(core, item.sliceCursor, item.numSlices);
+      item.sliceCursor = (item.sliceCursor + 1) % item.numSlices;
+    }
+    else
+    {
+      item.system->walkComponents(core);
+    }
+  }
+
+  /// Interval of the elastic \p item at load level \p level.
+  static uint64_t elasticInterval(const SystemItem& item, int level);
+
+  /// Moves \p item to \p interval, keeping its stagger phase. The next
+  /// execution is the first stagger point after \p referenceTime.
+  static void rescaleItem(SystemItem& item, uint64_t interval, uint64_t referenceTime);
+
+  /// Applies \p level to every elastic system. Returns false, changing
+  /// nothing, if no interval would change.
+  bool applyLoadLevel(int level);
+
+  /// Feeds the cost of the frame that just ran to overload adaptation.
+  void adaptToLoad(uint64_t frameUS);
+
+  /// Splits \p item into \p numSlices slices, keeping its stagger phase.
+  /// Returns false, leaving the item untouched, if it cannot be sliced.
+  static bool applySlices(SystemItem& item, uint32_t numSlices, uint32_t cursor);
+
+  /// Applies pending additions, removals and slice changes.
+  void renormalizeChanges();
+
+  /// Runs one worker's share of the overlapped systems. Called on that
+  /// worker.
+  static void runOverlapJob(void* context);
+
+  /// Arguments of runOverlapJob.
+  struct OverlapJob
+  {
+    BasicSystemCore*  self;
+    size_t            worker;
+  };
+
+  /// Constructs a system on a pool worker.
+  struct CreateJob
+  {
+    SystemFactory*                          factory;
+    const char*                             name;
+    std::shared_ptr<CPM_ES_NS::BaseSystem>  system;
+    std::exception_ptr                      error;
+  };
+  static void runCreateJob(void* context);
+
+  /// Constructs the system \p name, on a worker of \p node if there is
+  /// one. Returns nullptr if \p name is not registered.
+  std::shared_ptr<CPM_ES_NS::BaseSystem> newSystem(const std::string& name, int node);
+
+  /// Constructs the system of the lazily created \p item.
+  void instantiate(SystemItem& item);
+
+  /// Hands lazy systems due within the prewarm window to the prewarm
+  /// thread.
+  void prewarmDue(uint64_t referenceTime);
+
+  /// Executes \p item, resuming it if it is resumable and walking its due
+  /// buckets if it has any.
+  void runItem(SystemItem& item, CPM_ES_NS::ESCoreBase& core, uint64_t referenceTime)
+  {
+    if (item.resumable != nullptr)
+      resumeItem(item, core);
+    else if (item.buckets != nullptr && item.bucketWalker != nullptr)
+      item.buckets->run(core, *item.bucketWalker, referenceTime);
+    else
+      executeItem(item, core);
+  }
+
+  /// Leader: assigns every active system to a shard and publishes the
+  /// table.
+  void assignShards();
+
+  /// Follower: picks up the leader's table.
+  void syncShards();
+
+  /// Points the items of system \p name at \p buckets.
+  void attachBuckets(const std::string& name, EntityBuckets* buckets);
+
+  /// The buckets of system \p name, created if it has none. Throws if it
+  /// has none and \p create is false.
+  EntityBuckets& findBuckets(const std::string& name, bool create);
+
+  /// Resumes the resumable \p item, starting a fresh frame if it has none.
+  void resumeItem(SystemItem& item, CPM_ES_NS::ESCoreBase& core);
+
+  /// Destroys the frame of \p item, if it has one.
+  void releaseFrame(SystemItem& item);
+
+  /// Grows mFramePool so that every active resumable system can start
+  /// without allocating.
+  void reserveFrames();
+
+  /// Resolves mDependencies between active systems into mProducerOffsets
+  /// and mProducers.
+  void buildDependencyGraph();
+
+  /// True if the system at mSystems index \p index is not gated or one of
+  /// its producers produced since it last ran.
+  bool hasNewInput(uint32_t index) const
+  {
+    uint64_t consumed = mSystems[index].consumedStamp;
+    for (uint32_t k = mProducerOffsets[index]; k != mProducerOffsets[index + 1]; ++k)
+    {
+      if (mSystems[mProducers[k]].outputStamp > consumed)
+        return true;
+    }
+    return mProducerOffsets[index] == mProducerOffsets[index + 1];
+  }
+
+  /// Advances the output clock for \p item, which just ran.
+  void stampOutput(SystemItem& item)
+  {
+    item.consumedStamp = mOutputClock;
+    if (item.outputReporter == nullptr || item.outputReporter->producedOutput())
+      item.outputStamp = ++mOutputClock;
+  }
+
+  /// Decides which systems may run on the overlap thread.
+  void classifyOverlap();
+
+  /// Copies the timing state held in mSchedule back into mSystems.
+  void syncScheduleToItems();
+
+  /// Rebuilds mExecutionOrder and mSchedule from the timing state held in
+  /// mSystems.
+  void rebuildSchedule();
+
+  /// Gives every active system its metrics cell and publishes which
+  /// systems are active.
+  void publishActiveMetrics();
+
+  /// Publishes a copy of mSystems for other threads.
+  void publishActiveSystems();
+
+  /// Publishes the active count and pending queue depths.
+  void publishQueueMetrics()
+  {
+    if (mMetrics)
+      mMetrics->setQueues(mSystems.size(), mSystemsToAdd.size(), mSystemsToRemove.size());
+  }
+
+  /// Brings the next execution times in mSchedule up to date after frames
+  /// were dispatched from the precompiled schedule.
+  void materializeSchedule();
+
+  /// Collects all systems due according to the dynamic schedule into
+  /// mDueList.
+  void collectDynamicSchedule(uint64_t referenceTime);
+
+  /// Executes the systems at execution order indices [first, last),
+  /// handing overlapped systems to the overlap thread.
+  void dispatchPipelined(CPM_ES_NS::ESCoreBase& core, const uint32_t* first,
+                         const uint32_t* last, uint64_t referenceTime,
+                         bool fromTable);
+
+  /// Executes the systems at execution order indices [first, last).
+  /// \p fromTable is true if they were read from the precompiled schedule,
+  /// so mSchedule does not know when they were due.
+  void dispatchSystems(CPM_ES_NS::ESCoreBase& core, const uint32_t* first,
+                       const uint32_t* last, uint64_t referenceTime,
+                       bool fromTable);
+
+  /// Tick length.
+  ClockPolicy               mClock;
+
   /// Alphabetically sorted system list. Executed in alphabetical order.
-  std::vector<SystemItem>   mSystems;
+  /// The timing fields of these items are only current after
+  /// syncScheduleToItems, mSchedule holds the authoritative values.
+  Vector<SystemItem>        mSystems;
+
+  /// Order in which mSystems execute. Entry k is the index into mSystems of
+  /// the k'th system to execute. Identity unless affinity ordering is on.
+  Vector<uint32_t>          mExecutionOrder;
+  bool                      mUseAffinityOrdering;
+
+  /// Timing state of mSystems in structure-of-arrays form. Indexed in
+  /// execution order, that is entry k belongs to mSystems[mExecutionOrder[k]].
+  SchedulerPolicy           mSchedule;
+
+  /// Due bitmask produced by mSchedule every frame. Kept around so that
+  /// runSystems does not allocate.
+  std::vector<uint64_t>     mDueMask;
+
+  /// Execution order indices of the systems due this frame, expanded from
+  /// mDueMask.
+  Vector<uint32_t>          mDueList;
+
+  /// Per system flags used to collect several ticks of the precompiled
+  /// schedule without duplicates. All zero between frames.
+  Vector<uint8_t>           mDueSeen;
+
+  /// Prefetching of the next due system's components.
+  PrefetchMode                    mPrefetchMode;
+  std::unique_ptr<PrefetchWorker> mPrefetchWorker;
+
+  /// Timing statistics and overrun detection.
+  bool                            mRecordTiming;
+  std::unique_ptr<SystemWatchdog> mWatchdog;
+
+  /// Hardware counters of the thread that enabled them, or null.
+  std::unique_ptr<PerfCounterGroup> mCounters;
+  bool                            mCountersUnavailableLogged;
+
+  /// Allocation tracking. Counts are kept in fixed storage so that tracking
+  /// does not allocate itself.
+  bool                            mTrackAllocations;
+  uint64_t                        mPhaseAllocations[NUM_SCHEDULER_PHASES];
+
+  /// Cost tracking. mCostProfile holds the loaded costs, which seed
+  /// systems as they are added.
+  bool                            mTrackCost;
+  double                          mCostSmoothing;
+  CostProfile                     mCostProfile;
+
+  /// Current allocation count if tracking, otherwise 0.
+  uint64_t allocationMark() const
+  {
+    return mTrackAllocations ? allocation_counter::current() : 0;
+  }
+
+  /// Adds the allocations made since \p mark to \p counter.
+  void addAllocationsSince(uint64_t mark, uint64_t& counter) const
+  {
+    if (mTrackAllocations)
+      counter += allocation_counter::current() - mark;
+  }
+
+  /// Precompiled schedule. Only valid when mUsePrecompiledSchedule is set
+  /// and the hyperperiod of mSystems is small enough.
+  HyperperiodSchedule       mHyperperiod;
+  bool                      mUsePrecompiledSchedule;
+  uint64_t                  mMaxHyperperiod;
+
+  /// Reference time of the previous call to runSystems. The precompiled
+  /// schedule is only exact for consecutive ticks.
+  bool                      mHasLastReferenceTime;
+  uint64_t                  mLastReferenceTime;
+
+  /// Set when frames were dispatched from mHyperperiod, in which case the
+  /// next execution times in mSchedule have not been advanced.
+  bool                      mScheduleStale;
+
+  /// Pipelined execution. mWorkerLists and mSerialList split the systems
+  /// due this frame by thread.
+  Vector<std::shared_ptr<DoubleBufferBase> > mDoubleBuffers;
+  bool                      mPipelined;
+  Vector<Vector<uint32_t> > mWorkerLists;
+  Vector<OverlapJob>        mWorkerJobs;
+  Vector<uint32_t>          mSerialList;
+  CPM_ES_NS::ESCoreBase*    mOverlapCore;
+
+  /// Preferred NUMA node by system name.
+  std::map<std::string, int> mNodePreferences;
+
+  /// Level of detail buckets by system name.
+  std::map<std::string, std::unique_ptr<EntityBuckets> > mEntityBuckets;
+
+  /// Multi-process sharding, or nullptr. mShardTable is reused to publish
+  /// and read the table. mShardStale is set when mSystems changed since a
+  /// follower last read it.
+  ShardCoordinator*         mShard;
+  std::chrono::milliseconds mShardTimeout;
+  std::map<std::string, int> mShardPreferences;
+  std::vector<ShardCoordinator::Entry> mShardTable;
+  uint64_t                  mShardGeneration;
+  bool                      mShardStale;
+
+  /// Declared after mSystems, so it is joined before the systems it runs
+  /// are destroyed.
+  std::unique_ptr<WorkerPool> mWorkerPool;
+
+  /// Recording of scheduler activity, or nullptr.
+  ScheduleRecorder*         mRecorder;
+
+  /// Live counters, or nullptr. The generation stamps the cells of the
+  /// active systems on every publish.
+  SchedulerMetrics*         mMetrics;
+  uint64_t                  mMetricsGeneration;
+
+  /// Active systems as of the last checkpoint. Deltas are computed against
+  /// it.
+  SystemSnapshot            mCheckpoint;
 
   /// Systems to add during renormalization.
-  std::vector<SystemItem>   mSystemsToAdd;
+  Vector<SystemItem>        mSystemsToAdd;
 
   /// Systems to remove during renormalize.
-  std::vector<std::string>  mSystemsToRemove;
+  Vector<std::string>       mSystemsToRemove;
+
+  /// Slice changes to apply during renormalize.
+  Vector<std::pair<std::string, uint32_t>> mSliceChanges;
+
+  /// Elasticity bounds to apply during renormalize.
+  struct ElasticityChange
+  {
+    std::string name;
+    uint64_t    minInterval;
+    uint64_t    maxInterval;
+  };
+  Vector<ElasticityChange>  mElasticityChanges;
+
+  /// Overload adaptation. Disabled while mLoadTargetUS is 0.
+  uint64_t                  mLoadTargetUS;
+  double                    mLowWatermark;
+  uint32_t                  mSettleFrames;
+  uint32_t                  mOverloadedFrames;
+  uint32_t                  mUnderloadedFrames;
+  int                       mLoadLevel;
 
   /// Factory that stores all registered systems.
   SystemFactory      mSystemFactory;
+
+  /// Lazy instantiation. mLazyOrder holds the indices of the systems not
+  /// yet constructed, by first execution time, up to mLazyCursor handed to
+  /// the prewarm thread. mOverlapStale is set when a constructed system may
+  /// change which systems can overlap.
+  bool                      mLazy;
+  std::chrono::nanoseconds  mPrewarm;
+  Vector<uint32_t>          mLazyOrder;
+  size_t                    mLazyCursor;
+  bool                      mOverlapStale;
+
+  /// Declared after mSystemFactory, so it is joined before the factory it
+  /// reads is destroyed.
+  std::unique_ptr<PrewarmWorker> mPrewarmWorker;
+
+  /// Output driven execution. mDependencies holds (consumer, producer)
+  /// name pairs as declared. The producers of mSystems[i] are
+  /// mProducers[mProducerOffsets[i]] up to mProducerOffsets[i + 1], as
+  /// mSystems indices. mLinked marks systems with an edge.
+  std::set<std::pair<std::string, std::string> > mDependencies;
+  struct DependencyChange
+  {
+    std::string producer;
+    std::string consumer;
+    bool        add;
+  };
+  Vector<DependencyChange>  mDependencyChanges;
+  bool                      mOutputDriven;
+  uint64_t                  mOutputClock;
+  Vector<uint32_t>          mProducerOffsets;
+  Vector<uint32_t>          mProducers;
+  Vector<char>              mLinked;
+
+  /// Frames of resumable systems. The destructor destroys the frames still
+  /// in use.
+  FramePool                 mFramePool;
+
+  /// Copies of mSystems published for other threads.
+  PublishedValue<ActiveSystemSnapshot> mActiveSnapshot;
+  uint64_t                  mActiveGeneration;
 };
 
+/// The system core with default policies.
+typedef BasicSystemCore<> SystemCore;
+
+extern template class BasicSystemCore<>;
+
 } // namespace CPM_ES_SYSTEMS_NS 
 
 #endif
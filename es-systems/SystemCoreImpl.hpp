@@ -0,0 +1,2098 @@
+#ifndef IAUNS_ES_SYSTEMS_SYSTEMCOREIMPL_HPP
+#define IAUNS_ES_SYSTEMS_SYSTEMCOREIMPL_HPP
+
+// Member definitions of BasicSystemCore. SystemCore.cpp instantiates the
+// default policies. Include this header only when instantiating
+// BasicSystemCore with policies of your own.
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#include "SystemCore.hpp"
+
+#define CPM_ES_SYSTEMS_CORE_TEMPLATE \
+  template <typename SchedulerPolicy, typename ClockPolicy, \
+            typename InstrumentationPolicy, typename AllocatorPolicy>
+#define CPM_ES_SYSTEMS_CORE \
+  BasicSystemCore<SchedulerPolicy, ClockPolicy, InstrumentationPolicy, AllocatorPolicy>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+CPM_ES_SYSTEMS_CORE::~BasicSystemCore()
+{
+  if (mWorkerPool)
+    mWorkerPool->waitAll();
+  for (SystemItem& item : mSystems)
+    releaseFrame(item);
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::runSystems(CPM_ES_NS::ESCoreBase& core, uint64_t referenceTime)
+{
+  runTicks(core, msToTicks(referenceTime));
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::runSystems(CPM_ES_NS::ESCoreBase& core, std::chrono::nanoseconds referenceTime)
+{
+  runTicks(core, toTicks(referenceTime));
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setTickResolution(TickResolution resolution)
+{
+  if (!mSystems.empty() || !mSystemsToAdd.empty())
+  {
+    InstrumentationPolicy::log("cpm-es-system: Tick resolution changed with active systems.");
+    throw std::runtime_error("cpm-es-system: Tick resolution changed with active systems.");
+  }
+
+  uint64_t tickNS = 1000000;
+  switch (resolution)
+  {
+    case TICK_NANOSECONDS:  tickNS = 1;        break;
+    case TICK_MICROSECONDS: tickNS = 1000;     break;
+    case TICK_MILLISECONDS: tickNS = 1000000;  break;
+  }
+
+  if (!mClock.setTickNS(tickNS))
+  {
+    InstrumentationPolicy::log("cpm-es-system: Tick resolution not supported by clock policy.");
+    throw std::runtime_error("cpm-es-system: Tick resolution not supported by clock policy.");
+  }
+  if (mRecorder)
+    mRecorder->tickLength(tickNS);
+  mHasLastReferenceTime = false;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::runTicks(CPM_ES_NS::ESCoreBase& core, uint64_t referenceTime)
+{
+  if (mShard != nullptr)
+  {
+    if (mShard->isLeader())
+      mShard->beginFrame(referenceTime);
+    else if (mShardStale || mShard->tableGeneration() != mShardGeneration)
+      syncShards();
+  }
+
+  // A system constructed last frame may write what overlapped systems read.
+  if (mOverlapStale)
+  {
+    classifyOverlap();
+    mOverlapStale = false;
+  }
+
+  if (mRecorder)
+    mRecorder->frame(referenceTime);
+
+  std::chrono::steady_clock::time_point frameStart;
+  if (mLoadTargetUS != 0)
+    frameStart = std::chrono::steady_clock::now();
+
+  // The precompiled schedule knows which systems hit a stagger point on
+  // every tick, so the ticks since the last frame are read from it. A
+  // repeated tick, or a gap longer than the table, needs the dynamic
+  // scheduler.
+  uint64_t mark = allocationMark();
+  if (mHyperperiod.valid() && mHasLastReferenceTime
+      && referenceTime > mLastReferenceTime
+      && referenceTime - mLastReferenceTime <= mHyperperiod.hyperperiod())
+  {
+    const uint32_t* first;
+    const uint32_t* last;
+    if (referenceTime == mLastReferenceTime + 1)
+    {
+      mHyperperiod.dueRange(referenceTime, first, last);
+    }
+    else
+    {
+      mHyperperiod.dueBetween(mLastReferenceTime, referenceTime, mDueList, mDueSeen);
+      first = mDueList.data();
+      last = mDueList.data() + mDueList.size();
+    }
+    addAllocationsSince(mark, mPhaseAllocations[PHASE_SCHEDULE]);
+
+    mark = allocationMark();
+    dispatchPipelined(core, first, last, referenceTime, true);
+    mScheduleStale = true;
+  }
+  else
+  {
+    materializeSchedule();
+    collectDynamicSchedule(referenceTime);
+    addAllocationsSince(mark, mPhaseAllocations[PHASE_SCHEDULE]);
+
+    mark = allocationMark();
+    dispatchPipelined(core, mDueList.data(), mDueList.data() + mDueList.size(),
+                      referenceTime, false);
+  }
+  addAllocationsSince(mark, mPhaseAllocations[PHASE_DISPATCH]);
+
+  if (mPrewarm.count() > 0)
+    prewarmDue(referenceTime);
+
+  // Overlapped systems walk the core's containers. Join them so the caller
+  // may change the core as soon as runSystems returns.
+  if (mWorkerPool)
+    mWorkerPool->waitAll();
+
+  mHasLastReferenceTime = true;
+  mLastReferenceTime = referenceTime;
+
+  if (mLoadTargetUS != 0)
+  {
+    adaptToLoad(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - frameStart).count()));
+  }
+
+  if (mShard != nullptr)
+  {
+    if (!mShard->finishFrame(mShardTimeout))
+      InstrumentationPolicy::log("cpm-es-system: Shards missed the frame barrier at ", referenceTime, ".");
+  }
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::adaptToLoad(uint64_t frameUS)
+{
+  // Frames between the watermarks reset both counts. That dead band, plus
+  // requiring several frames in a row, keeps intervals from flapping.
+  if (frameUS > mLoadTargetUS)
+  {
+    mUnderloadedFrames = 0;
+    if (++mOverloadedFrames >= mSettleFrames)
+    {
+      mOverloadedFrames = 0;
+      applyLoadLevel(mLoadLevel + 1);
+    }
+  }
+  else if (static_cast<double>(frameUS) < mLowWatermark * static_cast<double>(mLoadTargetUS))
+  {
+    mOverloadedFrames = 0;
+    if (++mUnderloadedFrames >= mSettleFrames)
+    {
+      mUnderloadedFrames = 0;
+      applyLoadLevel(mLoadLevel - 1);
+    }
+  }
+  else
+  {
+    mOverloadedFrames = 0;
+    mUnderloadedFrames = 0;
+  }
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+uint64_t CPM_ES_SYSTEMS_CORE::elasticInterval(const SystemItem& item, int level)
+{
+  uint64_t interval = item.baseInterval;
+  for (int i = 0; i < level && interval < item.maxInterval; ++i)
+    interval *= 2;
+  for (int i = 0; i > level && interval > item.minInterval; --i)
+    interval /= 2;
+
+  if (interval > item.maxInterval) interval = item.maxInterval;
+  if (interval < item.minInterval) interval = item.minInterval;
+  if (interval < item.numSlices)   interval = item.numSlices;
+  return interval;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::rescaleItem(SystemItem& item, uint64_t interval, uint64_t referenceTime)
+{
+  // The stagger is kept, so the system lands on the same phase of the new
+  // interval.
+  item.interval = interval;
+  item.nextExecutionTime = item.calcNextExecutionTime(referenceTime);
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+bool CPM_ES_SYSTEMS_CORE::applyLoadLevel(int level)
+{
+  // Levels past the point where every elastic system sits at a bound would
+  // only have to be unwound again.
+  bool changed = false;
+  for (const SystemItem& item : mSystems)
+  {
+    if (item.maxInterval != 0 && elasticInterval(item, level) != item.interval)
+      changed = true;
+  }
+  if (!changed)
+    return false;
+
+  syncScheduleToItems();
+  for (SystemItem& item : mSystems)
+  {
+    if (item.maxInterval == 0)
+      continue;
+    uint64_t interval = elasticInterval(item, level);
+    if (interval != item.interval)
+    {
+      rescaleItem(item, interval, mHasLastReferenceTime ? mLastReferenceTime + 1
+                                                        : item.nextExecutionTime);
+    }
+  }
+  mLoadLevel = level;
+  rebuildSchedule();
+  return true;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setSystemElasticity(const std::string& name, uint64_t minMS,
+                                              uint64_t maxMS)
+{
+  ElasticityChange change = {name, msToTicks(minMS), msToTicks(maxMS)};
+  mElasticityChanges.push_back(change);
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setSystemElasticity(const std::string& name,
+                                              std::chrono::nanoseconds minInterval,
+                                              std::chrono::nanoseconds maxInterval)
+{
+  ElasticityChange change = {name, toTicks(minInterval), toTicks(maxInterval)};
+  mElasticityChanges.push_back(change);
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setLoadTarget(std::chrono::microseconds target, double lowWatermark,
+                                        uint32_t settleFrames)
+{
+  mLoadTargetUS = target.count() > 0 ? static_cast<uint64_t>(target.count()) : 0;
+  mLowWatermark = lowWatermark;
+  mSettleFrames = settleFrames == 0 ? 1 : settleFrames;
+  mOverloadedFrames = 0;
+  mUnderloadedFrames = 0;
+
+  if (mLoadTargetUS == 0 && mLoadLevel != 0)
+  {
+    applyLoadLevel(0);
+    mLoadLevel = 0;
+  }
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+bool CPM_ES_SYSTEMS_CORE::getEffectiveInterval(const std::string& name,
+                                               std::chrono::nanoseconds& interval) const
+{
+  auto it = std::lower_bound(mSystems.cbegin(), mSystems.cend(),
+                             SystemItem(name), systemCompare);
+  if (it != mSystems.end() && it->systemName == name)
+  {
+    interval = std::chrono::nanoseconds(it->interval * mClock.tickNS());
+    return true;
+  }
+  return false;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::collectDynamicSchedule(uint64_t referenceTime)
+{
+  // Check every system at once against the reference time, then only touch
+  // the items that are due. Bits are visited in ascending order, so systems
+  // still execute in the order given by mExecutionOrder.
+  size_t numDue = mSchedule.computeDueMask(referenceTime, mDueMask);
+
+  mDueList.resize(numDue);
+  size_t n = 0;
+  size_t numWords = (mSchedule.size() + SchedulerPolicy::BitsPerWord - 1) / SchedulerPolicy::BitsPerWord;
+  for (size_t w = 0; w < numWords; ++w)
+  {
+    for (uint64_t bits = mDueMask[w]; bits != 0; bits &= bits - 1)
+    {
+      mDueList[n++] = static_cast<uint32_t>(w * SchedulerPolicy::BitsPerWord
+                                            + SchedulerPolicy::lowestSetBit(bits));
+    }
+  }
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::dispatchPipelined(CPM_ES_NS::ESCoreBase& core, const uint32_t* first,
+                                            const uint32_t* last, uint64_t referenceTime,
+                                            bool fromTable)
+{
+  if (!mPipelined || !mWorkerPool)
+  {
+    dispatchSystems(core, first, last, referenceTime, fromTable);
+    return;
+  }
+
+  for (Vector<uint32_t>& list : mWorkerLists)
+    list.clear();
+  mSerialList.clear();
+  for (; first != last; ++first)
+  {
+    const SystemItem& item = mSystems[mExecutionOrder[*first]];
+    if (item.overlapped)
+      mWorkerLists[item.worker].push_back(*first);
+    else
+      mSerialList.push_back(*first);
+  }
+
+  mOverlapCore = &core;
+  for (size_t w = 0; w < mWorkerLists.size(); ++w)
+  {
+    if (!mWorkerLists[w].empty())
+    {
+      mWorkerJobs[w].self = this;
+      mWorkerJobs[w].worker = w;
+      mWorkerPool->submit(w, &BasicSystemCore::runOverlapJob, &mWorkerJobs[w]);
+    }
+  }
+  dispatchSystems(core, mSerialList.data(), mSerialList.data() + mSerialList.size(),
+                  referenceTime, fromTable);
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::runOverlapJob(void* context)
+{
+  OverlapJob* job = static_cast<OverlapJob*>(context);
+  BasicSystemCore* self = job->self;
+  for (uint32_t k : self->mWorkerLists[job->worker])
+  {
+    executeItem(self->mSystems[self->mExecutionOrder[k]], *self->mOverlapCore);
+  }
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::runCreateJob(void* context)
+{
+  CreateJob* job = static_cast<CreateJob*>(context);
+  try
+  {
+    job->system = job->factory->newSystemFromName(job->name);
+  }
+  catch (...)
+  {
+    job->error = std::current_exception();
+  }
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setLazyInstantiation(bool enabled, std::chrono::nanoseconds prewarm)
+{
+  mLazy = enabled;
+  mPrewarm = enabled ? prewarm : std::chrono::nanoseconds(0);
+  if (mPrewarm.count() > 0 && !mPrewarmWorker)
+    mPrewarmWorker.reset(new PrewarmWorker());
+  mLazyCursor = 0;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+bool CPM_ES_SYSTEMS_CORE::isSystemInstantiated(const std::string& name) const
+{
+  auto it = std::lower_bound(mSystems.cbegin(), mSystems.cend(),
+                             SystemItem(name), systemCompare);
+  return it != mSystems.end() && it->systemName == name && it->system != nullptr;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::resumeItem(SystemItem& item, CPM_ES_NS::ESCoreBase& core)
+{
+  if (item.frame == nullptr)
+  {
+    item.frame = mFramePool.allocate(item.resumable->frameSize());
+    item.resumable->constructFrame(item.frame);
+    item.wait = ResumeWait::nextTick();
+  }
+  else if (item.wait.kind == ResumeWait::EVENT && !item.wait.event->isSet())
+  {
+    return;
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (;;)
+  {
+    item.wait = item.resumable->resumeFrame(core, item.frame);
+    if (item.wait.kind == ResumeWait::DONE)
+    {
+      releaseFrame(item);
+      return;
+    }
+    if (item.wait.kind != ResumeWait::BUDGET)
+      return;
+
+    uint64_t elapsed = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    if (elapsed >= item.wait.budgetNS)
+      return;
+  }
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::releaseFrame(SystemItem& item)
+{
+  if (item.frame == nullptr)
+    return;
+  item.resumable->destroyFrame(item.frame);
+  mFramePool.release(item.frame, item.resumable->frameSize());
+  item.frame = nullptr;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::reserveFrames()
+{
+  Vector<size_t> sizes;
+  for (const SystemItem& item : mSystems)
+  {
+    if (item.resumable != nullptr)
+      sizes.push_back(FramePool::blockSize(item.resumable->frameSize()));
+  }
+  std::sort(sizes.begin(), sizes.end());
+  for (size_t i = 0; i < sizes.size();)
+  {
+    size_t end = i;
+    while (end < sizes.size() && sizes[end] == sizes[i])
+      ++end;
+    mFramePool.reserve(sizes[i], end - i);
+    i = end;
+  }
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+uint32_t CPM_ES_SYSTEMS_CORE::addEntityBucket(const std::string& name, uint64_t ms,
+                                              uint64_t staggerMS)
+{
+  return findBuckets(name, true).addBucket(msToTicks(ms), msToTicks(staggerMS));
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+uint32_t CPM_ES_SYSTEMS_CORE::addEntityBucket(const std::string& name,
+                                              std::chrono::nanoseconds interval,
+                                              std::chrono::nanoseconds stagger)
+{
+  return findBuckets(name, true).addBucket(toTicks(interval), toTicks(stagger));
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setEntityBucket(const std::string& name, uint64_t entityID,
+                                          uint32_t bucket)
+{
+  findBuckets(name, false).assign(entityID, bucket);
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::removeBucketedEntity(const std::string& name, uint64_t entityID)
+{
+  findBuckets(name, false).remove(entityID);
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setBucketClassifier(const std::string& name,
+                                              EntityBuckets::Classifier classifier)
+{
+  findBuckets(name, false).setClassifier(classifier);
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::clearEntityBuckets(const std::string& name)
+{
+  auto it = mEntityBuckets.find(name);
+  if (it == mEntityBuckets.end())
+    return;
+  attachBuckets(name, nullptr);
+  mEntityBuckets.erase(it);
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+const EntityBuckets* CPM_ES_SYSTEMS_CORE::getEntityBuckets(const std::string& name) const
+{
+  auto it = mEntityBuckets.find(name);
+  return it == mEntityBuckets.end() ? nullptr : it->second.get();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+EntityBuckets& CPM_ES_SYSTEMS_CORE::findBuckets(const std::string& name, bool create)
+{
+  auto it = mEntityBuckets.find(name);
+  if (it != mEntityBuckets.end())
+    return *it->second;
+
+  if (!create)
+  {
+    InstrumentationPolicy::log("cpm-es-system: System ", name, " has no entity buckets.");
+    throw std::runtime_error("cpm-es-system: System has no entity buckets.");
+  }
+
+  EntityBuckets* buckets = new EntityBuckets();
+  mEntityBuckets[name].reset(buckets);
+  attachBuckets(name, buckets);
+  return *buckets;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::attachBuckets(const std::string& name, EntityBuckets* buckets)
+{
+  // The system may be running on the pool and is about to stop overlapping.
+  if (mWorkerPool)
+    mWorkerPool->waitAll();
+
+  for (SystemItem& item : mSystems)
+  {
+    if (item.systemName == name)
+      item.buckets = buckets;
+  }
+  for (SystemItem& item : mSystemsToAdd)
+  {
+    if (item.systemName == name)
+      item.buckets = buckets;
+  }
+  classifyOverlap();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setShardCoordinator(ShardCoordinator* coordinator,
+                                              std::chrono::milliseconds barrierTimeout)
+{
+  if (mWorkerPool)
+    mWorkerPool->waitAll();
+
+  mShard = coordinator;
+  mShardTimeout = barrierTimeout;
+  if (mShard == nullptr)
+  {
+    for (SystemItem& item : mSystems)
+      item.remote = false;
+  }
+  else if (mShard->isLeader())
+  {
+    assignShards();
+  }
+  else
+  {
+    mShardStale = true;
+  }
+  classifyOverlap();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setSystemShard(const std::string& name, int shard)
+{
+  if (shard < 0)
+    mShardPreferences.erase(name);
+  else
+    mShardPreferences[name] = shard;
+
+  if (mShard != nullptr && mShard->isLeader())
+  {
+    if (mWorkerPool)
+      mWorkerPool->waitAll();
+    assignShards();
+    classifyOverlap();
+  }
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+bool CPM_ES_SYSTEMS_CORE::isSystemLocal(const std::string& name) const
+{
+  auto it = std::lower_bound(mSystems.cbegin(), mSystems.cend(),
+                             SystemItem(name), systemCompare);
+  return it != mSystems.end() && it->systemName == name && !it->remote;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::assignShards()
+{
+  uint32_t numShards = mShard->numShards();
+  std::vector<uint32_t> shards(mSystems.size(), 0);
+  std::vector<bool> pinned(mSystems.size(), false);
+  std::vector<uint32_t> open;
+  double totalCost = 0.0;
+  size_t costed = 0;
+  for (size_t i = 0; i < mSystems.size(); ++i)
+  {
+    const SystemItem& item = mSystems[i];
+    auto preference = mShardPreferences.find(item.systemName);
+    if (preference != mShardPreferences.end() && static_cast<uint32_t>(preference->second) < numShards)
+    {
+      shards[i] = static_cast<uint32_t>(preference->second);
+      pinned[i] = true;
+    }
+    else
+    {
+      open.push_back(static_cast<uint32_t>(i));
+    }
+    if (item.costNS != 0)
+    {
+      totalCost += item.costNS;
+      ++costed;
+    }
+  }
+
+  if (costed == 0)
+  {
+    for (uint32_t i : open)
+      shards[i] = i % numShards;
+  }
+  else
+  {
+    // Heaviest first, each onto the least loaded shard. Systems without a
+    // cost count as the average measured one.
+    double fallback = totalCost / static_cast<double>(costed);
+    std::vector<double> load(numShards, 0.0);
+    for (size_t i = 0; i < mSystems.size(); ++i)
+    {
+      if (pinned[i])
+        load[shards[i]] += mSystems[i].tickCost(fallback);
+    }
+    std::stable_sort(open.begin(), open.end(), [this, fallback](uint32_t a, uint32_t b)
+                     {
+                       return mSystems[a].tickCost(fallback) > mSystems[b].tickCost(fallback);
+                     });
+    for (uint32_t i : open)
+    {
+      uint32_t lightest = static_cast<uint32_t>(
+          std::min_element(load.begin(), load.end()) - load.begin());
+      shards[i] = lightest;
+      load[lightest] += mSystems[i].tickCost(fallback);
+    }
+  }
+
+  mShardTable.clear();
+  for (size_t i = 0; i < mSystems.size(); ++i)
+  {
+    SystemItem& item = mSystems[i];
+    ShardCoordinator::Entry entry;
+    if (item.systemName.size() >= sizeof(entry.name))
+    {
+      InstrumentationPolicy::log("cpm-es-system: System name too long to shard: ", item.systemName);
+      throw std::runtime_error("cpm-es-system: System name too long to shard.");
+    }
+    std::memset(entry.name, 0, sizeof(entry.name));
+    std::memcpy(entry.name, item.systemName.c_str(), item.systemName.size());
+    entry.shard = shards[i];
+
+    item.remote = entry.shard != 0;
+    mShardTable.push_back(entry);
+  }
+  mShard->publishTable(mShardTable);
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::syncShards()
+{
+  // Both lists are sorted by name.
+  mShardGeneration = mShard->readTable(mShardTable);
+  mShardStale = false;
+  for (SystemItem& item : mSystems)
+  {
+    auto it = std::lower_bound(mShardTable.cbegin(), mShardTable.cend(), item.systemName,
+                               [](const ShardCoordinator::Entry& entry, const std::string& name)
+                               {
+                                 return std::strcmp(entry.name, name.c_str()) < 0;
+                               });
+    item.remote = it == mShardTable.cend() || item.systemName != it->name
+        || it->shard != mShard->shard();
+  }
+  classifyOverlap();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::addSystemDependency(const std::string& producer,
+                                              const std::string& consumer)
+{
+  if (!mSystemFactory.hasSystem(producer.c_str()) || !mSystemFactory.hasSystem(consumer.c_str()))
+  {
+    InstrumentationPolicy::log("cpm-es-systems: Dependency on unregistered system.", " Producer: ", producer, " Consumer: ", consumer);
+    throw std::runtime_error("cpm-es-systems: Dependency on unregistered system.");
+  }
+
+  DependencyChange change;
+  change.producer = producer;
+  change.consumer = consumer;
+  change.add = true;
+  mDependencyChanges.push_back(change);
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::removeSystemDependency(const std::string& producer,
+                                                 const std::string& consumer)
+{
+  DependencyChange change;
+  change.producer = producer;
+  change.consumer = consumer;
+  change.add = false;
+  mDependencyChanges.push_back(change);
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setOutputDrivenExecution(bool enabled)
+{
+  if (mWorkerPool)
+    mWorkerPool->waitAll();
+  mOutputDriven = enabled;
+  classifyOverlap();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+bool CPM_ES_SYSTEMS_CORE::isSystemGated(const std::string& name) const
+{
+  auto it = std::lower_bound(mSystems.cbegin(), mSystems.cend(),
+                             SystemItem(name), systemCompare);
+  if (it == mSystems.end() || it->systemName != name)
+    return false;
+  size_t index = static_cast<size_t>(it - mSystems.cbegin());
+  return mProducerOffsets[index] != mProducerOffsets[index + 1];
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::buildDependencyGraph()
+{
+  size_t count = mSystems.size();
+  auto find = [this](const std::string& name) -> int64_t
+  {
+    auto it = std::lower_bound(mSystems.cbegin(), mSystems.cend(),
+                               SystemItem(name), systemCompare);
+    if (it == mSystems.end() || it->systemName != name)
+      return -1;
+    return it - mSystems.cbegin();
+  };
+
+  // Edges between active systems, by consumer. mDependencies and mSystems
+  // are both sorted by name, so consumers come out in index order.
+  Vector<std::pair<uint32_t, uint32_t> > edges;
+  Vector<uint32_t> pending(count, 0);
+  for (const std::pair<std::string, std::string>& dependency : mDependencies)
+  {
+    int64_t consumer = find(dependency.first);
+    int64_t producer = find(dependency.second);
+    if (consumer < 0 || producer < 0)
+      continue;
+    edges.push_back(std::make_pair(static_cast<uint32_t>(consumer),
+                                   static_cast<uint32_t>(producer)));
+    ++pending[consumer];
+  }
+
+  // Consumers of every producer, grouped by producer, so the pass below
+  // visits each edge once.
+  Vector<uint32_t> consumerOffsets(count + 1, 0);
+  Vector<uint32_t> consumers(edges.size(), 0);
+  for (const std::pair<uint32_t, uint32_t>& edge : edges)
+    ++consumerOffsets[edge.second + 1];
+  for (size_t i = 0; i < count; ++i)
+    consumerOffsets[i + 1] += consumerOffsets[i];
+  {
+    Vector<uint32_t> fill(consumerOffsets.begin(), consumerOffsets.end() - 1);
+    for (const std::pair<uint32_t, uint32_t>& edge : edges)
+      consumers[fill[edge.second]++] = edge.first;
+  }
+
+  // Peel off systems whose producers are all settled. What remains lies on
+  // or behind a cycle, and a gated cycle would never run.
+  Vector<uint32_t> ready;
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (pending[i] == 0)
+      ready.push_back(static_cast<uint32_t>(i));
+  }
+  while (!ready.empty())
+  {
+    uint32_t producer = ready.back();
+    ready.pop_back();
+    for (uint32_t e = consumerOffsets[producer]; e < consumerOffsets[producer + 1]; ++e)
+    {
+      if (--pending[consumers[e]] == 0)
+        ready.push_back(consumers[e]);
+    }
+  }
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (pending[i] != 0)
+      InstrumentationPolicy::log("cpm-es-system: System ", mSystems[i].systemName, " is in or behind a producer cycle. Running it ungated.");
+  }
+
+  mProducerOffsets.assign(count + 1, 0);
+  mProducers.clear();
+  mLinked.assign(count, 0);
+  for (const std::pair<uint32_t, uint32_t>& edge : edges)
+  {
+    if (pending[edge.first] != 0)
+      continue;
+    ++mProducerOffsets[edge.first + 1];
+    mProducers.push_back(edge.second);
+    mLinked[edge.first] = 1;
+    mLinked[edge.second] = 1;
+  }
+  for (size_t i = 0; i < count; ++i)
+    mProducerOffsets[i + 1] += mProducerOffsets[i];
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+std::shared_ptr<CPM_ES_NS::BaseSystem> CPM_ES_SYSTEMS_CORE::newSystem(const std::string& name,
+                                                                      int node)
+{
+  if (node >= 0 && mWorkerPool && mSystemFactory.hasSystem(name.c_str()))
+  {
+    // First touch: construct the system on its node.
+    CreateJob job;
+    job.factory = &mSystemFactory;
+    job.name = name.c_str();
+    mWorkerPool->run(mWorkerPool->worker(node, 0), &BasicSystemCore::runCreateJob, &job);
+    if (job.error)
+      std::rethrow_exception(job.error);
+    return job.system;
+  }
+  return mSystemFactory.newSystemFromName(name.c_str());
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::instantiate(SystemItem& item)
+{
+  std::shared_ptr<PrewarmWorker::Request> request;
+  request.swap(item.prewarm);
+  item.attach(request ? mPrewarmWorker->take(*request) : newSystem(item.systemName, item.node));
+
+  // Lazy systems were classified as serial writers of nothing. Readers of
+  // what this system writes may be running on the pool right now.
+  if (item.writer != nullptr && mWorkerPool)
+    mWorkerPool->waitAll();
+  mOverlapStale = true;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::prewarmDue(uint64_t referenceTime)
+{
+  uint64_t horizon = referenceTime + toTicks(mPrewarm);
+  for (; mLazyCursor < mLazyOrder.size(); ++mLazyCursor)
+  {
+    SystemItem& item = mSystems[mLazyOrder[mLazyCursor]];
+    if (item.nextExecutionTime > horizon)
+      break;
+    if (item.system || item.prewarm || item.node >= 0 || item.remote)
+      continue;
+
+    item.prewarm = std::make_shared<PrewarmWorker::Request>(mSystemFactory, item.registeredName);
+    mPrewarmWorker->request(item.prewarm);
+  }
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::addDoubleBuffer(std::shared_ptr<DoubleBufferBase> buffer)
+{
+  if (mWorkerPool)
+    mWorkerPool->waitAll();
+  mDoubleBuffers.push_back(buffer);
+  classifyOverlap();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setPipelinedExecution(bool enabled)
+{
+  if (mWorkerPool)
+    mWorkerPool->waitAll();
+
+  mPipelined = enabled;
+  if (enabled && !mWorkerPool)
+  {
+    WorkerPoolConfig config;
+    config.topology.nodes.assign(1, std::vector<int>());
+    config.pinning = PIN_NONE;
+    mWorkerPool.reset(new WorkerPool(config));
+  }
+  classifyOverlap();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setWorkerPool(const WorkerPoolConfig& config)
+{
+  mWorkerPool.reset();
+  mWorkerPool.reset(new WorkerPool(config));
+  classifyOverlap();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setSystemNode(const std::string& name, int node)
+{
+  if (mWorkerPool)
+    mWorkerPool->waitAll();
+
+  if (node < 0)
+    mNodePreferences.erase(name);
+  else
+    mNodePreferences[name] = node;
+
+  for (SystemItem& item : mSystems)
+  {
+    if (item.systemName == name)
+      item.node = node;
+  }
+  for (SystemItem& item : mSystemsToAdd)
+  {
+    if (item.systemName == name)
+      item.node = node;
+  }
+  classifyOverlap();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+int CPM_ES_SYSTEMS_CORE::getSystemWorker(const std::string& name) const
+{
+  auto it = std::lower_bound(mSystems.cbegin(), mSystems.cend(),
+                             SystemItem(name), systemCompare);
+  if (it != mSystems.end() && it->systemName == name && it->overlapped)
+    return static_cast<int>(it->worker);
+  return -1;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+bool CPM_ES_SYSTEMS_CORE::isSystemOverlapped(const std::string& name) const
+{
+  auto it = std::lower_bound(mSystems.cbegin(), mSystems.cend(),
+                             SystemItem(name), systemCompare);
+  return it != mSystems.end() && it->systemName == name && it->overlapped;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::classifyOverlap()
+{
+  // Component types some system writes directly. Readers of these types
+  // race with the writer.
+  Vector<uint64_t> direct;
+  for (const SystemItem& item : mSystems)
+  {
+    if (item.writer == nullptr)
+      continue;
+    for (uint64_t type : item.writer->writtenComponents())
+    {
+      bool buffered = false;
+      for (const std::shared_ptr<DoubleBufferBase>& buffer : mDoubleBuffers)
+        buffered = buffered || buffer->componentTypeID() == type;
+      if (!buffered)
+        direct.push_back(type);
+    }
+  }
+  std::sort(direct.begin(), direct.end());
+
+  for (size_t i = 0; i < mSystems.size(); ++i)
+  {
+    SystemItem& item = mSystems[i];
+    const std::vector<uint64_t>& signature =
+        mSystemFactory.getComponentSignature(item.systemName.c_str());
+
+    // Output stamps are only exchanged on the calling thread.
+    bool linked = mOutputDriven && i < mLinked.size() && mLinked[i];
+
+    item.overlapped = false;
+    if (mPipelined && item.system && item.writer == nullptr && item.resumable == nullptr
+        && item.buckets == nullptr && !item.remote && !signature.empty() && !linked)
+    {
+      Vector<uint64_t> shared;
+      std::set_intersection(signature.begin(), signature.end(),
+                            direct.begin(), direct.end(),
+                            std::back_inserter(shared));
+      item.overlapped = shared.empty();
+    }
+  }
+
+  // Spread overlapped systems over the workers of their preferred node.
+  size_t numWorkers = mWorkerPool ? mWorkerPool->size() : 0;
+  if (numWorkers > 0)
+  {
+    Vector<size_t> assigned(mWorkerPool->numNodes() + 1, 0);
+    for (SystemItem& item : mSystems)
+    {
+      if (!item.overlapped)
+        continue;
+      bool hasNode = item.node >= 0 && static_cast<size_t>(item.node) < mWorkerPool->numNodes();
+      size_t slot = hasNode ? static_cast<size_t>(item.node) : mWorkerPool->numNodes();
+      item.worker = static_cast<uint32_t>(
+          mWorkerPool->worker(hasNode ? item.node : -1, assigned[slot]++));
+    }
+  }
+
+  mWorkerLists.resize(numWorkers);
+  mWorkerJobs.resize(numWorkers);
+  for (Vector<uint32_t>& list : mWorkerLists)
+    list.reserve(mSystems.size());
+  mSerialList.reserve(mSystems.size());
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::dispatchSystems(CPM_ES_NS::ESCoreBase& core, const uint32_t* first,
+                                          const uint32_t* last, uint64_t referenceTime,
+                                          bool fromTable)
+{
+  for (; first != last; ++first)
+  {
+    // Warm up the next due system's components while this one runs.
+    if (mPrefetchMode != PREFETCH_NONE && first + 1 != last)
+    {
+      PrefetchableSystem* next = mSystems[mExecutionOrder[*(first + 1)]].prefetcher;
+      if (next != nullptr)
+      {
+        if (mPrefetchMode == PREFETCH_INLINE)
+          next->prefetchComponents(core);
+        else
+          mPrefetchWorker->request(next, &core);
+      }
+    }
+
+    uint32_t index = mExecutionOrder[*first];
+    SystemItem& item = mSystems[index];
+    if (item.remote || (mOutputDriven && !hasNewInput(index)))
+      continue;
+
+    if (!item.system)
+      instantiate(item);
+
+    if (!InstrumentationPolicy::enabled
+        || (!mRecordTiming && !mWatchdog && !mTrackAllocations && !mRecorder && !mCounters
+            && !mMetrics && !mTrackCost))
+    {
+      runItem(item, core, referenceTime);
+      if (mOutputDriven)
+        stampOutput(item);
+      continue;
+    }
+
+    if (mWatchdog)
+      mWatchdog->enter(item.registeredName);
+    uint64_t mark = allocationMark();
+    PerfCounterValues before;
+    bool counted = mCounters && mCounters->read(before);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    runItem(item, core, referenceTime);
+    if (mOutputDriven)
+      stampOutput(item);
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    PerfCounterValues after;
+    if (counted && mCounters->read(after))
+    {
+      PerfCounterValues delta;
+      delta.cycles = after.cycles - before.cycles;
+      delta.instructions = after.instructions - before.instructions;
+      delta.cacheMisses = after.cacheMisses - before.cacheMisses;
+      delta.branchMisses = after.branchMisses - before.branchMisses;
+      item.counters.record(delta, item.entityCounter ? item.entityCounter->getWalkedEntityCount() : 0);
+    }
+    addAllocationsSince(mark, item.allocations);
+    if (mWatchdog)
+      mWatchdog->leave();
+
+    uint64_t duration = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+    // Table frames leave mSchedule behind. A system read from the table was
+    // due at its first stagger point after the previous frame.
+    uint64_t lateness = 0;
+    if (!fromTable)
+    {
+      lateness = referenceTime - mSchedule.lastScheduledTime(*first, referenceTime);
+    }
+    else if (referenceTime != mLastReferenceTime + 1 && mSchedule.interval(*first) != 0)
+    {
+      lateness = referenceTime - ScheduleTable::calcNextExecutionTime(
+          mLastReferenceTime + 1, mSchedule.interval(*first), mSchedule.stagger(*first));
+    }
+    if (mRecordTiming)
+      item.stats.record(lateness, duration);
+    if (mMetrics && item.metrics)
+    {
+      uint64_t interval = item.scheduleInterval();
+      item.metrics->record(duration, lateness, interval == 0 ? 0 : lateness / interval);
+    }
+    if (mRecorder)
+      mRecorder->execute(item.registeredName, duration);
+    if (mTrackCost)
+    {
+      double sample = static_cast<double>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+      if (item.costNS == 0)
+        item.costNS = sample;
+      else
+        item.costNS += mCostSmoothing * (sample - item.costNS);
+    }
+  }
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setTimingStatistics(bool enabled)
+{
+  mRecordTiming = enabled && InstrumentationPolicy::enabled;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+bool CPM_ES_SYSTEMS_CORE::getTimingStatistics(const std::string& name, SystemTimingStats& stats) const
+{
+  auto it = std::lower_bound(mSystems.cbegin(), mSystems.cend(),
+                             SystemItem(name), systemCompare);
+  if (it != mSystems.end() && it->systemName == name)
+  {
+    stats = it->stats;
+    return true;
+  }
+  return false;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+bool CPM_ES_SYSTEMS_CORE::setHardwareCounters(bool enabled)
+{
+  mCounters.reset();
+  if (!enabled || !InstrumentationPolicy::enabled)
+    return false;
+
+  mCounters.reset(new PerfCounterGroup());
+  if (!mCounters->available())
+  {
+    // Callers may retry every frame; say why only the first time.
+    if (!mCountersUnavailableLogged)
+      InstrumentationPolicy::log("cpm-es-systems: Hardware counters are not available.");
+    mCountersUnavailableLogged = true;
+    mCounters.reset();
+    return false;
+  }
+  return true;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+bool CPM_ES_SYSTEMS_CORE::getHardwareCounters(const std::string& name,
+                                              SystemCounterStats& stats) const
+{
+  auto it = std::lower_bound(mSystems.cbegin(), mSystems.cend(),
+                             SystemItem(name), systemCompare);
+  if (it != mSystems.end() && it->systemName == name)
+  {
+    stats = it->counters;
+    return true;
+  }
+  return false;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setAllocationTracking(bool enabled)
+{
+  mTrackAllocations = enabled && InstrumentationPolicy::enabled;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+bool CPM_ES_SYSTEMS_CORE::getAllocationCount(const std::string& name, uint64_t& count) const
+{
+  auto it = std::lower_bound(mSystems.cbegin(), mSystems.cend(),
+                             SystemItem(name), systemCompare);
+  if (it != mSystems.end() && it->systemName == name)
+  {
+    count = it->allocations;
+    return true;
+  }
+  return false;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::resetAllocationCounts()
+{
+  for (SystemItem& item : mSystems)
+    item.allocations = 0;
+  for (size_t i = 0; i < NUM_SCHEDULER_PHASES; ++i)
+    mPhaseAllocations[i] = 0;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setCostTracking(bool enabled, double smoothing)
+{
+  if (smoothing <= 0.0 || smoothing > 1.0)
+  {
+    InstrumentationPolicy::log("cpm-es-system: Cost smoothing must be in (0, 1].");
+    throw std::runtime_error("cpm-es-system: Cost smoothing must be in (0, 1].");
+  }
+  mTrackCost = enabled && InstrumentationPolicy::enabled;
+  mCostSmoothing = smoothing;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+bool CPM_ES_SYSTEMS_CORE::getSystemCost(const std::string& name,
+                                        std::chrono::nanoseconds& cost) const
+{
+  auto it = std::lower_bound(mSystems.cbegin(), mSystems.cend(),
+                             SystemItem(name), systemCompare);
+  if (it != mSystems.end() && it->systemName == name && it->costNS != 0)
+  {
+    cost = std::chrono::nanoseconds(static_cast<int64_t>(it->costNS + 0.5));
+    return true;
+  }
+  return false;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::saveCostProfile(const std::string& path) const
+{
+  CostProfile profile(mCostProfile);
+  for (const SystemItem& item : mSystems)
+  {
+    if (item.costNS != 0)
+      profile.costs[item.systemName] = static_cast<uint64_t>(item.costNS + 0.5);
+  }
+  profile.save(path);
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::loadCostProfile(const std::string& path)
+{
+  CostProfile profile;
+  profile.load(path);
+  for (const CostProfile::CostMap::value_type& entry : profile.costs)
+    mCostProfile.costs[entry.first] = entry.second;
+
+  auto seed = [&profile](SystemItem& item)
+  {
+    auto cost = profile.costs.find(item.systemName);
+    if (cost != profile.costs.end())
+      item.costNS = static_cast<double>(cost->second);
+  };
+  if (mWorkerPool)
+    mWorkerPool->waitAll();
+  for (SystemItem& item : mSystems)
+    seed(item);
+  for (SystemItem& item : mSystemsToAdd)
+    seed(item);
+
+  if (mShard != nullptr && mShard->isLeader())
+  {
+    assignShards();
+    classifyOverlap();
+  }
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setRecorder(ScheduleRecorder* recorder)
+{
+  mRecorder = InstrumentationPolicy::enabled ? recorder : nullptr;
+  if (mRecorder)
+    mRecorder->tickLength(mClock.tickNS());
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setMetrics(SchedulerMetrics* metrics)
+{
+  mMetrics = InstrumentationPolicy::enabled ? metrics : nullptr;
+  for (SystemItem& item : mSystems)
+    item.metrics = nullptr;
+  publishActiveMetrics();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::publishActiveMetrics()
+{
+  if (!mMetrics)
+    return;
+
+  ++mMetricsGeneration;
+  for (SystemItem& item : mSystems)
+  {
+    if (item.metrics == nullptr)
+      item.metrics = mMetrics->cell(item.systemName);
+    item.metrics->generation = mMetricsGeneration;
+  }
+  mMetrics->publishActive(mMetricsGeneration);
+  publishQueueMetrics();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setWatchdog(std::chrono::microseconds budget,
+                                      SystemWatchdog::OverrunCallback callback)
+{
+  mWatchdog.reset();
+  if (InstrumentationPolicy::enabled)
+    mWatchdog.reset(new SystemWatchdog(budget, callback));
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::clearWatchdog()
+{
+  mWatchdog.reset();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setPrefetchMode(PrefetchMode mode)
+{
+  mPrefetchMode = mode;
+  if (mode == PREFETCH_HELPER_THREAD)
+  {
+    if (!mPrefetchWorker)
+      mPrefetchWorker.reset(new PrefetchWorker());
+  }
+  else
+  {
+    mPrefetchWorker.reset();
+  }
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::materializeSchedule()
+{
+  // Every system due at or before the last reference time has run, so each
+  // system's next execution is its first stagger point after it.
+  if (mScheduleStale)
+  {
+    mSchedule.recalcNextExecutionTimes(mLastReferenceTime + 1);
+    mScheduleStale = false;
+  }
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setComponentAffinityOrdering(bool enabled)
+{
+  syncScheduleToItems();
+  mUseAffinityOrdering = enabled;
+  rebuildSchedule();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setPrecompiledSchedule(bool enabled, uint64_t maxHyperperiod)
+{
+  syncScheduleToItems();
+  mUsePrecompiledSchedule = enabled;
+  mMaxHyperperiod = maxHyperperiod;
+  rebuildSchedule();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::renormalize()
+{
+  uint64_t mark = allocationMark();
+  if (mRecorder)
+    mRecorder->renormalize();
+
+  // Free copies of the active list that readers have let go of.
+  mActiveSnapshot.reclaim();
+
+  // Frame boundary. Overlapped systems must finish reading the front
+  // buffers before the writes of this frame are published.
+  if (mWorkerPool)
+    mWorkerPool->waitAll();
+  for (const std::shared_ptr<DoubleBufferBase>& buffer : mDoubleBuffers)
+    buffer->swap();
+
+  if (mSystemsToRemove.empty() && mSystemsToAdd.empty() && mSliceChanges.empty()
+      && mElasticityChanges.empty() && mDependencyChanges.empty())
+  {
+    addAllocationsSince(mark, mPhaseAllocations[PHASE_RENORMALIZE]);
+    return;
+  }
+
+  std::chrono::steady_clock::time_point start;
+  if (mMetrics)
+    start = std::chrono::steady_clock::now();
+
+  renormalizeChanges();
+
+  if (mMetrics)
+  {
+    mMetrics->recordRenormalize(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count()));
+  }
+  addAllocationsSince(mark, mPhaseAllocations[PHASE_RENORMALIZE]);
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::renormalizeChanges()
+{
+  syncScheduleToItems();
+
+  // The helper thread may still be prefetching for a system we are about to
+  // destroy.
+  if (mPrefetchWorker)
+    mPrefetchWorker->waitIdle();
+
+  // The sequence in the system core is a bit different than the sequence in the
+  // entity system. In general, we want to remove first then add. In reality,
+  // we need a system of telling when an add or remove was issued to alleviate
+  // all problems related to addition / removal. Maybe timestamping each and
+  // using a priority queue to march through both.
+
+  for (const std::string& name : mSystemsToRemove)
+  {
+    auto it = std::lower_bound(mSystems.begin(), mSystems.end(),
+                               SystemItem(name), systemCompare);
+
+    if (it != mSystems.end() && it->systemName == name)
+    {
+      releaseFrame(*it);
+      mSystems.erase(it);
+    }
+    else
+    {
+      InstrumentationPolicy::log("cpm-es-system: Unable to find system with name: ", name, " in active list.");
+    }
+  }
+  mSystemsToRemove.clear();
+
+  // Additions.
+  for (SystemItem& sys : mSystemsToAdd)
+  {
+    // Ensure the system is not already present in our list.
+    // Brute force search.
+    bool shouldAdd = true;
+    for (const SystemItem& vecItem : mSystems)
+    {
+      if (vecItem.systemName == sys.systemName)
+      {
+        shouldAdd = false;
+      }
+    }
+
+    if (shouldAdd)
+    {
+      mSystems.push_back(sys);
+    }
+    else
+    {
+      InstrumentationPolicy::log("Refusing to add system ", sys.systemName, ". Already present.");
+    }
+  }
+
+  // Re-sort the systems if the number of systems just added was greater than 0.
+  if (mSystemsToAdd.size() > 0)
+  {
+    std::sort(mSystems.begin(), mSystems.end(), systemCompare);
+  }
+
+  mSystemsToAdd.clear();
+
+  for (const std::pair<std::string, uint32_t>& change : mSliceChanges)
+  {
+    auto it = std::lower_bound(mSystems.begin(), mSystems.end(),
+                               SystemItem(change.first), systemCompare);
+
+    if (it != mSystems.end() && it->systemName == change.first)
+    {
+      if (change.second > 1 && !it->system)
+        instantiate(*it);
+      applySlices(*it, change.second, 0);
+    }
+    else
+    {
+      InstrumentationPolicy::log("cpm-es-system: Unable to find system with name: ", change.first, " in active list.");
+    }
+  }
+  mSliceChanges.clear();
+
+  for (const ElasticityChange& change : mElasticityChanges)
+  {
+    auto it = std::lower_bound(mSystems.begin(), mSystems.end(),
+                               SystemItem(change.name), systemCompare);
+    if (it == mSystems.end() || it->systemName != change.name)
+    {
+      InstrumentationPolicy::log("cpm-es-system: Unable to find system with name: ", change.name, " in active list.");
+      continue;
+    }
+
+    bool fixed = change.minInterval == 0 && change.maxInterval == 0;
+    if (!fixed && (change.minInterval == 0 || change.minInterval > it->baseInterval
+                   || change.maxInterval < it->baseInterval))
+    {
+      InstrumentationPolicy::log("cpm-es-system: Elasticity bounds of ", change.name, " must enclose its interval.");
+      continue;
+    }
+
+    it->minInterval = change.minInterval;
+    it->maxInterval = change.maxInterval;
+    uint64_t interval = fixed ? it->baseInterval : elasticInterval(*it, mLoadLevel);
+    if (interval != it->interval)
+    {
+      uint64_t previousInterval = it->scheduleInterval();
+      uint64_t from = it->nextExecutionTime;
+      if (previousInterval != 0 && from >= previousInterval)
+        from = from - previousInterval + 1;
+      rescaleItem(*it, interval, from);
+    }
+  }
+  mElasticityChanges.clear();
+
+  for (const DependencyChange& change : mDependencyChanges)
+  {
+    std::pair<std::string, std::string> dependency(change.consumer, change.producer);
+    if (change.add)
+    {
+      if (change.producer == change.consumer)
+        InstrumentationPolicy::log("cpm-es-system: System ", change.consumer, " cannot consume its own output.");
+      else
+        mDependencies.insert(dependency);
+    }
+    else
+    {
+      mDependencies.erase(dependency);
+    }
+  }
+  mDependencyChanges.clear();
+
+  rebuildSchedule();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::setSystemSlices(const std::string& name, uint32_t numSlices)
+{
+  mSliceChanges.push_back(std::make_pair(name, numSlices));
+  if (mRecorder)
+    mRecorder->slices(name, numSlices);
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+bool CPM_ES_SYSTEMS_CORE::applySlices(SystemItem& item, uint32_t numSlices, uint32_t cursor)
+{
+  if (numSlices == 0)
+    numSlices = 1;
+
+  if (numSlices > 1 && item.slicer == nullptr)
+  {
+    InstrumentationPolicy::log("cpm-es-system: System ", item.systemName, " does not implement SliceableSystem.");
+    return false;
+  }
+
+  // Every slice needs at least one tick of the interval to itself.
+  if (numSlices > item.interval && numSlices > 1)
+  {
+    InstrumentationPolicy::log("cpm-es-system: System ", item.systemName, " has an interval too short for ", numSlices, " slices.");
+    return false;
+  }
+
+  // Restart the schedule from just after the previous execution, so a newly
+  // sliced system starts its first slice on the next sub-tick rather than
+  // waiting out the full interval.
+  uint64_t previousInterval = item.scheduleInterval();
+  uint64_t from = item.nextExecutionTime;
+  if (previousInterval != 0 && from >= previousInterval)
+    from = from - previousInterval + 1;
+
+  item.numSlices = numSlices;
+  item.sliceCursor = cursor % numSlices;
+  item.nextExecutionTime = item.calcNextExecutionTime(from);
+  return true;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::syncScheduleToItems()
+{
+  materializeSchedule();
+  for (size_t k = 0; k < mSchedule.size(); ++k)
+  {
+    mSystems[mExecutionOrder[k]].nextExecutionTime = mSchedule.nextExecutionTime(k);
+  }
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::rebuildSchedule()
+{
+  // Overlapped systems index mExecutionOrder.
+  if (mWorkerPool)
+    mWorkerPool->waitAll();
+
+  mExecutionOrder.resize(mSystems.size());
+  for (size_t i = 0; i < mSystems.size(); ++i)
+  {
+    mExecutionOrder[i] = static_cast<uint32_t>(i);
+  }
+
+  if (mUseAffinityOrdering)
+  {
+    // Sorting signatures lexicographically places systems with identical
+    // signatures next to each other, and neighbours share their lowest
+    // component types. Ties keep alphabetical order.
+    Vector<const std::vector<uint64_t>*> signatures(mSystems.size());
+    for (size_t i = 0; i < mSystems.size(); ++i)
+    {
+      signatures[i] = &mSystemFactory.getComponentSignature(mSystems[i].systemName.c_str());
+    }
+    std::stable_sort(mExecutionOrder.begin(), mExecutionOrder.end(),
+                     [&signatures](uint32_t a, uint32_t b)
+                     {
+                       return *signatures[a] < *signatures[b];
+                     });
+  }
+
+  buildDependencyGraph();
+  if (mShard != nullptr)
+  {
+    if (mShard->isLeader())
+      assignShards();
+    else
+      mShardStale = true;
+  }
+  classifyOverlap();
+  reserveFrames();
+
+  mSchedule.clear();
+  mSchedule.reserve(mSystems.size());
+  for (uint32_t index : mExecutionOrder)
+  {
+    const SystemItem& item = mSystems[index];
+    mSchedule.push_back(item.scheduleInterval(), item.stagger, item.nextExecutionTime);
+  }
+
+  // Newly added systems may be due before the last reference time. Force a
+  // dynamic frame before switching to the precompiled schedule so they catch
+  // up.
+  mHasLastReferenceTime = false;
+  mHyperperiod.clear();
+  mDueSeen.assign(mSchedule.size(), 0);
+  if (mUsePrecompiledSchedule)
+  {
+    if (!mHyperperiod.build(mSchedule, mMaxHyperperiod, 1 << 24))
+    {
+      InstrumentationPolicy::log("cpm-es-system: Hyperperiod exceeds ", mMaxHyperperiod,
+                                 " ticks. Using dynamic scheduler.");
+    }
+  }
+
+  // Lazy systems by first execution, for the prewarm thread.
+  mLazyOrder.clear();
+  for (size_t i = 0; i < mSystems.size(); ++i)
+  {
+    if (!mSystems[i].system)
+      mLazyOrder.push_back(static_cast<uint32_t>(i));
+  }
+  std::sort(mLazyOrder.begin(), mLazyOrder.end(),
+            [this](uint32_t a, uint32_t b)
+            {
+              return mSystems[a].nextExecutionTime < mSystems[b].nextExecutionTime;
+            });
+  mLazyCursor = 0;
+
+  publishActiveMetrics();
+  publishActiveSystems();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::publishActiveSystems()
+{
+  std::unique_ptr<ActiveSystemSnapshot> snapshot(new ActiveSystemSnapshot());
+  snapshot->generation = ++mActiveGeneration;
+  snapshot->systems.reserve(mSystems.size());
+  for (const SystemItem& item : mSystems)
+  {
+    ActiveSystemSnapshot::Entry entry;
+    entry.name = item.systemName;
+    entry.system = item.system;
+    entry.interval = std::chrono::nanoseconds(item.interval * mClock.tickNS());
+    entry.nextExecution = std::chrono::nanoseconds(item.nextExecutionTime * mClock.tickNS());
+    snapshot->systems.push_back(entry);
+  }
+  mActiveSnapshot.publish(std::move(snapshot));
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+bool CPM_ES_SYSTEMS_CORE::systemCompare(const SystemItem& a, const SystemItem& b)
+{
+  return a.systemName < b.systemName;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+bool CPM_ES_SYSTEMS_CORE::isSystemActive(const std::string& name) const
+{
+  // See if there is a pre-existing system. Our list is alphabetically
+  // sorted, so we can use a binary search on it.
+  auto it = std::lower_bound(mSystems.cbegin(), mSystems.cend(),
+                             SystemItem(name), systemCompare);
+
+  bool foundSystem = false;
+  if (it != mSystems.end())
+  {
+    if (it->systemName == name)
+    {
+      foundSystem = true;
+    }
+  }
+
+  if (foundSystem == false)
+  {
+    for (const SystemItem& item : mSystemsToAdd)
+    {
+      if (item.systemName == name)
+      {
+        foundSystem = true;
+        break;
+      }
+    }
+  }
+
+  return foundSystem;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::addActiveSystem(const std::string& name, uint64_t ms,
+                                          uint64_t referenceTime, uint64_t stagger)
+{
+  addActiveSystemTicks(name, msToTicks(ms), msToTicks(referenceTime), msToTicks(stagger));
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::addActiveSystem(const std::string& name, std::chrono::nanoseconds interval,
+                                          std::chrono::nanoseconds referenceTime,
+                                          std::chrono::nanoseconds stagger)
+{
+  addActiveSystemTicks(name, toTicks(interval), toTicks(referenceTime), toTicks(stagger));
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::addActiveSystemTicks(const std::string& name, uint64_t interval,
+                                               uint64_t referenceTime, uint64_t stagger)
+{
+  createItem(name, interval, referenceTime, stagger, mSystemsToAdd);
+  publishQueueMetrics();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+bool CPM_ES_SYSTEMS_CORE::createItem(const std::string& name, uint64_t interval,
+                                     uint64_t referenceTime, uint64_t stagger,
+                                     Vector<SystemItem>& out)
+{
+  int node = -1;
+  auto preference = mNodePreferences.find(name);
+  if (preference != mNodePreferences.end())
+    node = preference->second;
+
+  // A lazy item is constructed when first due. Unknown names still go
+  // through the factory so they are reported here.
+  std::shared_ptr<CPM_ES_NS::BaseSystem> sys;
+  bool lazy = mLazy && mSystemFactory.hasSystem(name.c_str());
+  if (!lazy)
+    sys = newSystem(name, node);
+
+  if (lazy || sys != nullptr)
+  {
+    SystemItem item(name, sys, interval, referenceTime, stagger);
+    item.registeredName = mSystemFactory.getRegisteredName(name.c_str());
+    item.node = node;
+    auto cost = mCostProfile.costs.find(name);
+    if (cost != mCostProfile.costs.end())
+      item.costNS = static_cast<double>(cost->second);
+    auto buckets = mEntityBuckets.find(name);
+    if (buckets != mEntityBuckets.end())
+      item.buckets = buckets->second.get();
+    out.push_back(item);
+    if (mRecorder)
+      mRecorder->add(name, interval, stagger, referenceTime);
+    return true;
+  }
+  else
+  {
+    InstrumentationPolicy::log("cpm-es-system: Unable to find system with name: ", name);
+    InstrumentationPolicy::log("cpm-es-system: Was the system registered?");
+    return false;
+  }
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::removeActiveSystem(const std::string& name)
+{
+  mSystemsToRemove.push_back(name);
+  if (mRecorder)
+    mRecorder->remove(name);
+  publishQueueMetrics();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::deserializeActiveSystems(Tny* root, uint64_t referenceTime)
+{
+  deserializeActiveSystemsTicks(root, msToTicks(referenceTime));
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::deserializeActiveSystems(Tny* root, std::chrono::nanoseconds referenceTime)
+{
+  deserializeActiveSystemsTicks(root, toTicks(referenceTime));
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::deserializeActiveSystemsTicks(Tny* root, uint64_t referenceTime)
+{
+  if (root->type != TNY_DICT)
+  {
+    InstrumentationPolicy::log("cpm-es-system: Unexpected type during deserialization.");
+    throw std::runtime_error("Unexepected Tny type");
+  }
+
+  while (Tny_hasNext(root))
+  {
+    root = Tny_next(root);
+
+    std::string name = root->key;
+    if (root->type != TNY_OBJ)
+    {
+      InstrumentationPolicy::log("cpm-es-system: Unexpected type during deserialization.");
+      throw std::runtime_error("Unexpected Tny type");
+    }
+
+    // We ignore next exec and calculate it ourselves.
+    SystemSnapshotRecord record = SystemSnapshot::readRecord(root->value.tny);
+    if (record.removed)
+      removeActiveSystem(name);
+    else
+      applyRecord(name, record, referenceTime, mSystemsToAdd);
+  }
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::writeActiveSystems(SystemRecordWriter& writer)
+{
+  syncScheduleToItems();
+  for (const SystemItem& item : mSystems)
+    writer.write(item.systemName, makeRecord(item));
+  writer.flush();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::loadActiveSystems(SystemRecordReader& reader,
+                                            uint64_t referenceTime, size_t batchSize)
+{
+  loadActiveSystemsTicks(reader, msToTicks(referenceTime), batchSize);
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::loadActiveSystems(SystemRecordReader& reader,
+                                            std::chrono::nanoseconds referenceTime,
+                                            size_t batchSize)
+{
+  loadActiveSystemsTicks(reader, toTicks(referenceTime), batchSize);
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::loadActiveSystemsTicks(SystemRecordReader& reader,
+                                                 uint64_t referenceTime, size_t batchSize)
+{
+  if (batchSize == 0)
+    batchSize = 1;
+
+  syncScheduleToItems();
+  if (mWorkerPool)
+    mWorkerPool->waitAll();
+  if (mPrefetchWorker)
+    mPrefetchWorker->waitIdle();
+
+  // Systems already active are sorted. Loaded systems are appended behind
+  // them in batches and merged in once at the end.
+  size_t numSorted = mSystems.size();
+  Vector<SystemItem> batch;
+  batch.reserve(batchSize);
+
+  std::string name;
+  SystemSnapshotRecord record;
+  bool more = true;
+  try
+  {
+    while (more)
+    {
+      more = reader.next(name, record);
+      if (more && !record.removed)
+      {
+        auto it = std::lower_bound(mSystems.begin(), mSystems.begin() + numSorted,
+                                   SystemItem(name), systemCompare);
+        if (it != mSystems.begin() + numSorted && it->systemName == name)
+          InstrumentationPolicy::log("Refusing to add system ", name, ". Already present.");
+        else
+          applyRecord(name, record, referenceTime, batch);
+      }
+
+      if (batch.size() >= batchSize || (!more && !batch.empty()))
+      {
+        mSystems.insert(mSystems.end(), batch.begin(), batch.end());
+        batch.clear();
+      }
+    }
+  }
+  catch (...)
+  {
+    // Keep the batches committed so far, the active list must stay sorted.
+    commitLoadedSystems(numSorted);
+    throw;
+  }
+  commitLoadedSystems(numSorted);
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::commitLoadedSystems(size_t numSorted)
+{
+  // Streams written by writeActiveSystems are sorted already, in which
+  // case this is a merge of two runs.
+  auto loaded = mSystems.begin() + numSorted;
+  if (!std::is_sorted(loaded, mSystems.end(), systemCompare))
+    std::stable_sort(loaded, mSystems.end(), systemCompare);
+  std::inplace_merge(mSystems.begin(), loaded, mSystems.end(), systemCompare);
+  auto last = std::unique(mSystems.begin(), mSystems.end(),
+                          [](const SystemItem& a, const SystemItem& b)
+                          {
+                            return a.systemName == b.systemName;
+                          });
+  if (last != mSystems.end())
+  {
+    InstrumentationPolicy::log("cpm-es-system: Dropped duplicate systems in record stream.");
+    mSystems.erase(last, mSystems.end());
+  }
+
+  rebuildSchedule();
+
+  // Loaded systems are recorded as additions, which a replay commits with
+  // a renormalize.
+  if (mRecorder)
+    mRecorder->renormalize();
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+Tny* CPM_ES_SYSTEMS_CORE::serializeActiveSystems()
+{
+  // Iterate through all active systems and serialize them out, in order, to
+  // a TNY dictionary.
+  Tny* root = Tny_add(NULL, TNY_DICT, NULL, NULL, 0);
+
+  syncScheduleToItems();
+  mCheckpoint.records.clear();
+  for (const SystemItem& item : mSystems)
+  {
+    SystemSnapshotRecord record = makeRecord(item);
+    root = SystemSnapshot::writeRecord(root, item.systemName, record);
+    mCheckpoint.records.insert(mCheckpoint.records.end(),
+                               std::make_pair(item.systemName, record));
+  }
+
+  return root;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+Tny* CPM_ES_SYSTEMS_CORE::serializeActiveSystemsDelta()
+{
+  Tny* root = Tny_add(NULL, TNY_DICT, NULL, NULL, 0);
+
+  // mSystems and the checkpoint are both sorted by name, so one merge pass
+  // finds every addition, removal and change.
+  syncScheduleToItems();
+  SystemSnapshot::RecordMap::iterator it = mCheckpoint.records.begin();
+  for (const SystemItem& item : mSystems)
+  {
+    while (it != mCheckpoint.records.end() && it->first < item.systemName)
+    {
+      SystemSnapshotRecord removed;
+      removed.removed = true;
+      root = SystemSnapshot::writeRecord(root, it->first, removed);
+      it = mCheckpoint.records.erase(it);
+    }
+
+    SystemSnapshotRecord record = makeRecord(item);
+    if (it != mCheckpoint.records.end() && it->first == item.systemName)
+    {
+      if (!it->second.sameSchedule(record))
+        root = SystemSnapshot::writeRecord(root, item.systemName, record);
+      it->second = record;
+      ++it;
+    }
+    else
+    {
+      root = SystemSnapshot::writeRecord(root, item.systemName, record);
+      mCheckpoint.records.insert(it, std::make_pair(item.systemName, record));
+    }
+  }
+  while (it != mCheckpoint.records.end())
+  {
+    SystemSnapshotRecord removed;
+    removed.removed = true;
+    root = SystemSnapshot::writeRecord(root, it->first, removed);
+    it = mCheckpoint.records.erase(it);
+  }
+
+  return root;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+SystemSnapshotRecord CPM_ES_SYSTEMS_CORE::makeRecord(const SystemItem& item) const
+{
+  SystemSnapshotRecord record;
+  record.interval     = item.baseInterval;
+  record.stagger      = item.stagger;
+  record.nextExec     = item.nextExecutionTime;
+  record.tickNS       = mClock.tickNS();
+  record.slices       = item.numSlices;
+  record.sliceCursor  = item.sliceCursor;
+  if (item.maxInterval != 0)
+  {
+    record.minInterval        = item.minInterval;
+    record.maxInterval        = item.maxInterval;
+    record.effectiveInterval  = item.interval;
+  }
+  record.costNS       = static_cast<uint64_t>(item.costNS + 0.5);
+  return record;
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::restoreActiveSystems(Tny* base, const std::vector<Tny*>& deltas,
+                                               uint64_t referenceTime)
+{
+  restoreActiveSystemsTicks(base, deltas, msToTicks(referenceTime));
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::restoreActiveSystems(Tny* base, const std::vector<Tny*>& deltas,
+                                               std::chrono::nanoseconds referenceTime)
+{
+  restoreActiveSystemsTicks(base, deltas, toTicks(referenceTime));
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::restoreActiveSystemsTicks(Tny* base, const std::vector<Tny*>& deltas,
+                                                    uint64_t referenceTime)
+{
+  SystemSnapshot snapshot;
+  snapshot.apply(base);
+  for (Tny* delta : deltas)
+    snapshot.apply(delta);
+
+  for (const SystemSnapshot::RecordMap::value_type& entry : snapshot.records)
+    applyRecord(entry.first, entry.second, referenceTime, mSystemsToAdd);
+}
+
+CPM_ES_SYSTEMS_CORE_TEMPLATE
+void CPM_ES_SYSTEMS_CORE::applyRecord(const std::string& name,
+                                      const SystemSnapshotRecord& record,
+                                      uint64_t referenceTime, Vector<SystemItem>& out)
+{
+  // Tick lengths are powers of 1000 apart, so one divides the other.
+  uint64_t ourTickNS = mClock.tickNS();
+  auto convert = [&record, ourTickNS](uint64_t ticks) -> uint64_t
+  {
+    if (record.tickNS >= ourTickNS)
+      return ticks * (record.tickNS / ourTickNS);
+    else
+      return ticks / (ourTickNS / record.tickNS);
+  };
+  uint64_t interval = convert(record.interval);
+  uint64_t stagger = convert(record.stagger);
+
+  if (!createItem(name, interval, referenceTime, stagger, out))
+    return;
+  if (record.costNS != 0)
+    out.back().costNS = static_cast<double>(record.costNS);
+
+  // Resume at the interval the system had adapted to.
+  if (record.elastic())
+  {
+    SystemItem& item = out.back();
+    item.minInterval = convert(record.minInterval);
+    item.maxInterval = convert(record.maxInterval);
+    uint64_t effective = convert(record.effectiveInterval);
+    if (effective < item.minInterval) effective = item.minInterval;
+    if (effective > item.maxInterval) effective = item.maxInterval;
+    rescaleItem(item, effective, referenceTime);
+  }
+
+  // Restore slicing, picking up at the slice we left off at.
+  if (record.slices > 1)
+  {
+    if (!out.back().system)
+      instantiate(out.back());
+    applySlices(out.back(), static_cast<uint32_t>(record.slices),
+                static_cast<uint32_t>(record.sliceCursor));
+    if (mRecorder)
+      mRecorder->slices(name, static_cast<uint32_t>(record.slices));
+  }
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#undef CPM_ES_SYSTEMS_CORE
+#undef CPM_ES_SYSTEMS_CORE_TEMPLATE
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef IAUNS_ES_SYSTEMS_SYSTEMCOREPOLICIES_HPP
+#define IAUNS_ES_SYSTEMS_SYSTEMCOREPOLICIES_HPP
+
+#include <cstdint>
+#include <iostream>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+//------------------------------------------------------------------------------
+// Clock policies
+//------------------------------------------------------------------------------
+// A clock policy defines the length of the scheduler's tick. It must provide:
+//   uint64_t tickNS() const;          Nanoseconds per tick.
+//   bool setTickNS(uint64_t ns);      Returns false if ns is not supported.
+
+/// Tick length chosen at runtime through BasicSystemCore::setTickResolution.
+/// Defaults to milliseconds.
+class RuntimeClock
+{
+public:
+  RuntimeClock() : mTickNS(1000000) {}
+
+  uint64_t tickNS() const         {return mTickNS;}
+  bool setTickNS(uint64_t ns)     {mTickNS = ns; return true;}
+
+private:
+  uint64_t mTickNS;
+};
+
+/// Tick length fixed at compile time, so unit conversions fold away.
+template <uint64_t TickNS>
+class FixedClock
+{
+public:
+  uint64_t tickNS() const         {return TickNS;}
+  bool setTickNS(uint64_t ns)     {return ns == TickNS;}
+};
+
+typedef FixedClock<1>       NanosecondClock;
+typedef FixedClock<1000>    MicrosecondClock;
+typedef FixedClock<1000000> MillisecondClock;
+
+//------------------------------------------------------------------------------
+// Instrumentation policies
+//------------------------------------------------------------------------------
+// An instrumentation policy decides whether diagnostics exist at all. It
+// must provide:
+//   static const bool enabled;                 Timing statistics and watchdog.
+//   static void log(const Ts&... parts);       Writes one diagnostic line.
+
+/// Logs diagnostics to std::cerr and supports timing statistics and the
+/// overrun watchdog.
+struct StreamInstrumentation
+{
+  static const bool enabled = true;
+
+  template <typename... Ts>
+  static void log(const Ts&... parts)
+  {
+    int expand[] = {0, ((std::cerr << parts), 0)...};
+    (void)expand;
+    std::cerr << std::endl;
+  }
+};
+
+/// No diagnostics. Timing and watchdog paths compile away, and errors are
+/// only reported through exceptions.
+struct NullInstrumentation
+{
+  static const bool enabled = false;
+
+  template <typename... Ts>
+  static void log(const Ts&...) {}
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
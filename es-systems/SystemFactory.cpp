@@ -15,7 +15,7 @@ std::shared_ptr<CPM_ES_NS::BaseSystem> SystemFactory::newSystemFromName(const ch
   auto it = mMap.find(name);
   if (it != mMap.end())
   {
-    return it->second();
+    return it->second.fun();
   }
   else
   {
@@ -25,5 +25,24 @@ std::shared_ptr<CPM_ES_NS::BaseSystem> SystemFactory::newSystemFromName(const ch
   }
 }
 
+const char* SystemFactory::getRegisteredName(const char* name) const
+{
+  auto it = mMap.find(name);
+  if (it != mMap.end())
+    return it->first.c_str();
+  else
+    return nullptr;
+}
+
+const std::vector<uint64_t>& SystemFactory::getComponentSignature(const char* name) const
+{
+  static const std::vector<uint64_t> emptySignature;
+  auto it = mMap.find(name);
+  if (it != mMap.end())
+    return it->second.signature;
+  else
+    return emptySignature;
+}
+
 } // namespace CPM_ES_SYSTEMS_NS 
 
@@ -5,6 +5,8 @@
 #include <stdexcept>
 #include <entity-system/ESCoreBase.hpp>
 
+#include "ComponentSignature.hpp"
+
 namespace CPM_ES_SYSTEMS_NS {
 
 /// System factory.
@@ -16,8 +18,10 @@ public:
   template <typename T>
   void registerSystem(const char* name)
   {
-    ClassFactoryFunPtr fun = &createSystem<T>;
-    auto ret = mMap.insert(std::make_pair(name, fun));
+    SystemEntry entry;
+    entry.fun       = &createSystem<T>;
+    entry.signature = CPM_ES_SYSTEMS_NS::getComponentSignature<T>();
+    auto ret = mMap.insert(std::make_pair(name, entry));
     if (std::get<1>(ret) == false)
     {
       std::cerr << "cpm-es-systems: Duplicate system name: " << name << std::endl;
@@ -32,6 +36,15 @@ public:
   /// True if the system with the given name exists in our map.
   bool hasSystem(const char* name);
 
+  /// Returns the name \p name was registered under, as a pointer that stays
+  /// valid until clearSystems is called. nullptr if \p name is unknown.
+  const char* getRegisteredName(const char* name) const;
+
+  /// Sorted component type IDs walked by the system registered under
+  /// \p name. Empty if the system is unknown or does not derive from
+  /// GenericSystem.
+  const std::vector<uint64_t>& getComponentSignature(const char* name) const;
+
   /// Clear registered systems.
   void clearSystems() {mMap.clear();}
 
@@ -43,7 +56,13 @@ private:
     return std::shared_ptr<CPM_ES_NS::BaseSystem>(new T);
   }
 
-  std::map<std::string, ClassFactoryFunPtr> mMap;
+  struct SystemEntry
+  {
+    ClassFactoryFunPtr    fun;        ///< Creates a new instance of the system.
+    std::vector<uint64_t> signature;  ///< Component types the system walks.
+  };
+
+  std::map<std::string, SystemEntry> mMap;
 };
 
 } // namespace CPM_ES_SYSTEMS_NS 
@@ -0,0 +1,283 @@
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "SystemRecordStream.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+namespace {
+
+const uint8_t Magic[4] = {'E', 'S', 'S', 'R'};
+
+/// Size of the descriptor buffers. Holds the largest possible record.
+const size_t BufferSize = 4096;
+
+/// Fixed size of a record after its name.
+const size_t RecordBodySize = 4 * 8 + 2 * 4 + 1;
+
+/// Size of the elasticity fields that follow elastic records.
+const size_t ElasticBodySize = 3 * 8;
+
+const uint8_t FlagRemoved = 1;
+const uint8_t FlagElastic = 2;
+const uint8_t FlagCost = 4;
+
+void fail(const char* message)
+{
+  std::cerr << "cpm-es-system: " << message << std::endl;
+  throw std::runtime_error(message);
+}
+
+} // anonymous namespace
+
+//------------------------------------------------------------------------------
+// SystemRecordWriter
+//------------------------------------------------------------------------------
+
+SystemRecordWriter::SystemRecordWriter(int fd) :
+    mFD(fd),
+    mOut(nullptr)
+{
+  mBuffer.reserve(BufferSize);
+  put(Magic, sizeof(Magic));
+  putU32(record_stream::Version);
+}
+
+SystemRecordWriter::SystemRecordWriter(std::vector<uint8_t>& out) :
+    mFD(-1),
+    mOut(&out)
+{
+  put(Magic, sizeof(Magic));
+  putU32(record_stream::Version);
+}
+
+SystemRecordWriter::~SystemRecordWriter()
+{
+  try
+  {
+    flush();
+  }
+  catch (const std::exception&)
+  {
+  }
+}
+
+void SystemRecordWriter::write(const std::string& name, const SystemSnapshotRecord& record)
+{
+  if (name.size() > record_stream::MaxNameLength)
+    fail("System name too long for record stream.");
+
+  putU16(static_cast<uint16_t>(name.size()));
+  put(name.data(), name.size());
+  putU64(record.interval);
+  putU64(record.stagger);
+  putU64(record.nextExec);
+  putU64(record.tickNS);
+  putU32(static_cast<uint32_t>(record.slices));
+  putU32(static_cast<uint32_t>(record.sliceCursor));
+  uint8_t flags = (record.removed ? FlagRemoved : 0) | (record.elastic() ? FlagElastic : 0)
+      | (record.costNS != 0 ? FlagCost : 0);
+  put(&flags, 1);
+  if (record.elastic())
+  {
+    putU64(record.minInterval);
+    putU64(record.maxInterval);
+    putU64(record.effectiveInterval);
+  }
+  if (record.costNS != 0)
+    putU64(record.costNS);
+}
+
+void SystemRecordWriter::flush()
+{
+  size_t written = 0;
+  while (written < mBuffer.size())
+  {
+    ssize_t n = ::write(mFD, mBuffer.data() + written, mBuffer.size() - written);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+    {
+      mBuffer.clear();
+      fail("Unable to write record stream.");
+    }
+    written += static_cast<size_t>(n);
+  }
+  mBuffer.clear();
+}
+
+void SystemRecordWriter::put(const void* data, size_t size)
+{
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  if (mOut != nullptr)
+  {
+    mOut->insert(mOut->end(), bytes, bytes + size);
+    return;
+  }
+
+  if (mBuffer.size() + size > BufferSize)
+    flush();
+  mBuffer.insert(mBuffer.end(), bytes, bytes + size);
+}
+
+void SystemRecordWriter::putU16(uint16_t v)
+{
+  uint8_t b[2] = {static_cast<uint8_t>(v), static_cast<uint8_t>(v >> 8)};
+  put(b, sizeof(b));
+}
+
+void SystemRecordWriter::putU32(uint32_t v)
+{
+  uint8_t b[4];
+  for (int i = 0; i < 4; ++i)
+    b[i] = static_cast<uint8_t>(v >> (8 * i));
+  put(b, sizeof(b));
+}
+
+void SystemRecordWriter::putU64(uint64_t v)
+{
+  uint8_t b[8];
+  for (int i = 0; i < 8; ++i)
+    b[i] = static_cast<uint8_t>(v >> (8 * i));
+  put(b, sizeof(b));
+}
+
+//------------------------------------------------------------------------------
+// SystemRecordReader
+//------------------------------------------------------------------------------
+
+SystemRecordReader::SystemRecordReader(int fd) :
+    mFD(fd),
+    mCursor(nullptr),
+    mEnd(nullptr),
+    mHeaderRead(false)
+{
+  mBuffer.resize(BufferSize);
+  mCursor = mEnd = mBuffer.data();
+}
+
+SystemRecordReader::SystemRecordReader(const void* data, size_t size) :
+    mFD(-1),
+    mCursor(static_cast<const uint8_t*>(data)),
+    mEnd(static_cast<const uint8_t*>(data) + size),
+    mHeaderRead(false)
+{
+}
+
+bool SystemRecordReader::next(std::string& name, SystemSnapshotRecord& record)
+{
+  if (!mHeaderRead)
+    readHeader();
+
+  if (!fill(2))
+  {
+    if (mCursor != mEnd)
+      fail("Truncated record stream.");
+    return false;
+  }
+
+  size_t length = getU16();
+  if (length > record_stream::MaxNameLength)
+    fail("Malformed record stream.");
+  if (!fill(length + RecordBodySize))
+    fail("Truncated record stream.");
+
+  name.assign(reinterpret_cast<const char*>(mCursor), length);
+  mCursor += length;
+  record.interval     = getU64();
+  record.stagger      = getU64();
+  record.nextExec     = getU64();
+  record.tickNS       = getU64();
+  if (!SystemSnapshotRecord::validTickNS(record.tickNS))
+    fail("Malformed record stream.");
+  record.slices       = getU32();
+  record.sliceCursor  = getU32();
+  uint8_t flags       = *mCursor++;
+  record.removed      = (flags & FlagRemoved) != 0;
+  record.minInterval = record.maxInterval = record.effectiveInterval = 0;
+  if (flags & FlagElastic)
+  {
+    if (!fill(ElasticBodySize))
+      fail("Truncated record stream.");
+    record.minInterval        = getU64();
+    record.maxInterval        = getU64();
+    record.effectiveInterval  = getU64();
+  }
+  record.costNS = 0;
+  if (flags & FlagCost)
+  {
+    if (!fill(8))
+      fail("Truncated record stream.");
+    record.costNS = getU64();
+  }
+  return true;
+}
+
+bool SystemRecordReader::fill(size_t size)
+{
+  if (static_cast<size_t>(mEnd - mCursor) >= size)
+    return true;
+  if (mFD < 0)
+    return false;
+
+  // Move the unread tail to the front and top the buffer up.
+  size_t remaining = static_cast<size_t>(mEnd - mCursor);
+  std::memmove(mBuffer.data(), mCursor, remaining);
+  mCursor = mBuffer.data();
+  mEnd = mCursor + remaining;
+
+  while (static_cast<size_t>(mEnd - mCursor) < size)
+  {
+    ssize_t n = ::read(mFD, mBuffer.data() + remaining, mBuffer.size() - remaining);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      fail("Unable to read record stream.");
+    if (n == 0)
+      return false;
+    mEnd += n;
+    remaining += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+void SystemRecordReader::readHeader()
+{
+  mHeaderRead = true;
+  if (!fill(sizeof(Magic) + 4) || std::memcmp(mCursor, Magic, sizeof(Magic)) != 0)
+    fail("Not a system record stream.");
+  mCursor += sizeof(Magic);
+  uint32_t version = getU32();
+  if (version == 0 || version > record_stream::Version)
+    fail("Unsupported record stream version.");
+}
+
+uint16_t SystemRecordReader::getU16()
+{
+  uint16_t v = static_cast<uint16_t>(mCursor[0] | (mCursor[1] << 8));
+  mCursor += 2;
+  return v;
+}
+
+uint32_t SystemRecordReader::getU32()
+{
+  uint32_t v = 0;
+  for (int i = 0; i < 4; ++i)
+    v |= static_cast<uint32_t>(mCursor[i]) << (8 * i);
+  mCursor += 4;
+  return v;
+}
+
+uint64_t SystemRecordReader::getU64()
+{
+  uint64_t v = 0;
+  for (int i = 0; i < 8; ++i)
+    v |= static_cast<uint64_t>(mCursor[i]) << (8 * i);
+  mCursor += 8;
+  return v;
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
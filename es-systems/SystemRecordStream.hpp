@@ -0,0 +1,103 @@
+#ifndef IAUNS_ES_SYSTEMS_SYSTEMRECORDSTREAM_HPP
+#define IAUNS_ES_SYSTEMS_SYSTEMRECORDSTREAM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "SystemSnapshot.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Flat binary stream of SystemSnapshotRecords. Unlike a Tny tree it can be
+/// produced and consumed one record at a time, so loading a snapshot needs
+/// a fixed amount of memory regardless of how many systems it holds.
+///
+/// Layout: the magic "ESSR" and a 32 bit version, followed by records of
+/// a 16 bit name length, the name, then interval, stagger, nextExec and
+/// tickNS as 64 bit values, slices and sliceCursor as 32 bit values and a
+/// flags byte (bit 0: removed, bit 1: elastic, bit 2: cost). Elastic
+/// records continue with minInterval, maxInterval and effectiveInterval as
+/// 64 bit values, and costed records end with costNS as a 64 bit value. All
+/// integers are little endian. Older streams, which predate elastic and
+/// costed records, are still read.
+namespace record_stream {
+
+static const size_t MaxNameLength = 1024;
+static const uint32_t Version = 3;
+
+} // namespace record_stream
+
+/// Writes a record stream to a file descriptor or to memory.
+class SystemRecordWriter
+{
+public:
+  /// Writes to \p fd, which remains owned by the caller.
+  explicit SystemRecordWriter(int fd);
+
+  /// Appends to \p out.
+  explicit SystemRecordWriter(std::vector<uint8_t>& out);
+
+  /// Flushes.
+  ~SystemRecordWriter();
+
+  /// Appends a record. Throws std::runtime_error if \p name is longer than
+  /// record_stream::MaxNameLength or the descriptor cannot be written.
+  void write(const std::string& name, const SystemSnapshotRecord& record);
+
+  /// Writes out buffered data.
+  void flush();
+
+private:
+  SystemRecordWriter(const SystemRecordWriter&);
+  SystemRecordWriter& operator=(const SystemRecordWriter&);
+
+  void put(const void* data, size_t size);
+  void putU16(uint16_t v);
+  void putU32(uint32_t v);
+  void putU64(uint64_t v);
+
+  int                     mFD;        ///< -1 if writing to memory.
+  std::vector<uint8_t>*   mOut;
+  std::vector<uint8_t>    mBuffer;    ///< Pending bytes for mFD.
+};
+
+/// Reads a record stream from a file descriptor or a memory buffer. Reads
+/// from a descriptor go through a fixed size buffer.
+class SystemRecordReader
+{
+public:
+  /// Reads from \p fd, which remains owned by the caller.
+  explicit SystemRecordReader(int fd);
+
+  /// Reads from \p size bytes at \p data, which must outlive the reader.
+  SystemRecordReader(const void* data, size_t size);
+
+  /// Reads the next record. Returns false at the end of the stream. Throws
+  /// std::runtime_error on malformed or truncated data.
+  bool next(std::string& name, SystemSnapshotRecord& record);
+
+private:
+  SystemRecordReader(const SystemRecordReader&);
+  SystemRecordReader& operator=(const SystemRecordReader&);
+
+  /// Makes at least \p size bytes available at mCursor. Returns false if
+  /// the stream ends first.
+  bool fill(size_t size);
+
+  void readHeader();
+  uint16_t getU16();
+  uint32_t getU32();
+  uint64_t getU64();
+
+  int                   mFD;        ///< -1 if reading from memory.
+  const uint8_t*        mCursor;
+  const uint8_t*        mEnd;
+  std::vector<uint8_t>  mBuffer;    ///< Only used with mFD.
+  bool                  mHeaderRead;
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
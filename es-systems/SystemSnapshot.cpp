@@ -0,0 +1,146 @@
+#include <iostream>
+#include <stdexcept>
+
+#include "SystemSnapshot.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+namespace {
+
+void addNumber(Tny*& obj, const char* key, uint64_t value)
+{
+  obj = Tny_add(obj, TNY_INT64, const_cast<char*>(key), static_cast<void*>(&value), 0);
+}
+
+} // anonymous namespace
+
+void SystemSnapshot::apply(Tny* root)
+{
+  if (root->type != TNY_DICT)
+  {
+    std::cerr << "cpm-es-system: Unexpected type during deserialization." << std::endl;
+    throw std::runtime_error("Unexepected Tny type");
+  }
+
+  while (Tny_hasNext(root))
+  {
+    root = Tny_next(root);
+    if (root->type != TNY_OBJ)
+    {
+      std::cerr << "cpm-es-system: Unexpected type during deserialization." << std::endl;
+      throw std::runtime_error("Unexpected Tny type");
+    }
+
+    SystemSnapshotRecord record = readRecord(root->value.tny);
+    if (record.removed)
+      records.erase(root->key);
+    else
+      records[root->key] = record;
+  }
+}
+
+Tny* SystemSnapshot::write() const
+{
+  Tny* root = Tny_add(NULL, TNY_DICT, NULL, NULL, 0);
+  for (const RecordMap::value_type& entry : records)
+  {
+    if (!entry.second.removed)
+      root = writeRecord(root, entry.first, entry.second);
+  }
+  return root;
+}
+
+Tny* SystemSnapshot::compact(Tny* base, const std::vector<Tny*>& deltas)
+{
+  SystemSnapshot snapshot;
+  snapshot.apply(base);
+  for (Tny* delta : deltas)
+    snapshot.apply(delta);
+  return snapshot.write();
+}
+
+SystemSnapshotRecord SystemSnapshot::readRecord(Tny* comp)
+{
+  if (comp->type != TNY_DICT)
+  {
+    std::cerr << "cpm-es-system: Unexpected type during deserialization." << std::endl;
+    throw std::runtime_error("Unexpected Tny type");
+  }
+
+  SystemSnapshotRecord record;
+  Tny* val = Tny_get(comp, "removed");
+  if (val != NULL && val->value.num != 0)
+  {
+    record.removed = true;
+    return record;
+  }
+
+  val = Tny_get(comp, "interval");
+  if (val == NULL)
+  {
+    std::cerr << "cpm-es-system: System record without an interval." << std::endl;
+    throw std::runtime_error("System record without an interval");
+  }
+  record.interval = val->value.num;
+
+  if ((val = Tny_get(comp, "stagger")) != NULL)
+    record.stagger = val->value.num;
+  if ((val = Tny_get(comp, "nextExec")) != NULL)
+    record.nextExec = val->value.num;
+  if ((val = Tny_get(comp, "tickNS")) != NULL)
+    record.tickNS = val->value.num;
+  if (!SystemSnapshotRecord::validTickNS(record.tickNS))
+  {
+    std::cerr << "cpm-es-system: System record with an invalid tick length." << std::endl;
+    throw std::runtime_error("System record with an invalid tick length");
+  }
+  if ((val = Tny_get(comp, "slices")) != NULL)
+    record.slices = val->value.num;
+  if ((val = Tny_get(comp, "sliceCursor")) != NULL)
+    record.sliceCursor = val->value.num;
+  if ((val = Tny_get(comp, "maxInterval")) != NULL)
+  {
+    record.maxInterval = val->value.num;
+    if ((val = Tny_get(comp, "minInterval")) != NULL)
+      record.minInterval = val->value.num;
+    if ((val = Tny_get(comp, "effectiveInterval")) != NULL)
+      record.effectiveInterval = val->value.num;
+  }
+  if ((val = Tny_get(comp, "costNS")) != NULL)
+    record.costNS = val->value.num;
+
+  return record;
+}
+
+Tny* SystemSnapshot::writeRecord(Tny* root, const std::string& name,
+                                 const SystemSnapshotRecord& record)
+{
+  Tny* obj = Tny_add(NULL, TNY_DICT, NULL, NULL, 0);
+  if (record.removed)
+  {
+    addNumber(obj, "removed", 1);
+  }
+  else
+  {
+    addNumber(obj, "interval", record.interval);
+    addNumber(obj, "stagger", record.stagger);
+    addNumber(obj, "nextExec", record.nextExec);
+    addNumber(obj, "tickNS", record.tickNS);
+    if (record.slices > 1)
+    {
+      addNumber(obj, "slices", record.slices);
+      addNumber(obj, "sliceCursor", record.sliceCursor);
+    }
+    if (record.elastic())
+    {
+      addNumber(obj, "minInterval", record.minInterval);
+      addNumber(obj, "maxInterval", record.maxInterval);
+      addNumber(obj, "effectiveInterval", record.effectiveInterval);
+    }
+    if (record.costNS != 0)
+      addNumber(obj, "costNS", record.costNS);
+  }
+  return Tny_add(root, TNY_OBJ, const_cast<char*>(name.c_str()), obj->root, 0);
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
@@ -0,0 +1,99 @@
+#ifndef IAUNS_ES_SYSTEMS_SYSTEMSNAPSHOT_HPP
+#define IAUNS_ES_SYSTEMS_SYSTEMSNAPSHOT_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <tny/tny.hpp>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Serialized scheduling state of one active system, as written by
+/// SystemCore::serializeActiveSystems.
+struct SystemSnapshotRecord
+{
+  SystemSnapshotRecord() :
+      interval(0),
+      stagger(0),
+      nextExec(0),
+      tickNS(1000000),
+      slices(1),
+      sliceCursor(0),
+      minInterval(0),
+      maxInterval(0),
+      effectiveInterval(0),
+      costNS(0),
+      removed(false)
+  {}
+
+  /// True if \p tickNS is a tick length a core can run at: a nanosecond, a
+  /// microsecond or a millisecond.
+  static bool validTickNS(uint64_t tickNS)
+  {
+    return tickNS == 1 || tickNS == 1000 || tickNS == 1000000;
+  }
+
+  /// True if the system's interval adapts to load.
+  bool elastic() const {return maxInterval != 0;}
+
+  /// True if restoring either record yields the same schedule. The next
+  /// execution time is recalculated on restore and the cost estimate is
+  /// advisory, so neither is compared.
+  bool sameSchedule(const SystemSnapshotRecord& other) const
+  {
+    return interval == other.interval && stagger == other.stagger
+        && tickNS == other.tickNS && slices == other.slices
+        && sliceCursor == other.sliceCursor && minInterval == other.minInterval
+        && maxInterval == other.maxInterval
+        && effectiveInterval == other.effectiveInterval && removed == other.removed;
+  }
+
+  uint64_t  interval;     ///< Requested interval, in ticks of tickNS.
+  uint64_t  stagger;      ///< In ticks of tickNS.
+  uint64_t  nextExec;
+  uint64_t  tickNS;       ///< Defaults to milliseconds for older data.
+  uint64_t  slices;
+  uint64_t  sliceCursor;
+  uint64_t  minInterval;        ///< Elasticity bounds, 0 if not elastic.
+  uint64_t  maxInterval;
+  uint64_t  effectiveInterval;  ///< Interval in use, only set if elastic.
+  uint64_t  costNS;       ///< Smoothed execution cost, 0 if never measured.
+  bool      removed;      ///< Only set in deltas.
+};
+
+/// Active system records keyed by system name. A full snapshot and a delta
+/// share one format: a Tny dictionary mapping system names to records. A
+/// delta additionally holds removal records, and only lists the systems
+/// that changed since the previous checkpoint.
+class SystemSnapshot
+{
+public:
+  typedef std::map<std::string, SystemSnapshotRecord> RecordMap;
+
+  /// Folds the full snapshot or delta \p root into this snapshot. Throws
+  /// std::runtime_error on malformed data.
+  void apply(Tny* root);
+
+  /// Writes all records as a full snapshot. Removal records are dropped.
+  /// The caller is responsible for calling Tny_free on the returned Tny*.
+  Tny* write() const;
+
+  /// Folds \p deltas, in order, into the full snapshot \p base and returns
+  /// the result as a new full snapshot. The inputs are not modified.
+  static Tny* compact(Tny* base, const std::vector<Tny*>& deltas);
+
+  /// Parses the record stored in \p comp.
+  static SystemSnapshotRecord readRecord(Tny* comp);
+
+  /// Appends \p record under \p name to the dictionary ending at \p root and
+  /// returns the new last element.
+  static Tny* writeRecord(Tny* root, const std::string& name,
+                          const SystemSnapshotRecord& record);
+
+  RecordMap records;
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef IAUNS_ES_SYSTEMS_SYSTEMTIMINGSTATS_HPP
+#define IAUNS_ES_SYSTEMS_SYSTEMTIMINGSTATS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Per system execution statistics. Histograms use fixed power of two
+/// buckets so recording never allocates: bucket 0 counts values of 0 and
+/// bucket b counts values in [2^(b-1), 2^b). The last bucket also holds
+/// everything larger.
+struct SystemTimingStats
+{
+  static const size_t NumBuckets = 32;
+
+  SystemTimingStats() :
+      executions(0),
+      maxLateness(0),
+      totalDurationUS(0),
+      maxDurationUS(0)
+  {
+    for (size_t i = 0; i < NumBuckets; ++i)
+    {
+      latenessHistogram[i] = 0;
+      durationHistogram[i] = 0;
+    }
+  }
+
+  /// Records one execution that started \p lateness after it was scheduled
+  /// (in reference time units) and ran for \p durationUS microseconds.
+  void record(uint64_t lateness, uint64_t durationUS)
+  {
+    ++executions;
+    ++latenessHistogram[bucket(lateness)];
+    ++durationHistogram[bucket(durationUS)];
+    if (lateness > maxLateness) maxLateness = lateness;
+    if (durationUS > maxDurationUS) maxDurationUS = durationUS;
+    totalDurationUS += durationUS;
+  }
+
+  /// Histogram bucket that \p value falls in.
+  static size_t bucket(uint64_t value)
+  {
+    size_t b = 0;
+    while (value != 0 && b < NumBuckets - 1)
+    {
+      value >>= 1;
+      ++b;
+    }
+    return b;
+  }
+
+  uint64_t executions;                      ///< Number of recorded executions.
+  uint64_t maxLateness;                     ///< Worst lateness seen.
+  uint64_t totalDurationUS;                 ///< Sum of all durations.
+  uint64_t maxDurationUS;                   ///< Longest single execution.
+  uint64_t latenessHistogram[NumBuckets];   ///< Actual minus scheduled reference time.
+  uint64_t durationHistogram[NumBuckets];   ///< Execution time in microseconds.
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
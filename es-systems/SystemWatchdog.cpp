@@ -0,0 +1,71 @@
+#include "SystemWatchdog.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+SystemWatchdog::SystemWatchdog(std::chrono::microseconds budget,
+                               OverrunCallback callback) :
+    mBudget(budget),
+    mCallback(callback),
+    mRunning(nullptr),
+    mStart(0),
+    mSequence(0),
+    mQuit(false)
+{
+  mThread = std::thread(&SystemWatchdog::run, this);
+}
+
+SystemWatchdog::~SystemWatchdog()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mQuit = true;
+  }
+  mCondition.notify_all();
+  mThread.join();
+}
+
+void SystemWatchdog::run()
+{
+  // Poll a few times per budget so overruns are reported promptly, without
+  // spinning on very small budgets.
+  std::chrono::microseconds period = mBudget / 4;
+  if (period < std::chrono::microseconds(100))   period = std::chrono::microseconds(100);
+  if (period > std::chrono::microseconds(100000)) period = std::chrono::microseconds(100000);
+
+  uint64_t lastFlagged = 0;
+  bool hasFlagged = false;
+
+  std::unique_lock<std::mutex> lock(mMutex);
+  while (!mQuit)
+  {
+    mCondition.wait_for(lock, period);
+    if (mQuit)
+      break;
+
+    const char* name = mRunning.load(std::memory_order_acquire);
+    if (name == nullptr)
+      continue;
+
+    // Skip this round if the simulation thread moved on to another system
+    // while we were sampling.
+    uint64_t sequence = mSequence.load(std::memory_order_relaxed);
+    int64_t start     = mStart.load(std::memory_order_relaxed);
+    if (sequence != mSequence.load(std::memory_order_relaxed))
+      continue;
+    if (hasFlagged && sequence == lastFlagged)
+      continue;
+
+    std::chrono::microseconds elapsed(now() - start);
+    if (elapsed > mBudget)
+    {
+      lastFlagged = sequence;
+      hasFlagged = true;
+
+      lock.unlock();
+      mCallback(name, elapsed);
+      lock.lock();
+    }
+  }
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
@@ -0,0 +1,71 @@
+#ifndef IAUNS_ES_SYSTEMS_SYSTEMWATCHDOG_HPP
+#define IAUNS_ES_SYSTEMS_SYSTEMWATCHDOG_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// Watches the simulation thread from a separate thread and reports any
+/// system that stays inside walkComponents for longer than a budget. The
+/// simulation thread only performs a few atomic stores per system; it never
+/// waits on the watchdog.
+class SystemWatchdog
+{
+public:
+  /// Called on the watchdog thread, at most once per execution, with the
+  /// name of the overrunning system and how long it has been running so far.
+  typedef std::function<void(const char* systemName,
+                             std::chrono::microseconds elapsed)> OverrunCallback;
+
+  SystemWatchdog(std::chrono::microseconds budget, OverrunCallback callback);
+  ~SystemWatchdog();
+
+  /// Called by the simulation thread right before a system executes.
+  /// \p systemName must remain valid for the lifetime of the watchdog.
+  void enter(const char* systemName)
+  {
+    mStart.store(now(), std::memory_order_relaxed);
+    mSequence.fetch_add(1, std::memory_order_relaxed);
+    mRunning.store(systemName, std::memory_order_release);
+  }
+
+  /// Called by the simulation thread right after a system executes.
+  void leave()
+  {
+    mRunning.store(nullptr, std::memory_order_release);
+  }
+
+private:
+  SystemWatchdog(const SystemWatchdog&);
+  SystemWatchdog& operator=(const SystemWatchdog&);
+
+  static int64_t now()
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  void run();
+
+  const std::chrono::microseconds mBudget;
+  const OverrunCallback           mCallback;
+
+  std::atomic<const char*>        mRunning;   ///< Executing system, or nullptr.
+  std::atomic<int64_t>            mStart;     ///< Start of the current execution.
+  std::atomic<uint64_t>           mSequence;  ///< Incremented on every enter.
+
+  std::mutex                      mMutex;
+  std::condition_variable         mCondition;
+  bool                            mQuit;
+  std::thread                     mThread;
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
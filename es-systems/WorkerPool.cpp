@@ -0,0 +1,202 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#endif
+
+#include "WorkerPool.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+namespace {
+
+struct PinRequest
+{
+  WorkerPoolConfig::PinFunction pin;
+  std::vector<int>              cpus;
+  bool                          result;
+};
+
+void pinJob(void* context)
+{
+  PinRequest* request = static_cast<PinRequest*>(context);
+  request->result = request->pin(request->cpus);
+}
+
+} // anonymous namespace
+
+CpuTopology CpuTopology::detect(const char* nodeDir)
+{
+  CpuTopology topology;
+
+#ifdef __linux__
+  // Node ids may have gaps, so list the directory rather than counting up.
+  bool anyCpus = false;
+  DIR* dir = opendir(nodeDir);
+  if (dir != nullptr)
+  {
+    while (struct dirent* entry = readdir(dir))
+    {
+      char* end;
+      if (std::strncmp(entry->d_name, "node", 4) != 0)
+        continue;
+      long node = std::strtol(entry->d_name + 4, &end, 10);
+      if (end == entry->d_name + 4 || *end != '\0' || node < 0 || node > 4095)
+        continue;
+
+      std::string path = std::string(nodeDir) + "/" + entry->d_name + "/cpulist";
+      FILE* file = std::fopen(path.c_str(), "r");
+      if (file == nullptr)
+        continue;
+      char list[4096];
+      bool ok = std::fgets(list, sizeof(list), file) != nullptr;
+      std::fclose(file);
+
+      if (topology.nodes.size() <= static_cast<size_t>(node))
+        topology.nodes.resize(static_cast<size_t>(node) + 1);
+      if (ok)
+        topology.nodes[node] = parseCpuList(list);
+      anyCpus = anyCpus || !topology.nodes[node].empty();
+    }
+    closedir(dir);
+  }
+  if (!anyCpus)
+    topology.nodes.clear();
+#else
+  (void)nodeDir;
+#endif
+
+  if (topology.nodes.empty())
+  {
+    unsigned count = std::thread::hardware_concurrency();
+    std::vector<int> cpus;
+    for (unsigned i = 0; i < (count == 0 ? 1 : count); ++i)
+      cpus.push_back(static_cast<int>(i));
+    topology.nodes.push_back(cpus);
+  }
+  return topology;
+}
+
+std::vector<int> CpuTopology::parseCpuList(const char* list)
+{
+  std::vector<int> cpus;
+  const char* p = list;
+  while (*p != '\0')
+  {
+    char* end;
+    long first = std::strtol(p, &end, 10);
+    if (end == p)
+      break;
+    long last = first;
+    p = end;
+    if (*p == '-')
+    {
+      last = std::strtol(p + 1, &end, 10);
+      p = end;
+    }
+    for (long cpu = first; cpu <= last; ++cpu)
+      cpus.push_back(static_cast<int>(cpu));
+    if (*p == ',')
+      ++p;
+    else
+      break;
+  }
+  return cpus;
+}
+
+const size_t WorkerPool::NoWorkers;
+
+WorkerPool::WorkerPool(const WorkerPoolConfig& config) :
+    mNumNodes(config.topology.nodes.empty() ? 1 : config.topology.nodes.size()),
+    mWorkersPerNode(config.workersPerNode == 0 ? 1 : config.workersPerNode)
+{
+  PinRequest request;
+  request.pin = (config.pin != nullptr) ? config.pin : &WorkerPool::pinCurrentThread;
+
+  bool anyCpus = false;
+  for (const std::vector<int>& cpus : config.topology.nodes)
+    anyCpus = anyCpus || !cpus.empty();
+
+  for (size_t node = 0; node < mNumNodes; ++node)
+  {
+    bool hasCpus = node < config.topology.nodes.size() && !config.topology.nodes[node].empty();
+    if (anyCpus && !hasCpus)
+    {
+      mNodeWorkers.push_back(NoWorkers);
+      continue;
+    }
+
+    mNodeWorkers.push_back(mWorkers.size());
+    for (size_t i = 0; i < mWorkersPerNode; ++i)
+    {
+      mWorkers.push_back(std::unique_ptr<OverlapWorker>(new OverlapWorker()));
+      mWorkerNodes.push_back(node);
+      if (config.pinning == PIN_NONE || !hasCpus)
+        continue;
+
+      const std::vector<int>& cpus = config.topology.nodes[node];
+      if (config.pinning == PIN_CORE)
+        request.cpus.assign(1, cpus[i % cpus.size()]);
+      else
+        request.cpus = cpus;
+
+      // Pin from the worker itself, so no native thread handle is needed.
+      run(mWorkers.size() - 1, &pinJob, &request);
+      if (!request.result)
+      {
+        std::cerr << "cpm-es-system: Unable to pin worker " << mWorkers.size() - 1
+                  << " to node " << node << "." << std::endl;
+      }
+    }
+  }
+}
+
+size_t WorkerPool::worker(int node, size_t n) const
+{
+  if (node < 0 || static_cast<size_t>(node) >= mNumNodes
+      || mNodeWorkers[static_cast<size_t>(node)] == NoWorkers)
+    return n % mWorkers.size();
+  return mNodeWorkers[static_cast<size_t>(node)] + n % mWorkersPerNode;
+}
+
+void WorkerPool::submit(size_t worker, OverlapWorker::Job job, void* context)
+{
+  mWorkers[worker]->submit(job, context);
+}
+
+void WorkerPool::run(size_t worker, OverlapWorker::Job job, void* context)
+{
+  mWorkers[worker]->submit(job, context);
+  mWorkers[worker]->wait();
+}
+
+void WorkerPool::waitAll()
+{
+  for (const std::unique_ptr<OverlapWorker>& worker : mWorkers)
+    worker->wait();
+}
+
+bool WorkerPool::pinCurrentThread(const std::vector<int>& cpus)
+{
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus)
+  {
+    if (cpu >= 0 && cpu < CPU_SETSIZE)
+      CPU_SET(cpu, &set);
+  }
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+  (void)cpus;
+  return false;
+#endif
+}
+
+} // namespace CPM_ES_SYSTEMS_NS
@@ -0,0 +1,107 @@
+#ifndef IAUNS_ES_SYSTEMS_WORKERPOOL_HPP
+#define IAUNS_ES_SYSTEMS_WORKERPOOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "OverlapWorker.hpp"
+
+namespace CPM_ES_SYSTEMS_NS {
+
+/// NUMA nodes of the machine and the CPUs that belong to each.
+struct CpuTopology
+{
+  /// CPU numbers of every node, indexed by the kernel's node id. Nodes
+  /// without CPUs, such as memory only nodes, and ids the kernel does not
+  /// use hold an empty list.
+  std::vector<std::vector<int> > nodes;
+
+  /// Reads the topology from the node directories under \p nodeDir on
+  /// Linux. Elsewhere, or if that fails, returns a single node holding
+  /// every hardware thread.
+  static CpuTopology detect(const char* nodeDir = "/sys/devices/system/node");
+
+  /// Parses a Linux cpulist such as "0-3,8-11".
+  static std::vector<int> parseCpuList(const char* list);
+};
+
+/// How worker threads are restricted to CPUs.
+enum WorkerPinning
+{
+  PIN_NONE,   ///< Let the OS place workers.
+  PIN_NODE,   ///< Restrict each worker to the CPUs of its node.
+  PIN_CORE    ///< Restrict each worker to one CPU of its node.
+};
+
+struct WorkerPoolConfig
+{
+  /// Pins the calling thread to \p cpus, returning false on failure.
+  typedef bool (*PinFunction)(const std::vector<int>& cpus);
+
+  WorkerPoolConfig() :
+      topology(CpuTopology::detect()),
+      workersPerNode(1),
+      pinning(PIN_NODE),
+      pin(nullptr)
+  {}
+
+  CpuTopology   topology;
+  size_t        workersPerNode;
+  WorkerPinning pinning;
+
+  /// Replaces the OS call, for example to test with a fake topology.
+  /// nullptr selects WorkerPool::pinCurrentThread.
+  PinFunction   pin;
+};
+
+/// Worker threads grouped by NUMA node, workersPerNode for every node with
+/// CPUs. Nodes without CPUs get no workers, unless no node has any, as in a
+/// topology that is not known. Each worker runs one job at a time.
+class WorkerPool
+{
+public:
+  explicit WorkerPool(const WorkerPoolConfig& config);
+
+  size_t size() const {return mWorkers.size();}
+  size_t numNodes() const {return mNumNodes;}
+
+  /// Node worker \p worker belongs to.
+  size_t node(size_t worker) const {return mWorkerNodes[worker];}
+
+  /// The \p n'th worker of \p node, wrapping around. A negative \p node,
+  /// or one without workers, spreads over all workers.
+  size_t worker(int node, size_t n) const;
+
+  /// Runs \p job(\p context) on \p worker. Waits for that worker's previous
+  /// job first.
+  void submit(size_t worker, OverlapWorker::Job job, void* context);
+
+  /// Runs \p job(\p context) on \p worker and waits for it. Memory the job
+  /// touches first is placed on the worker's node by the kernel.
+  void run(size_t worker, OverlapWorker::Job job, void* context);
+
+  /// Waits until every worker is idle.
+  void waitAll();
+
+  /// Restricts the calling thread to \p cpus. Linux only, returns false
+  /// elsewhere.
+  static bool pinCurrentThread(const std::vector<int>& cpus);
+
+private:
+  WorkerPool(const WorkerPool&);
+  WorkerPool& operator=(const WorkerPool&);
+
+  static const size_t NoWorkers = static_cast<size_t>(-1);
+
+  std::vector<std::unique_ptr<OverlapWorker> > mWorkers;
+  size_t mNumNodes;
+  size_t mWorkersPerNode;
+  std::vector<size_t> mNodeWorkers;   ///< First worker of each node, or NoWorkers.
+  std::vector<size_t> mWorkerNodes;   ///< Node of each worker.
+};
+
+} // namespace CPM_ES_SYSTEMS_NS
+
+#endif
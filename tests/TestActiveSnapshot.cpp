@@ -0,0 +1,161 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+class Physics : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  static const char* getName() {return "Physics";}
+};
+
+class Network : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  static const char* getName() {return "Network";}
+};
+
+TEST(EntitySystem, PublishedValueSlots)
+{
+  esys::PublishedValue<int> value(2);
+  EXPECT_FALSE(value.acquire());
+
+  value.publish(std::unique_ptr<int>(new int(1)));
+  esys::PublishedValue<int>::Reference one = value.acquire();
+  value.publish(std::unique_ptr<int>(new int(2)));
+  esys::PublishedValue<int>::Reference two = value.acquire();
+  EXPECT_EQ(1, *one);
+  EXPECT_EQ(2, *two);
+
+  // Both slots are pinned, so 3 waits without blocking the writer.
+  value.publish(std::unique_ptr<int>(new int(3)));
+  EXPECT_TRUE(value.hasPending());
+  EXPECT_EQ(2, *value.acquire());
+
+  one.reset();
+  value.reclaim();
+  EXPECT_FALSE(value.hasPending());
+  EXPECT_EQ(3, *value.acquire());
+  EXPECT_EQ(1u, value.retiredCount());
+
+  two.reset();
+  value.reclaim();
+  EXPECT_EQ(0u, value.retiredCount());
+}
+
+TEST(EntitySystem, ActiveSystemSnapshot)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  systems->registerSystem<Physics>();
+  systems->registerSystem<Network>();
+
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->renormalize(true);
+
+  EXPECT_FALSE(systems->getActiveSystems());
+
+  systems->addActiveSystemViaType<Physics>(16, 0, 2);
+  systems->addActiveSystemViaType<Network>(50);
+  systems->renormalize();
+
+  auto first = systems->getActiveSystems();
+  ASSERT_TRUE(first);
+  ASSERT_EQ(2u, first->systems.size());
+  EXPECT_EQ("Network", first->systems[0].name);
+  const esys::ActiveSystemSnapshot::Entry* physics = first->find(Physics::getName());
+  ASSERT_TRUE(physics != nullptr);
+  EXPECT_EQ(std::chrono::milliseconds(16), physics->interval);
+  EXPECT_EQ(std::chrono::milliseconds(14), physics->nextExecution);
+
+  // A pinned copy is unaffected by later changes and keeps its systems
+  // alive until released.
+  std::weak_ptr<es::BaseSystem> network = first->find(Network::getName())->system;
+  systems->removeActiveSystemViaType<Network>();
+  systems->renormalize();
+  EXPECT_FALSE(systems->getActiveSystems()->isActive(Network::getName()));
+  EXPECT_TRUE(first->isActive(Network::getName()));
+  EXPECT_GT(systems->getActiveSystems()->generation, first->generation);
+
+  systems->renormalize();
+  EXPECT_FALSE(network.expired());
+  first.reset();
+  systems->renormalize();
+  EXPECT_TRUE(network.expired());
+}
+
+TEST(EntitySystem, ActiveSystemSnapshotReaders)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  systems->registerSystem<Physics>();
+  systems->registerSystem<Network>();
+
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->renormalize(true);
+
+  systems->addActiveSystemViaType<Physics>(1);
+  systems->renormalize();
+
+  // Readers only ever see whole copies: Physics is always there, Network
+  // comes and goes, generations never go backwards.
+  std::atomic<bool> stop(false);
+  std::atomic<int> failures(0);
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 3; ++r)
+  {
+    readers.push_back(std::thread([&systems, &stop, &failures]()
+    {
+      uint64_t lastGeneration = 0;
+      while (!stop.load())
+      {
+        auto snapshot = systems->getActiveSystems();
+        if (!snapshot->isActive(Physics::getName()) || snapshot->systems.size() > 2
+            || snapshot->generation < lastGeneration)
+          ++failures;
+        lastGeneration = snapshot->generation;
+      }
+    }));
+  }
+
+  for (uint64_t t = 0; t < 500; ++t)
+  {
+    if (t % 2 == 0)
+      systems->addActiveSystemViaType<Network>(1);
+    else
+      systems->removeActiveSystemViaType<Network>();
+    systems->runSystems(*core, t);
+    systems->renormalize();
+  }
+
+  stop.store(true);
+  for (std::thread& reader : readers)
+    reader.join();
+  EXPECT_EQ(0, failures.load());
+}
+
+}
+
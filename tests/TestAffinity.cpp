@@ -0,0 +1,218 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+struct CompGameplay
+{
+  CompGameplay() : health(0), armor(0) {}
+  CompGameplay(int healthIn, int armorIn) : health(healthIn), armor(armorIn) {}
+
+  int32_t health;
+  int32_t armor;
+};
+
+static std::vector<std::string> execStack;
+
+void addToExecutionStack(const std::string& name)
+{
+  if (execStack.size() == 0 || execStack.back() != name)
+  {
+    execStack.push_back(name);
+  }
+}
+
+class A : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {addToExecutionStack(getName());}
+  static const char* getName() {return "A";}
+};
+
+class B : public es::GenericSystem<false, CompGameplay>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompGameplay*) override {addToExecutionStack(getName());}
+  static const char* getName() {return "B";}
+};
+
+class C : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {addToExecutionStack(getName());}
+  static const char* getName() {return "C";}
+};
+
+class D : public es::GenericSystem<false, CompGameplay>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompGameplay*) override {addToExecutionStack(getName());}
+  static const char* getName() {return "D";}
+};
+
+TEST(EntitySystem, AffinityOrdering)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  systems->registerSystem<A>();
+  systems->registerSystem<B>();
+  systems->registerSystem<C>();
+  systems->registerSystem<D>();
+
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->addComponent(id, CompGameplay(10, 20));
+  core->renormalize(true);
+
+  systems->addActiveSystemViaType<D>();
+  systems->addActiveSystemViaType<C>();
+  systems->addActiveSystemViaType<B>();
+  systems->addActiveSystemViaType<A>();
+  systems->renormalize();
+
+  execStack.clear();
+  systems->runSystems(*core, 0);
+  std::vector<std::string> alphabetical = {"A", "B", "C", "D"};
+  EXPECT_EQ(alphabetical, execStack);
+
+  // Systems walking the same components should now be back to back.
+  systems->setComponentAffinityOrdering(true);
+  execStack.clear();
+  systems->runSystems(*core, 1);
+  ASSERT_EQ(4u, execStack.size());
+  std::vector<std::string> posFirst = {"A", "C", "B", "D"};
+  std::vector<std::string> gameplayFirst = {"B", "D", "A", "C"};
+  EXPECT_TRUE(execStack == posFirst || execStack == gameplayFirst);
+
+  systems->setComponentAffinityOrdering(false);
+  execStack.clear();
+  systems->runSystems(*core, 2);
+  EXPECT_EQ(alphabetical, execStack);
+}
+
+// Benchmarks comparing alphabetical and affinity ordering. Systems are named
+// so that alphabetical order interleaves four component arrays that together
+// do not fit in the last level cache, while any single one of them does.
+// Each ordering has its own test, which reports the time and, where perf
+// events are available, the LLC misses of its timed frames only. Disabled
+// by default. Run them one at a time, so that each has a cold process:
+//   ./system_tests --gtest_also_run_disabled_tests
+//     --gtest_filter='*AffinityBenchmarkAlphabetical'
+//   ./system_tests --gtest_also_run_disabled_tests
+//     --gtest_filter='*AffinityBenchmarkAffinity'
+template <int N>
+struct BenchComp
+{
+  BenchComp() : value(0) {}
+  explicit BenchComp(float v) : value(v) {}
+
+  float value;
+  float payload[15];
+};
+
+static float benchSink = 0.0f;
+
+template <int Index, int Comp>
+class BenchSystem : public es::GenericSystem<false, BenchComp<Comp>>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const BenchComp<Comp>* c) override
+  {
+    benchSink += c->value;
+  }
+
+  static const char* getName()
+  {
+    static const std::string name = "bench:" + std::to_string(Index / 10) + std::to_string(Index % 10);
+    return name.c_str();
+  }
+};
+
+template <int Index>
+void registerBench(esys::SystemCore& systems)
+{
+  systems.registerSystem<BenchSystem<Index, Index % 4>>();
+  systems.addActiveSystemViaType<BenchSystem<Index, Index % 4>>();
+}
+
+void runAffinityBenchmark(bool affinity)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  const int numEntities = 1 << 16;
+  for (int i = 0; i < numEntities; ++i)
+  {
+    uint64_t id = core->getNewEntityID();
+    core->addComponent(id, BenchComp<0>(1.0f));
+    core->addComponent(id, BenchComp<1>(1.0f));
+    core->addComponent(id, BenchComp<2>(1.0f));
+    core->addComponent(id, BenchComp<3>(1.0f));
+  }
+  core->renormalize(true);
+
+  registerBench<0>(*systems);  registerBench<1>(*systems);
+  registerBench<2>(*systems);  registerBench<3>(*systems);
+  registerBench<4>(*systems);  registerBench<5>(*systems);
+  registerBench<6>(*systems);  registerBench<7>(*systems);
+  registerBench<8>(*systems);  registerBench<9>(*systems);
+  registerBench<10>(*systems); registerBench<11>(*systems);
+  registerBench<12>(*systems); registerBench<13>(*systems);
+  registerBench<14>(*systems); registerBench<15>(*systems);
+  systems->setComponentAffinityOrdering(affinity);
+  systems->renormalize();
+
+  // One untimed frame so that setup is not counted.
+  systems->runSystems(*core, 0);
+
+  const int numFrames = 50;
+  esys::PerfCounterGroup counters;
+  esys::PerfCounterValues before;
+  esys::PerfCounterValues after;
+  bool counted = counters.read(before);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 1; i <= numFrames; ++i)
+    systems->runSystems(*core, static_cast<uint64_t>(i));
+  auto end = std::chrono::steady_clock::now();
+  counted = counted && counters.read(after);
+
+  std::cout << (affinity ? "Affinity ordering:     " : "Alphabetical ordering: ")
+            << std::chrono::duration<double, std::milli>(end - start).count() << "ms";
+  if (counted)
+    std::cout << ", " << (after.cacheMisses - before.cacheMisses) << " LLC misses";
+  else
+    std::cout << ", LLC misses unavailable";
+  std::cout << std::endl;
+  EXPECT_NE(0.0f, benchSink);
+}
+
+TEST(EntitySystem, DISABLED_AffinityBenchmarkAlphabetical)
+{
+  runAffinityBenchmark(false);
+}
+
+TEST(EntitySystem, DISABLED_AffinityBenchmarkAffinity)
+{
+  runAffinityBenchmark(true);
+}
+
+}
+
@@ -0,0 +1,149 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <es-systems/GlobalAllocationHook.hpp>
+#include <gtest/gtest.h>
+#include <memory>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+class Quiet : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  static const char* getName() {return "Quiet";}
+};
+
+class Quiet2 : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  static const char* getName() {return "Quiet2";}
+};
+
+// Allocates at least once per entity.
+class Leaky : public es::GenericSystem<false, CompPosition>
+{
+public:
+  static std::vector<std::shared_ptr<int>> kept;
+
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override
+  {
+    kept.push_back(std::make_shared<int>(1));
+  }
+  static const char* getName() {return "Leaky";}
+};
+std::vector<std::shared_ptr<int>> Leaky::kept;
+
+// Systems that touch no heap themselves. The entity system's storage walk
+// may allocate, so they are not derived from GenericSystem.
+class Idle : public es::BaseSystem
+{
+public:
+  void walkComponents(es::ESCoreBase&) override {}
+  static const char* getName() {return "Idle";}
+};
+
+class Idle2 : public es::BaseSystem
+{
+public:
+  void walkComponents(es::ESCoreBase&) override {}
+  static const char* getName() {return "Idle2";}
+};
+
+TEST(EntitySystem, SteadyStateDoesNotAllocate)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  systems->registerSystem<Idle>();
+  systems->registerSystem<Idle2>();
+  systems->addActiveSystemViaType<Idle>(3);
+  systems->addActiveSystemViaType<Idle2>(5, 0, 2);
+  systems->setTimingStatistics(true);
+  systems->setAllocationTracking(true);
+  systems->renormalize();
+
+  // Warm up so every buffer reaches its steady state size.
+  uint64_t t = 0;
+  for (; t < 30; ++t)
+  {
+    systems->runSystems(*core, t);
+    systems->renormalize();
+  }
+
+  uint64_t before = esys::allocation_counter::current();
+  for (; t < 1000; t += (t % 7 == 0) ? 2 : 1)
+  {
+    systems->runSystems(*core, t);
+    systems->renormalize();
+  }
+  EXPECT_EQ(0u, esys::allocation_counter::current() - before);
+
+  // The same holds for the precompiled schedule.
+  systems->setPrecompiledSchedule(true);
+  systems->runSystems(*core, t++);
+  before = esys::allocation_counter::current();
+  for (uint64_t end = t + 1000; t < end; ++t)
+  {
+    systems->runSystems(*core, t);
+    systems->renormalize();
+  }
+  EXPECT_EQ(0u, esys::allocation_counter::current() - before);
+  EXPECT_EQ(0u, systems->getPhaseAllocationCount(esys::SystemCore::PHASE_DISPATCH));
+}
+
+TEST(EntitySystem, AllocationTracking)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  systems->registerSystem<Quiet>();
+  systems->registerSystem<Quiet2>();
+  systems->registerSystem<Leaky>();
+
+  for (int i = 0; i < 3; ++i)
+  {
+    uint64_t id = core->getNewEntityID();
+    core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  }
+  core->renormalize(true);
+
+  systems->addActiveSystemViaType<Quiet>(0);
+  systems->addActiveSystemViaType<Leaky>(0);
+  systems->setAllocationTracking(true);
+  systems->renormalize();
+  systems->runSystems(*core, 0);
+  systems->resetAllocationCounts();
+
+  systems->runSystems(*core, 1);
+
+  uint64_t quiet = 0;
+  uint64_t leaky = 0;
+  ASSERT_TRUE(systems->getAllocationCount(Quiet::getName(), quiet));
+  ASSERT_TRUE(systems->getAllocationCount(Leaky::getName(), leaky));
+  EXPECT_LE(3u, leaky);
+  EXPECT_LT(quiet, leaky);
+  EXPECT_LE(quiet + leaky, systems->getPhaseAllocationCount(esys::SystemCore::PHASE_DISPATCH));
+  EXPECT_EQ(0u, systems->getPhaseAllocationCount(esys::SystemCore::PHASE_SCHEDULE));
+
+  // Adding a system is expected to allocate.
+  systems->addActiveSystemViaType<Quiet2>(0);
+  systems->renormalize();
+  EXPECT_LT(0u, systems->getPhaseAllocationCount(esys::SystemCore::PHASE_RENORMALIZE));
+}
+
+}
+
@@ -0,0 +1,233 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <es-systems/BatchedSystem.hpp>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+struct CompHomPos
+{
+  CompHomPos() {}
+  CompHomPos(const glm::vec4& pos) {position = pos;}
+
+  glm::vec4 position;
+};
+
+// Sums position * w over all entities, one batch at a time.
+class BatchSum : public esys::BatchedSystem<CompPosition, CompHomPos>
+{
+public:
+  static std::vector<size_t> batches;
+  static uint64_t idSum;
+  static float sum;
+
+  void executeBatch(es::ESCoreBase&, size_t count, esys::BatchColumn<uint64_t> entityIDs,
+                    esys::BatchColumn<CompPosition> pos, esys::BatchColumn<CompHomPos> homPos) override
+  {
+    batches.push_back(count);
+    float acc = 0.0f;
+    for (size_t i = 0; i < count; ++i)
+    {
+      acc += (pos[i].position.x + pos[i].position.y + pos[i].position.z)
+             * homPos[i].position.w;
+      idSum += entityIDs[i];
+    }
+    sum += acc;
+  }
+
+  static const char* getName() {return "BatchSum";}
+};
+std::vector<size_t> BatchSum::batches;
+uint64_t BatchSum::idSum = 0;
+float BatchSum::sum = 0.0f;
+
+TEST(EntitySystem, BatchedExecution)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  systems->registerSystem<BatchSum>();
+
+  // Entities missing a component are skipped.
+  uint64_t expectedIDs = 0;
+  for (int i = 0; i < 700; ++i)
+  {
+    uint64_t id = core->getNewEntityID();
+    core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+    if (i < 600)
+    {
+      core->addComponent(id, CompHomPos(glm::vec4(1.0, 2.0, 3.0, 0.5)));
+      expectedIDs += id;
+    }
+  }
+  core->renormalize(true);
+
+  systems->addActiveSystemViaType<BatchSum>(0);
+  systems->renormalize();
+  systems->runSystems(*core, 0);
+
+  std::vector<size_t> expected = {256, 256, 88};
+  EXPECT_EQ(expected, BatchSum::batches);
+  EXPECT_EQ(expectedIDs, BatchSum::idSum);
+  EXPECT_FLOAT_EQ(600 * 3.0f, BatchSum::sum);
+
+  // A second frame starts from an empty batch.
+  BatchSum::batches.clear();
+  systems->runSystems(*core, 1);
+  EXPECT_EQ(expected, BatchSum::batches);
+}
+
+// Records where each batch's columns start.
+class BatchProbe : public esys::BatchedSystem<CompPosition, CompHomPos>
+{
+public:
+  static std::vector<uint64_t> firstIDs;
+  static std::vector<const CompPosition*> firstPositions;
+  static std::vector<size_t> batches;
+
+  BatchProbe() : esys::BatchedSystem<CompPosition, CompHomPos>(4) {}
+
+  void executeBatch(es::ESCoreBase&, size_t count, esys::BatchColumn<uint64_t> entityIDs,
+                    esys::BatchColumn<CompPosition> pos, esys::BatchColumn<CompHomPos>) override
+  {
+    firstIDs.push_back(entityIDs[0]);
+    firstPositions.push_back(pos.data());
+    batches.push_back(count);
+  }
+
+  static const char* getName() {return "BatchProbe";}
+};
+std::vector<uint64_t> BatchProbe::firstIDs;
+std::vector<const CompPosition*> BatchProbe::firstPositions;
+std::vector<size_t> BatchProbe::batches;
+
+TEST(EntitySystem, BatchedColumnsAreInPlace)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+  systems->registerSystem<BatchProbe>();
+
+  // Entities 1-6 have both components, 7 has no CompHomPos and 8-10 have
+  // both again, so the join yields two runs.
+  std::vector<uint64_t> ids;
+  for (int i = 0; i < 10; ++i)
+  {
+    uint64_t id = core->getNewEntityID();
+    ids.push_back(id);
+    core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+    if (i != 6)
+      core->addComponent(id, CompHomPos(glm::vec4(1.0, 2.0, 3.0, 1.0)));
+  }
+  core->renormalize(true);
+
+  systems->addActiveSystemViaType<BatchProbe>(0);
+  systems->renormalize();
+  systems->runSystems(*core, 0);
+
+  std::vector<size_t> expectedBatches = {4, 2, 3};
+  EXPECT_EQ(expectedBatches, BatchProbe::batches);
+  std::vector<uint64_t> expectedIDs = {ids[0], ids[4], ids[7]};
+  EXPECT_EQ(expectedIDs, BatchProbe::firstIDs);
+
+  // Columns point at the core's own storage, nothing is gathered.
+  es::ComponentContainer<CompPosition>* positions =
+      dynamic_cast<es::ComponentContainer<CompPosition>*>(
+          core->getComponentContainer(es::TemplateID<CompPosition>::getID()));
+  ASSERT_NE(nullptr, positions);
+  const es::ComponentContainer<CompPosition>::ComponentItem* items = positions->getComponentArray();
+  ASSERT_EQ(3u, BatchProbe::firstPositions.size());
+  EXPECT_EQ(&items[0].component, BatchProbe::firstPositions[0]);
+  EXPECT_EQ(&items[4].component, BatchProbe::firstPositions[1]);
+  EXPECT_EQ(&items[7].component, BatchProbe::firstPositions[2]);
+}
+
+// Benchmark of the per entity dispatch BatchedSystem removes: the same sum
+// over the same components, once through GenericSystem's virtual execute
+// per entity and once a batch at a time. Disabled by default. Run with:
+//   ./system_tests --gtest_also_run_disabled_tests
+//     --gtest_filter='*BatchDispatchBenchmark*'
+class PerEntitySum : public es::GenericSystem<false, CompPosition, CompHomPos>
+{
+public:
+  static float sum;
+
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition* pos,
+               const CompHomPos* homPos) override
+  {
+    sum += pos->position.x * homPos->position.w;
+  }
+
+  static const char* getName() {return "PerEntitySum";}
+};
+float PerEntitySum::sum = 0.0f;
+
+class BatchedSum : public esys::BatchedSystem<CompPosition, CompHomPos>
+{
+public:
+  static float sum;
+
+  void executeBatch(es::ESCoreBase&, size_t count, esys::BatchColumn<uint64_t>,
+                    esys::BatchColumn<CompPosition> pos, esys::BatchColumn<CompHomPos> homPos) override
+  {
+    float acc = 0.0f;
+    for (size_t i = 0; i < count; ++i)
+      acc += pos[i].position.x * homPos[i].position.w;
+    sum += acc;
+  }
+
+  static const char* getName() {return "BatchedSum";}
+};
+float BatchedSum::sum = 0.0f;
+
+template <typename System>
+double nsPerEntity(es::ESCore& core, int numEntities, int numFrames)
+{
+  System system;
+  system.walkComponents(core);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < numFrames; ++i)
+    system.walkComponents(core);
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count()
+      / (static_cast<double>(numEntities) * numFrames);
+}
+
+TEST(EntitySystem, DISABLED_BatchDispatchBenchmark)
+{
+  es::ESCore core;
+  const int numEntities = 1 << 16;
+  for (int i = 0; i < numEntities; ++i)
+  {
+    uint64_t id = core.getNewEntityID();
+    core.addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+    core.addComponent(id, CompHomPos(glm::vec4(1.0, 2.0, 3.0, 0.5)));
+  }
+  core.renormalize(true);
+
+  const int numFrames = 20;
+  double perEntity = nsPerEntity<PerEntitySum>(core, numEntities, numFrames);
+  double batched = nsPerEntity<BatchedSum>(core, numEntities, numFrames);
+  std::cout << "Per entity execute: " << perEntity << "ns/entity" << std::endl;
+  std::cout << "Batched:            " << batched << "ns/entity" << std::endl;
+  EXPECT_FLOAT_EQ(PerEntitySum::sum, BatchedSum::sum);
+  EXPECT_LT(batched, perEntity);
+}
+
+}
+
@@ -0,0 +1,156 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <gtest/gtest.h>
+#include <map>
+#include <memory>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+// Counts the updates of every entity it is handed.
+class Crowd : public es::BaseSystem,
+              public esys::BucketedSystem
+{
+public:
+  static std::map<uint64_t, int> updates;
+  static int walks;
+
+  void walkComponents(es::ESCoreBase&) override {++walks;}
+
+  void walkEntities(es::ESCoreBase&, const uint64_t* entityIDs, size_t count) override
+  {
+    for (size_t i = 0; i < count; ++i)
+      ++updates[entityIDs[i]];
+  }
+
+  static const char* getName() {return "Crowd";}
+};
+std::map<uint64_t, int> Crowd::updates;
+int Crowd::walks = 0;
+
+TEST(EntitySystem, EntityBucketMoves)
+{
+  esys::EntityBuckets buckets;
+  uint32_t near = buckets.addBucket(1, 0);
+  uint32_t far = buckets.addBucket(10, 0);
+
+  for (uint64_t id = 0; id < 5; ++id)
+    buckets.assign(id, far);
+  buckets.assign(1, near);
+  buckets.assign(4, near);
+  EXPECT_TRUE(buckets.remove(0));
+  EXPECT_FALSE(buckets.remove(0));
+
+  EXPECT_EQ(-1, buckets.bucketOf(0));
+  EXPECT_EQ(static_cast<int64_t>(near), buckets.bucketOf(1));
+  EXPECT_EQ(static_cast<int64_t>(far), buckets.bucketOf(2));
+  EXPECT_EQ(2u, buckets.entities(near).size());
+  EXPECT_EQ(2u, buckets.entities(far).size());
+
+  EXPECT_THROW(buckets.assign(7, 5), std::runtime_error);
+}
+
+TEST(EntitySystem, EntityBucketMovesOncePerRun)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  esys::EntityBuckets buckets;
+  for (int b = 0; b < 3; ++b)
+    buckets.addBucket(1, 0);
+  for (uint64_t id = 0; id < 4; ++id)
+    buckets.assign(id, 0);
+
+  // Every entity steps one bucket further each run. Buckets 1 and 2 run in
+  // the same frame, which must not carry an entity on to bucket 2.
+  std::map<uint64_t, int> classified;
+  buckets.setClassifier(
+      [&classified](es::ESCoreBase&, uint64_t id, uint32_t bucket) -> uint32_t
+      {
+        ++classified[id];
+        return bucket + 1;
+      });
+
+  Crowd crowd;
+  Crowd::updates.clear();
+  buckets.run(*core, crowd, 0);
+  for (uint64_t id = 0; id < 4; ++id)
+  {
+    EXPECT_EQ(1, classified[id]);
+    EXPECT_EQ(1, Crowd::updates[id]);
+    EXPECT_EQ(1, buckets.bucketOf(id));
+  }
+
+  buckets.run(*core, crowd, 1);
+  for (uint64_t id = 0; id < 4; ++id)
+  {
+    EXPECT_EQ(2, classified[id]);
+    EXPECT_EQ(2, Crowd::updates[id]);
+    EXPECT_EQ(2, buckets.bucketOf(id));
+  }
+  EXPECT_EQ(4u, buckets.entities(2).size());
+  Crowd::updates.clear();
+}
+
+TEST(EntitySystem, EntityBucketScheduling)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  systems->registerSystem<Crowd>();
+  systems->addActiveSystemViaType<Crowd>(1);
+  systems->renormalize();
+
+  uint32_t near = systems->addEntityBucket("Crowd", 1);
+  uint32_t far = systems->addEntityBucket("Crowd", 10, 3);
+  for (uint64_t id = 0; id < 100; ++id)
+    systems->setEntityBucket("Crowd", id, id < 10 ? near : far);
+
+  // Work follows the effective rate: 10 entities every tick and 90 every
+  // tenth tick.
+  for (uint64_t t = 0; t < 100; ++t)
+    systems->runSystems(*core, t);
+  EXPECT_EQ(0, Crowd::walks);
+  EXPECT_EQ(100, Crowd::updates[0]);
+  EXPECT_EQ(10, Crowd::updates[50]);
+  int total = 0;
+  for (const auto& u : Crowd::updates)
+    total += u.second;
+  EXPECT_EQ(10 * 100 + 90 * 10, total);
+
+  // An entity that comes close is moved the next time its bucket runs.
+  systems->setBucketClassifier("Crowd",
+      [](es::ESCoreBase&, uint64_t id, uint32_t bucket) -> uint32_t
+      {
+        return id == 50 ? 0 : bucket;
+      });
+  Crowd::updates.clear();
+  for (uint64_t t = 100; t < 120; ++t)
+    systems->runSystems(*core, t);
+  EXPECT_EQ(0, systems->getEntityBuckets("Crowd")->bucketOf(50));
+  EXPECT_GT(Crowd::updates[50], 2);
+
+  systems->removeBucketedEntity("Crowd", 0);
+  Crowd::updates.clear();
+  systems->runSystems(*core, 120);
+  EXPECT_EQ(0u, Crowd::updates.count(0));
+
+  // Without buckets the system walks its components again.
+  systems->clearEntityBuckets("Crowd");
+  EXPECT_EQ(nullptr, systems->getEntityBuckets("Crowd"));
+  systems->runSystems(*core, 121);
+  EXPECT_EQ(1, Crowd::walks);
+  EXPECT_THROW(systems->setEntityBucket("Crowd", 1, 0), std::runtime_error);
+}
+
+}
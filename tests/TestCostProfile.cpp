@@ -0,0 +1,171 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <glm/glm.hpp>
+
+#include <unistd.h>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+// Takes at least a millisecond per execution.
+class Slow : public es::BaseSystem
+{
+public:
+  void walkComponents(es::ESCoreBase&) override
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  static const char* getName() {return "Slow";}
+};
+
+class Idle : public es::BaseSystem
+{
+public:
+  void walkComponents(es::ESCoreBase&) override {}
+};
+
+std::string profilePath(const char* name)
+{
+  return "/tmp/cpm-es-systems-" + std::string(name) + "-" + std::to_string(getpid());
+}
+
+TEST(EntitySystem, CostTracking)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+  systems->registerSystem<Slow>();
+  systems->addActiveSystemViaType<Slow>(1);
+  systems->renormalize();
+
+  std::chrono::nanoseconds cost;
+  systems->runSystems(*core, 0);
+  EXPECT_FALSE(systems->getSystemCost("Slow", cost));
+  EXPECT_THROW(systems->setCostTracking(true, 0.0), std::runtime_error);
+
+  systems->setCostTracking(true);
+  for (uint64_t t = 1; t < 6; ++t)
+    systems->runSystems(*core, t);
+  ASSERT_TRUE(systems->getSystemCost("Slow", cost));
+  EXPECT_GE(cost, std::chrono::milliseconds(1));
+
+  // The estimate travels with the active systems.
+  Tny* doc = systems->serializeActiveSystems();
+  std::shared_ptr<esys::SystemCore> restored(new esys::SystemCore);
+  restored->registerSystem<Slow>();
+  restored->deserializeActiveSystems(doc->root, 0);
+  restored->renormalize();
+  Tny_free(doc);
+
+  std::chrono::nanoseconds restoredCost;
+  ASSERT_TRUE(restored->getSystemCost("Slow", restoredCost));
+  EXPECT_EQ(cost, restoredCost);
+
+  // And through the record stream.
+  std::vector<uint8_t> stream;
+  {
+    esys::SystemRecordWriter writer(stream);
+    systems->writeActiveSystems(writer);
+  }
+  esys::SystemRecordReader reader(stream.data(), stream.size());
+  std::shared_ptr<esys::SystemCore> loaded(new esys::SystemCore);
+  loaded->registerSystem<Slow>();
+  loaded->loadActiveSystems(reader, 0, 16);
+  loaded->renormalize();
+  ASSERT_TRUE(loaded->getSystemCost("Slow", restoredCost));
+  EXPECT_EQ(cost, restoredCost);
+}
+
+TEST(EntitySystem, CostProfileFile)
+{
+  std::string path = profilePath("costs");
+  {
+    std::ofstream out(path.c_str());
+    out << "Alpha 100000\nBeta 10000\nDelta 10000\nGamma 10000\nRetired system 5\n";
+  }
+
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+  systems->registerSystemAs<Idle>("Alpha");
+  systems->registerSystemAs<Idle>("Beta");
+  systems->addActiveSystem("Alpha", 1);
+  systems->renormalize();
+  systems->loadCostProfile(path);
+
+  // Seeds active systems and systems added later.
+  std::chrono::nanoseconds cost;
+  ASSERT_TRUE(systems->getSystemCost("Alpha", cost));
+  EXPECT_EQ(100000, cost.count());
+  systems->addActiveSystem("Beta", 1);
+  systems->renormalize();
+  ASSERT_TRUE(systems->getSystemCost("Beta", cost));
+  EXPECT_EQ(10000, cost.count());
+
+  std::string copy = profilePath("copy");
+  systems->saveCostProfile(copy);
+  esys::CostProfile profile;
+  profile.load(copy);
+  EXPECT_EQ(5u, profile.costs.size());
+  EXPECT_EQ(5u, profile.costs["Retired system"]);
+  std::remove(copy.c_str());
+
+  EXPECT_THROW(systems->loadCostProfile(profilePath("missing")), std::runtime_error);
+  {
+    std::ofstream out(path.c_str());
+    out << "Alpha lots\n";
+  }
+  EXPECT_THROW(systems->loadCostProfile(path), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST(EntitySystem, CostBalancedShards)
+{
+  std::string path = profilePath("shards");
+  {
+    std::ofstream out(path.c_str());
+    out << "Alpha 100000\nBeta 10000\nDelta 10000\nGamma 10000\n";
+  }
+
+  esys::ShardLayout layout;
+  layout.numShards = 2;
+  layout.maxSystems = 16;
+  esys::ShardCoordinator leader("/cpm-es-systems-cost-" + std::to_string(getpid()), layout);
+
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+  const char* names[] = {"Alpha", "Beta", "Delta", "Gamma"};
+  for (const char* name : names)
+  {
+    systems->registerSystemAs<Idle>(name);
+    systems->addActiveSystem(name, 1);
+  }
+  systems->loadCostProfile(path);
+  systems->setShardCoordinator(&leader);
+  systems->renormalize();
+  std::remove(path.c_str());
+
+  // Round robin would pair Alpha with Delta. By cost, Alpha alone
+  // outweighs the other three.
+  EXPECT_TRUE(systems->isSystemLocal("Alpha"));
+  EXPECT_FALSE(systems->isSystemLocal("Beta"));
+  EXPECT_FALSE(systems->isSystemLocal("Delta"));
+  EXPECT_FALSE(systems->isSystemLocal("Gamma"));
+  leader.stop();
+}
+
+}
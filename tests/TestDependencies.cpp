@@ -0,0 +1,122 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <gtest/gtest.h>
+#include <memory>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+// Produces output only while 'produce' is set.
+class Emitter : public es::GenericSystem<false, CompPosition>,
+                public esys::OutputReportingSystem
+{
+public:
+  static bool produce;
+
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  bool producedOutput() const override {return produce;}
+  static const char* getName() {return "Emitter";}
+};
+bool Emitter::produce = true;
+
+class Listener : public es::GenericSystem<false, CompPosition>
+{
+public:
+  static int32_t numExecutions;
+
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {++numExecutions;}
+  static const char* getName() {return "Listener";}
+};
+int32_t Listener::numExecutions = 0;
+
+class Relay : public es::GenericSystem<false, CompPosition>
+{
+public:
+  static int32_t numExecutions;
+
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {++numExecutions;}
+  static const char* getName() {return "Relay";}
+};
+int32_t Relay::numExecutions = 0;
+
+TEST(EntitySystem, OutputDrivenExecution)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  systems->registerSystem<Emitter>();
+  systems->registerSystem<Listener>();
+  systems->registerSystem<Relay>();
+
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->renormalize(true);
+
+  // Emitter every other tick, Listener every tick, Relay after Listener.
+  systems->addActiveSystemViaType<Emitter>(2);
+  systems->addActiveSystemViaType<Listener>(1);
+  systems->addActiveSystemViaType<Relay>(1);
+  systems->addSystemDependencyViaType<Emitter, Listener>();
+  systems->addSystemDependency("Listener", "Relay");
+  systems->renormalize();
+
+  EXPECT_TRUE(systems->isSystemGated("Listener"));
+  EXPECT_TRUE(systems->isSystemGated("Relay"));
+  EXPECT_FALSE(systems->isSystemGated("Emitter"));
+
+  // Without output driven execution the graph has no effect.
+  for (uint64_t t = 0; t < 4; ++t)
+    systems->runSystems(*core, t);
+  EXPECT_EQ(4, Listener::numExecutions);
+
+  // Listener only follows Emitter's executions. Relay runs in the frame
+  // after Listener, since it runs first.
+  systems->setOutputDrivenExecution(true);
+  Listener::numExecutions = 0;
+  Relay::numExecutions = 0;
+  for (uint64_t t = 4; t < 12; ++t)
+    systems->runSystems(*core, t);
+  EXPECT_EQ(4, Listener::numExecutions);
+  EXPECT_EQ(4, Relay::numExecutions);
+
+  // Nothing produced, nothing downstream runs.
+  Emitter::produce = false;
+  Listener::numExecutions = 0;
+  Relay::numExecutions = 0;
+  for (uint64_t t = 12; t < 20; ++t)
+    systems->runSystems(*core, t);
+  EXPECT_EQ(0, Listener::numExecutions);
+  EXPECT_LE(Relay::numExecutions, 1);
+  Emitter::produce = true;
+
+  // A cycle would starve both systems, so they run ungated.
+  systems->addSystemDependency("Relay", "Listener");
+  systems->renormalize();
+  EXPECT_FALSE(systems->isSystemGated("Listener"));
+  EXPECT_FALSE(systems->isSystemGated("Relay"));
+
+  systems->removeSystemDependency("Relay", "Listener");
+  systems->renormalize();
+  EXPECT_TRUE(systems->isSystemGated("Listener"));
+
+  // A consumer whose producer is not active runs on schedule.
+  systems->removeActiveSystem("Emitter");
+  systems->renormalize();
+  EXPECT_FALSE(systems->isSystemGated("Listener"));
+
+  EXPECT_THROW(systems->addSystemDependency("Missing", "Listener"), std::runtime_error);
+}
+
+}
@@ -0,0 +1,152 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+// Burns time every frame while busy is set.
+class Load : public es::GenericSystem<false, CompPosition>
+{
+public:
+  static bool busy;
+
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override
+  {
+    if (!busy)
+      return;
+    std::chrono::steady_clock::time_point end =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(4);
+    while (std::chrono::steady_clock::now() < end) {}
+  }
+  static const char* getName() {return "Load";}
+};
+bool Load::busy = false;
+
+// Non-critical system that records when it runs.
+class Ambient : public es::GenericSystem<false, CompPosition>
+{
+public:
+  static std::vector<uint64_t> times;
+  static uint64_t now;
+
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override
+  {
+    times.push_back(now);
+  }
+  static const char* getName() {return "Ambient";}
+};
+std::vector<uint64_t> Ambient::times;
+uint64_t Ambient::now = 0;
+
+uint64_t effectiveMS(const esys::SystemCore& systems, const char* name)
+{
+  std::chrono::nanoseconds interval(0);
+  EXPECT_TRUE(systems.getEffectiveInterval(name, interval));
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(interval).count());
+}
+
+TEST(EntitySystem, OverloadAdaptation)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  systems->registerSystem<Load>();
+  systems->registerSystem<Ambient>();
+
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->renormalize(true);
+
+  systems->addActiveSystemViaType<Load>(0);
+  systems->addActiveSystemViaType<Ambient>(4, 0, 1);
+  systems->setSystemElasticity(Ambient::getName(), 4, 16);
+  systems->setLoadTarget(std::chrono::milliseconds(2), 0.25, 2);
+  systems->renormalize();
+  EXPECT_EQ(4u, effectiveMS(*systems, Ambient::getName()));
+
+  uint64_t t = 0;
+  auto runFrames = [&](int count)
+  {
+    for (int i = 0; i < count; ++i, ++t)
+    {
+      Ambient::now = t;
+      systems->runSystems(*core, t);
+    }
+  };
+
+  // Two overloaded frames per step, so four take Ambient to its bound and
+  // further overload changes nothing.
+  Load::busy = true;
+  runFrames(8);
+  EXPECT_EQ(16u, effectiveMS(*systems, Ambient::getName()));
+  EXPECT_EQ(2, systems->getLoadLevel());
+
+  // The stagger phase survives the stretch.
+  Ambient::times.clear();
+  runFrames(32);
+  ASSERT_EQ(2u, Ambient::times.size());
+  for (uint64_t when : Ambient::times)
+    EXPECT_EQ(0u, (when + 1) % 16);
+
+  // The effective interval is part of the snapshot.
+  Tny* doc = systems->serializeActiveSystems();
+  Tny* record = Tny_get(doc->root, Ambient::getName())->value.tny;
+  EXPECT_EQ(4u, Tny_get(record, "interval")->value.num);
+  EXPECT_EQ(16u, Tny_get(record, "effectiveInterval")->value.num);
+
+  std::shared_ptr<esys::SystemCore> restored(new esys::SystemCore);
+  restored->registerSystem<Load>();
+  restored->registerSystem<Ambient>();
+  restored->deserializeActiveSystems(doc->root, t);
+  restored->renormalize();
+  Tny_free(doc);
+  EXPECT_EQ(16u, effectiveMS(*restored, Ambient::getName()));
+
+  // Record streams carry it too.
+  std::vector<uint8_t> stream;
+  {
+    esys::SystemRecordWriter writer(stream);
+    restored->writeActiveSystems(writer);
+  }
+  esys::SystemRecordReader reader(stream.data(), stream.size());
+  std::shared_ptr<esys::SystemCore> loaded(new esys::SystemCore);
+  loaded->registerSystem<Load>();
+  loaded->registerSystem<Ambient>();
+  loaded->loadActiveSystems(reader, t);
+  EXPECT_EQ(16u, effectiveMS(*loaded, Ambient::getName()));
+
+  // Light load shrinks the interval back, one step per two frames.
+  Load::busy = false;
+  runFrames(2);
+  EXPECT_EQ(8u, effectiveMS(*systems, Ambient::getName()));
+  runFrames(6);
+  EXPECT_EQ(4u, effectiveMS(*systems, Ambient::getName()));
+  EXPECT_EQ(0, systems->getLoadLevel());
+
+  // Fixed systems are untouched, and disabling restores the request.
+  Load::busy = true;
+  runFrames(2);
+  EXPECT_EQ(8u, effectiveMS(*systems, Ambient::getName()));
+  EXPECT_EQ(0u, effectiveMS(*systems, Load::getName()));
+  systems->setLoadTarget(std::chrono::microseconds(0));
+  EXPECT_EQ(4u, effectiveMS(*systems, Ambient::getName()));
+  Load::busy = false;
+}
+
+}
+
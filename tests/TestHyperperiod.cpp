@@ -0,0 +1,133 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <gtest/gtest.h>
+#include <memory>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+// Execution trace: (reference time, system name) for every system executed.
+static uint64_t currentTime = 0;
+static std::vector<std::pair<uint64_t, std::string>> trace;
+
+template <typename T>
+class TraceSystem : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override
+  {
+    trace.push_back(std::make_pair(currentTime, std::string(T::getName())));
+  }
+};
+
+class A : public TraceSystem<A> { public: static const char* getName() {return "A";} };
+class B : public TraceSystem<B> { public: static const char* getName() {return "B";} };
+class C : public TraceSystem<C> { public: static const char* getName() {return "C";} };
+class D : public TraceSystem<D> { public: static const char* getName() {return "D";} };
+
+// Maximum lateness of A, B and D, filled in by runTrace.
+static std::vector<uint64_t> lateness;
+
+std::vector<std::pair<uint64_t, std::string>> runTrace(bool precompiled, uint64_t maxHyperperiod,
+                                                       uint64_t step = 1)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  systems->registerSystem<A>();
+  systems->registerSystem<B>();
+  systems->registerSystem<C>();
+  systems->registerSystem<D>();
+  systems->setPrecompiledSchedule(precompiled, maxHyperperiod);
+  systems->setTimingStatistics(true);
+
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->renormalize(true);
+
+  systems->addActiveSystemViaType<A>(4, 0, 1);
+  systems->addActiveSystemViaType<B>(6, 0, 5);
+  systems->addActiveSystemViaType<C>(0);
+  systems->renormalize();
+
+  trace.clear();
+  bool addedD = false;
+  for (currentTime = 0; currentTime < 40; currentTime += step)
+  {
+    systems->runSystems(*core, currentTime);
+
+    // Repeat a tick, skip a few ticks, and add a system part way through.
+    if (currentTime == 10)
+      systems->runSystems(*core, currentTime);
+    if (currentTime == 20)
+      currentTime += 7;
+    if (currentTime >= 30 && !addedD)
+    {
+      addedD = true;
+      systems->addActiveSystemViaType<D>(9, 0, 2);
+      systems->renormalize();
+    }
+  }
+
+  EXPECT_EQ(precompiled && maxHyperperiod >= 36, systems->isUsingPrecompiledSchedule());
+
+  lateness.clear();
+  for (const char* name : {"A", "B", "D"})
+  {
+    esys::SystemTimingStats stats;
+    EXPECT_TRUE(systems->getTimingStatistics(name, stats));
+    lateness.push_back(stats.maxLateness);
+  }
+  return trace;
+}
+
+TEST(EntitySystem, HyperperiodMatchesDynamic)
+{
+  std::vector<std::pair<uint64_t, std::string>> dynamicTrace = runTrace(false, 0);
+  std::vector<std::pair<uint64_t, std::string>> tableTrace = runTrace(true, 1000);
+
+  ASSERT_EQ(dynamicTrace.size(), tableTrace.size());
+  for (size_t i = 0; i < dynamicTrace.size(); ++i)
+  {
+    EXPECT_EQ(dynamicTrace[i], tableTrace[i]);
+  }
+}
+
+TEST(EntitySystem, HyperperiodFallback)
+{
+  // LCM of 4, 6 and 9 is 36, so this falls back to the dynamic scheduler.
+  std::vector<std::pair<uint64_t, std::string>> dynamicTrace = runTrace(false, 0);
+  std::vector<std::pair<uint64_t, std::string>> fallbackTrace = runTrace(true, 20);
+
+  EXPECT_EQ(dynamicTrace, fallbackTrace);
+}
+
+TEST(EntitySystem, HyperperiodMultiTickSteps)
+{
+  // Frames that advance several ticks are still served from the table, and
+  // run and report lateness as the dynamic scheduler does.
+  for (uint64_t step : {2, 3, 5})
+  {
+    std::vector<std::pair<uint64_t, std::string>> dynamicTrace = runTrace(false, 0, step);
+    std::vector<uint64_t> dynamicLateness = lateness;
+    std::vector<std::pair<uint64_t, std::string>> tableTrace = runTrace(true, 1000, step);
+
+    EXPECT_EQ(dynamicTrace, tableTrace) << step;
+    EXPECT_EQ(dynamicLateness, lateness) << step;
+    EXPECT_GT(lateness[0], 0u) << step;
+  }
+}
+
+}
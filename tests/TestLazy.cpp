@@ -0,0 +1,124 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+// Stands in for a system with an expensive constructor.
+class Heavy : public es::GenericSystem<false, CompPosition>
+{
+public:
+  static std::atomic<int> constructed;
+  static std::thread::id constructedOn;
+
+  Heavy()
+  {
+    constructedOn = std::this_thread::get_id();
+    ++constructed;
+  }
+
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  static const char* getName() {return "Heavy";}
+};
+std::atomic<int> Heavy::constructed(0);
+std::thread::id Heavy::constructedOn;
+
+std::string heavyName(int i)
+{
+  return "Heavy" + std::to_string(i);
+}
+
+TEST(EntitySystem, LazyInstantiation)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->renormalize(true);
+
+  std::shared_ptr<esys::SystemCore> saved(new esys::SystemCore);
+  for (int i = 0; i < 100; ++i)
+  {
+    saved->registerSystemAs<Heavy>(heavyName(i));
+    saved->addActiveSystem(heavyName(i), 100, 0, i);
+  }
+  saved->renormalize();
+  Tny* doc = saved->serializeActiveSystems();
+  saved.reset();
+  Heavy::constructed = 0;
+
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+  for (int i = 0; i < 100; ++i)
+    systems->registerSystemAs<Heavy>(heavyName(i));
+  systems->setLazyInstantiation(true);
+  systems->deserializeActiveSystems(doc->root, 0);
+  systems->renormalize();
+  Tny_free(doc);
+
+  EXPECT_EQ(0, Heavy::constructed.load());
+  EXPECT_TRUE(systems->isSystemActive("Heavy0"));
+  EXPECT_FALSE(systems->isSystemInstantiated("Heavy0"));
+
+  // Heavy0 is due at 0, Heavy99 at 1 and so on.
+  for (uint64_t t = 0; t < 5; ++t)
+    systems->runSystems(*core, t);
+
+  EXPECT_EQ(5, Heavy::constructed.load());
+  EXPECT_TRUE(systems->isSystemInstantiated("Heavy0"));
+  EXPECT_TRUE(systems->isSystemInstantiated("Heavy96"));
+  EXPECT_FALSE(systems->isSystemInstantiated("Heavy95"));
+
+  // Unknown systems are still refused when added.
+  EXPECT_THROW(systems->addActiveSystem("Missing", 100), std::runtime_error);
+}
+
+TEST(EntitySystem, LazyPrewarm)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->renormalize(true);
+
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+  systems->registerSystem<Heavy>();
+  systems->setLazyInstantiation(true, std::chrono::milliseconds(10));
+  Heavy::constructed = 0;
+
+  // Due at 50.
+  systems->addActiveSystem("Heavy", 100, 0, 50);
+  systems->renormalize();
+
+  for (uint64_t t = 0; t < 40; ++t)
+    systems->runSystems(*core, t);
+  EXPECT_EQ(0, Heavy::constructed.load());
+
+  systems->runSystems(*core, 40);
+  for (int i = 0; i < 1000 && Heavy::constructed.load() == 0; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_EQ(1, Heavy::constructed.load());
+  EXPECT_NE(std::this_thread::get_id(), Heavy::constructedOn);
+  EXPECT_FALSE(systems->isSystemInstantiated("Heavy"));
+
+  for (uint64_t t = 41; t <= 50; ++t)
+    systems->runSystems(*core, t);
+  EXPECT_TRUE(systems->isSystemInstantiated("Heavy"));
+  EXPECT_EQ(1, Heavy::constructed.load());
+}
+
+}
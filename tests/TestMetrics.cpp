@@ -0,0 +1,176 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <es-systems/MetricsExporter.hpp>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <glm/glm.hpp>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+class Movement : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  static const char* getName() {return "Movement";}
+};
+
+class Render : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  static const char* getName() {return "Render";}
+};
+
+bool contains(const std::string& text, const std::string& line)
+{
+  return text.find(line + "\n") != std::string::npos;
+}
+
+// Sends \p request, if any, to the socket at \p path and returns the reply.
+std::string query(const std::string& path, const char* request)
+{
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+  EXPECT_EQ(0, connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+
+  if (request != nullptr)
+  {
+    EXPECT_EQ(static_cast<ssize_t>(std::strlen(request)), write(fd, request, std::strlen(request)));
+  }
+
+  std::string reply;
+  char buffer[4096];
+  ssize_t bytes;
+  while ((bytes = read(fd, buffer, sizeof(buffer))) > 0)
+    reply.append(buffer, static_cast<size_t>(bytes));
+  close(fd);
+  return reply;
+}
+
+TEST(EntitySystem, SchedulerMetrics)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+  esys::SchedulerMetrics metrics;
+
+  systems->registerSystem<Movement>();
+  systems->registerSystem<Render>();
+  systems->setMetrics(&metrics);
+
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->renormalize(true);
+
+  systems->addActiveSystemViaType<Movement>(10);
+  systems->addActiveSystemViaType<Render>(0);
+  std::string text = metrics.format();
+  EXPECT_TRUE(contains(text, "es_systems_active 0"));
+  EXPECT_TRUE(contains(text, "es_systems_pending_additions 2"));
+
+  systems->renormalize();
+  systems->runSystems(*core, 0);
+  systems->runSystems(*core, 10);
+  // Movement was due at 20 and 30, it runs once 15 ticks late.
+  systems->runSystems(*core, 35);
+
+  text = metrics.format();
+  EXPECT_TRUE(contains(text, "es_systems_active 2"));
+  EXPECT_TRUE(contains(text, "es_systems_pending_additions 0"));
+  EXPECT_TRUE(contains(text, "es_systems_renormalize_total 1"));
+  EXPECT_TRUE(contains(text, "es_systems_executions_total{system=\"Movement\"} 3"));
+  EXPECT_TRUE(contains(text, "es_systems_executions_total{system=\"Render\"} 3"));
+  EXPECT_TRUE(contains(text, "es_systems_lateness_ticks_total{system=\"Movement\"} 15"));
+  EXPECT_TRUE(contains(text, "es_systems_skipped_total{system=\"Movement\"} 1"));
+  EXPECT_TRUE(contains(text, "# TYPE es_systems_executions_total counter"));
+
+  // Removed systems drop out of the export.
+  systems->removeActiveSystemViaType<Render>();
+  EXPECT_TRUE(contains(metrics.format(), "es_systems_pending_removals 1"));
+  systems->renormalize();
+  text = metrics.format();
+  EXPECT_TRUE(contains(text, "es_systems_active 1"));
+  EXPECT_EQ(std::string::npos, text.find("system=\"Render\""));
+
+  systems->setMetrics(nullptr);
+}
+
+TEST(EntitySystem, MetricsExport)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+  esys::SchedulerMetrics metrics;
+
+  systems->registerSystem<Movement>();
+  systems->setMetrics(&metrics);
+
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->renormalize(true);
+
+  systems->addActiveSystemViaType<Movement>(0);
+  systems->renormalize();
+
+  std::ostringstream base;
+  base << "/tmp/es-systems-metrics-" << getpid();
+  std::string socketPath = base.str() + ".sock";
+  std::string filePath = base.str() + ".prom";
+
+  {
+    esys::MetricsExporter server(metrics, socketPath, esys::MetricsExporter::SERVE_SOCKET);
+
+    // The simulation keeps running while the exporter reads.
+    std::thread simulation([&systems, &core]()
+    {
+      for (uint64_t t = 0; t < 1000; ++t)
+        systems->runSystems(*core, t);
+    });
+
+    std::string reply = query(socketPath, "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    EXPECT_EQ(0u, reply.find("HTTP/1.0 200 OK\r\n"));
+    EXPECT_NE(std::string::npos, reply.find("es_systems_active 1\n"));
+
+    reply = query(socketPath, nullptr);
+    EXPECT_EQ(0u, reply.find("# HELP"));
+
+    simulation.join();
+    EXPECT_TRUE(contains(query(socketPath, nullptr),
+                         "es_systems_executions_total{system=\"Movement\"} 1000"));
+  }
+  EXPECT_NE(0, access(socketPath.c_str(), F_OK));
+
+  {
+    esys::MetricsExporter writer(metrics, filePath, esys::MetricsExporter::WRITE_FILE,
+                                 std::chrono::milliseconds(10));
+  }
+  std::ifstream file(filePath);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  EXPECT_TRUE(contains(contents.str(), "es_systems_executions_total{system=\"Movement\"} 1000"));
+  std::remove(filePath.c_str());
+}
+
+}
+
@@ -0,0 +1,104 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <es-systems/BatchedSystem.hpp>
+#include <gtest/gtest.h>
+#include <memory>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+// Sums positions a batch at a time.
+class Integrate : public esys::BatchedSystem<CompPosition>
+{
+public:
+  static float sum;
+
+  void executeBatch(es::ESCoreBase&, size_t count, esys::BatchColumn<uint64_t>,
+                    esys::BatchColumn<CompPosition> pos) override
+  {
+    for (size_t i = 0; i < count; ++i)
+      sum += pos[i].position.x;
+  }
+  static const char* getName() {return "Integrate";}
+};
+float Integrate::sum = 0.0f;
+
+TEST(EntitySystem, CounterStatistics)
+{
+  esys::SystemCounterStats stats;
+  EXPECT_EQ(0.0, stats.ipc());
+  EXPECT_EQ(0.0, stats.cacheMissesPerEntity());
+
+  esys::PerfCounterValues delta;
+  delta.cycles = 1000;
+  delta.instructions = 2500;
+  delta.cacheMisses = 30;
+  delta.branchMisses = 10;
+  stats.record(delta, 10);
+  stats.record(delta, 10);
+
+  EXPECT_EQ(2u, stats.executions);
+  EXPECT_EQ(20u, stats.entities);
+  EXPECT_DOUBLE_EQ(2.5, stats.ipc());
+  EXPECT_DOUBLE_EQ(3.0, stats.cacheMissesPerEntity());
+  EXPECT_DOUBLE_EQ(1.0, stats.branchMissesPerEntity());
+}
+
+TEST(EntitySystem, HardwareCounters)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  systems->registerSystem<Integrate>();
+
+  for (int i = 0; i < 100; ++i)
+  {
+    uint64_t id = core->getNewEntityID();
+    core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  }
+  core->renormalize(true);
+
+  systems->addActiveSystemViaType<Integrate>(0);
+  systems->renormalize();
+
+  // Containers and virtual machines often have no counters. The core must
+  // keep running either way.
+  bool available = systems->setHardwareCounters(true);
+  for (uint64_t t = 0; t < 4; ++t)
+    systems->runSystems(*core, t);
+  EXPECT_FLOAT_EQ(400.0f, Integrate::sum);
+
+  esys::SystemCounterStats stats;
+  ASSERT_TRUE(systems->getHardwareCounters(Integrate::getName(), stats));
+  if (available)
+  {
+    EXPECT_EQ(4u, stats.executions);
+    EXPECT_EQ(400u, stats.entities);
+    EXPECT_GT(stats.totals.instructions, 0u);
+  }
+  else
+  {
+    EXPECT_EQ(0u, stats.executions);
+  }
+
+  EXPECT_FALSE(systems->setHardwareCounters(false));
+  systems->runSystems(*core, 4);
+  esys::SystemCounterStats after;
+  ASSERT_TRUE(systems->getHardwareCounters(Integrate::getName(), after));
+  EXPECT_EQ(stats.executions, after.executions);
+}
+
+}
+
@@ -0,0 +1,176 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+struct CompHealth
+{
+  CompHealth() : health(0) {}
+  CompHealth(int h) : health(h) {}
+
+  int health;
+};
+
+std::shared_ptr<esys::DoubleBufferedComponent<CompHealth>> gHealth;
+
+// Writes health into the double buffer, one more every frame.
+class Damage : public es::GenericSystem<false, CompPosition>,
+               public esys::WritesComponents<CompHealth>
+{
+public:
+  static int frame;
+  static std::thread::id thread;
+
+  void execute(es::ESCoreBase&, uint64_t entityID, const CompPosition*) override
+  {
+    thread = std::this_thread::get_id();
+    gHealth->write(entityID, CompHealth(frame));
+  }
+  static const char* getName() {return "Damage";}
+};
+int Damage::frame = 0;
+std::thread::id Damage::thread;
+
+// Reads the published health.
+class Display : public es::GenericSystem<false, CompPosition>
+{
+public:
+  static std::vector<int> seen;
+  static std::thread::id thread;
+
+  void execute(es::ESCoreBase&, uint64_t entityID, const CompPosition*) override
+  {
+    thread = std::this_thread::get_id();
+    const CompHealth* h = gHealth->read(entityID);
+    seen.push_back(h ? h->health : -1);
+  }
+  static const char* getName() {return "Display";}
+};
+std::vector<int> Display::seen;
+std::thread::id Display::thread;
+
+// Writes positions directly, without a buffer.
+class Mover : public es::GenericSystem<false, CompHealth>,
+              public esys::WritesComponents<CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompHealth*) override {}
+  static const char* getName() {return "Mover";}
+};
+
+// Slow reader that records whether it is inside its walk.
+class Survey : public es::GenericSystem<false, CompPosition>
+{
+public:
+  static std::atomic<bool> walking;
+  static std::atomic<int> visited;
+
+  void walkComponents(es::ESCoreBase& core) override
+  {
+    walking = true;
+    es::GenericSystem<false, CompPosition>::walkComponents(core);
+    walking = false;
+  }
+
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ++visited;
+  }
+  static const char* getName() {return "Survey";}
+};
+std::atomic<bool> Survey::walking(false);
+std::atomic<int> Survey::visited(0);
+
+TEST(EntitySystem, PipelinedDoubleBuffer)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+  gHealth.reset(new esys::DoubleBufferedComponent<CompHealth>());
+
+  systems->registerSystem<Damage>();
+  systems->registerSystem<Display>();
+  systems->registerSystem<Mover>();
+
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->renormalize(true);
+
+  systems->addDoubleBuffer(gHealth);
+  systems->setPipelinedExecution(true);
+  systems->addActiveSystemViaType<Damage>(0);
+  systems->addActiveSystemViaType<Display>(0);
+  systems->renormalize();
+
+  EXPECT_FALSE(systems->isSystemOverlapped(Damage::getName()));
+  EXPECT_TRUE(systems->isSystemOverlapped(Display::getName()));
+
+  for (int frame = 0; frame < 4; ++frame)
+  {
+    Damage::frame = frame;
+    systems->runSystems(*core, static_cast<uint64_t>(frame));
+    systems->renormalize();
+  }
+
+  // The reader sees the value written during the previous frame.
+  std::vector<int> expected = {-1, 0, 1, 2};
+  EXPECT_EQ(expected, Display::seen);
+  EXPECT_EQ(std::this_thread::get_id(), Damage::thread);
+  EXPECT_NE(std::this_thread::get_id(), Display::thread);
+
+  // Position is now written directly, so its readers must not overlap.
+  systems->addActiveSystemViaType<Mover>(0);
+  systems->renormalize();
+  EXPECT_FALSE(systems->isSystemOverlapped(Display::getName()));
+
+  systems->setPipelinedExecution(false);
+  EXPECT_FALSE(systems->isSystemOverlapped(Display::getName()));
+}
+
+TEST(EntitySystem, PipelinedCoreChangesBetweenFrames)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  systems->registerSystem<Survey>();
+  systems->setPipelinedExecution(true);
+  systems->addActiveSystemViaType<Survey>(0);
+  systems->renormalize();
+  ASSERT_TRUE(systems->isSystemOverlapped(Survey::getName()));
+
+  int entities = 0;
+  int expected = 0;
+  for (uint64_t frame = 0; frame < 5; ++frame)
+  {
+    systems->runSystems(*core, frame);
+    expected += entities;
+    EXPECT_FALSE(Survey::walking);
+    EXPECT_EQ(expected, Survey::visited);
+
+    // The core is changed right after runSystems, before renormalize.
+    for (int i = 0; i < 4; ++i, ++entities)
+      core->addComponent(core->getNewEntityID(), CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+    core->renormalize(true);
+    systems->renormalize();
+  }
+}
+
+}
@@ -0,0 +1,98 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCoreImpl.hpp>
+#include <gtest/gtest.h>
+#include <memory>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+class Fast : public es::GenericSystem<false, CompPosition>
+{
+public:
+  static int32_t numExecutions;
+
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {++numExecutions;}
+  static const char* getName() {return "Fast";}
+};
+int32_t Fast::numExecutions = 0;
+
+class Slow : public es::GenericSystem<false, CompPosition>
+{
+public:
+  static int32_t numExecutions;
+
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {++numExecutions;}
+  static const char* getName() {return "Slow";}
+};
+int32_t Slow::numExecutions = 0;
+
+// Microsecond ticks fixed at compile time, no diagnostics.
+typedef esys::BasicSystemCore<esys::ScheduleTable, esys::MicrosecondClock,
+                              esys::NullInstrumentation> LeanSystemCore;
+
+TEST(EntitySystem, PolicyBasedCore)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<LeanSystemCore> systems(new LeanSystemCore);
+
+  systems->registerSystem<Fast>();
+  systems->registerSystem<Slow>();
+  EXPECT_EQ(std::chrono::nanoseconds(1000), systems->getTickDuration());
+
+  // The clock is fixed, only its own resolution is accepted.
+  EXPECT_NO_THROW(systems->setTickResolution(LeanSystemCore::TICK_MICROSECONDS));
+  EXPECT_THROW(systems->setTickResolution(LeanSystemCore::TICK_MILLISECONDS),
+               std::runtime_error);
+
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->renormalize(true);
+
+  systems->addActiveSystemViaType<Fast>(std::chrono::microseconds(500));
+  systems->addActiveSystemViaType<Slow>(2);
+  systems->setTimingStatistics(true);
+  systems->setWatchdog(std::chrono::microseconds(1),
+                       [](const char*, std::chrono::microseconds) { FAIL(); });
+  systems->renormalize();
+
+  for (int64_t us = 0; us < 10000; us += 100)
+  {
+    systems->runSystems(*core, std::chrono::microseconds(us));
+  }
+
+  EXPECT_EQ(20, Fast::numExecutions);
+  EXPECT_EQ(5, Slow::numExecutions);
+
+  // Instrumentation is compiled out, nothing was recorded.
+  esys::SystemTimingStats stats;
+  ASSERT_TRUE(systems->getTimingStatistics(Fast::getName(), stats));
+  EXPECT_EQ(0u, stats.executions);
+
+  // Serialized data round trips into the default core.
+  Tny* doc = systems->serializeActiveSystems();
+  esys::SystemCore restored;
+  restored.registerSystem<Fast>();
+  restored.registerSystem<Slow>();
+  restored.setTickResolution(esys::SystemCore::TICK_MICROSECONDS);
+  restored.deserializeActiveSystems(doc->root, std::chrono::microseconds(10000));
+  restored.renormalize();
+  Tny_free(doc);
+
+  EXPECT_TRUE(restored.isSystemActive(Fast::getName()));
+  EXPECT_TRUE(restored.isSystemActive(Slow::getName()));
+}
+
+}
+
@@ -0,0 +1,111 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+static std::vector<std::string> events;
+static std::atomic<int> helperPrefetches(0);
+static std::thread::id simulationThread;
+
+template <typename T>
+class PrefetchSystem : public es::GenericSystem<false, CompPosition>,
+                       public esys::PrefetchableSystem
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override
+  {
+    if (events.empty() || events.back() != std::string("run:") + T::getName())
+      events.push_back(std::string("run:") + T::getName());
+  }
+
+  void prefetchComponents(es::ESCoreBase&) override
+  {
+    if (std::this_thread::get_id() == simulationThread)
+      events.push_back(std::string("prefetch:") + T::getName());
+    else
+      ++helperPrefetches;
+  }
+};
+
+class A : public PrefetchSystem<A> { public: static const char* getName() {return "A";} };
+class B : public PrefetchSystem<B> { public: static const char* getName() {return "B";} };
+class C : public PrefetchSystem<C> { public: static const char* getName() {return "C";} };
+
+TEST(EntitySystem, PrefetchNextSystem)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+  simulationThread = std::this_thread::get_id();
+
+  systems->registerSystem<A>();
+  systems->registerSystem<B>();
+  systems->registerSystem<C>();
+
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->renormalize(true);
+
+  systems->addActiveSystemViaType<A>();
+  systems->addActiveSystemViaType<B>(2);
+  systems->addActiveSystemViaType<C>();
+  systems->renormalize();
+
+  // Prefetching is off by default.
+  events.clear();
+  systems->runSystems(*core, 0);
+  std::vector<std::string> expected = {"run:A", "run:B", "run:C"};
+  EXPECT_EQ(expected, events);
+
+  // Each hook is called right before the system ahead of it runs. B is not
+  // due on tick 1, so C is prefetched while A runs.
+  systems->setPrefetchMode(esys::SystemCore::PREFETCH_INLINE);
+  events.clear();
+  systems->runSystems(*core, 1);
+  expected = {"prefetch:C", "run:A", "run:C"};
+  EXPECT_EQ(expected, events);
+
+  events.clear();
+  systems->runSystems(*core, 2);
+  expected = {"prefetch:B", "run:A", "prefetch:C", "run:B", "run:C"};
+  EXPECT_EQ(expected, events);
+
+  // Hooks move off the simulation thread.
+  systems->setPrefetchMode(esys::SystemCore::PREFETCH_HELPER_THREAD);
+  events.clear();
+  for (uint64_t t = 3; t < 100 && helperPrefetches == 0; ++t)
+  {
+    systems->runSystems(*core, t);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_GT(helperPrefetches, 0);
+  for (const std::string& e : events)
+  {
+    EXPECT_EQ(0u, e.find("run:"));
+  }
+
+  // Removing a system must not race with the helper thread.
+  systems->removeActiveSystemViaType<C>();
+  systems->renormalize();
+  systems->setPrefetchMode(esys::SystemCore::PREFETCH_NONE);
+}
+
+}
+
@@ -0,0 +1,92 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <es-systems/ScheduleReplayer.hpp>
+#include <gtest/gtest.h>
+#include <memory>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+class Physics : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  static const char* getName() {return "Physics";}
+};
+
+class AI : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  static const char* getName() {return "AI";}
+};
+
+class Audio : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  static const char* getName() {return "Audio";}
+};
+
+TEST(EntitySystem, RecordAndReplay)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->renormalize(true);
+
+  esys::ScheduleRecorder recorder;
+  esys::SystemCore systems;
+  systems.registerSystem<Physics>();
+  systems.registerSystem<AI>();
+  systems.registerSystem<Audio>();
+  systems.setRecorder(&recorder);
+
+  systems.addActiveSystemViaType<Physics>(0);
+  systems.addActiveSystemViaType<AI>(7, 0, 3);
+  systems.renormalize();
+
+  // Uneven frame times, with a system coming and going.
+  uint64_t frames = 0;
+  for (uint64_t t = 0; t < 200; t += 1 + (t % 5))
+  {
+    if (t == 50)
+      systems.addActiveSystemViaType<Audio>(11);
+    if (t == 120)
+      systems.removeActiveSystemViaType<AI>();
+    systems.runSystems(*core, t);
+    systems.renormalize();
+    ++frames;
+  }
+  systems.setRecorder(nullptr);
+
+  const std::vector<uint8_t>& data = recorder.getData();
+  esys::ScheduleReplayer replayer(data.data(), data.size());
+  esys::SystemCore fresh;
+  esys::ScheduleReplayer::Result result = replayer.replay(fresh, *core);
+
+  EXPECT_EQ(frames, result.frames);
+  EXPECT_LT(frames, result.recordedExecutions);
+  EXPECT_EQ(result.recordedExecutions, result.replayedExecutions);
+  EXPECT_EQ(0u, result.mismatchedFrames);
+  EXPECT_TRUE(fresh.isSystemActive(Audio::getName()));
+  EXPECT_FALSE(fresh.isSystemActive(AI::getName()));
+
+  // Recordings stay small: a few bytes per execution.
+  EXPECT_GT(4 * (result.recordedExecutions + result.frames), data.size());
+}
+
+}
+
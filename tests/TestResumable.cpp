@@ -0,0 +1,161 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+struct RebuildFrame
+{
+  RebuildFrame() : state(0), chunk(0) {}
+  ~RebuildFrame() {++destroyed;}
+
+  static int destroyed;
+
+  int state;
+  int chunk;
+};
+int RebuildFrame::destroyed = 0;
+
+// Rebuilds in three chunks, one per execution, then waits for a
+// background job before it finishes.
+class Rebuild : public es::BaseSystem,
+                public esys::BasicResumableSystem<RebuildFrame>
+{
+public:
+  static std::vector<int> steps;
+  static esys::CompletionEvent uploaded;
+
+  void walkComponents(es::ESCoreBase&) override {}
+
+  esys::ResumeWait resume(es::ESCoreBase&, RebuildFrame& frame) override
+  {
+    switch (frame.state)
+    {
+      case 0:
+        steps.push_back(frame.chunk);
+        if (++frame.chunk < 3)
+          return esys::ResumeWait::nextTick();
+        frame.state = 1;
+        return esys::ResumeWait::until(uploaded);
+
+      default:
+        steps.push_back(-1);
+        return esys::ResumeWait::done();
+    }
+  }
+
+  static const char* getName() {return "Rebuild";}
+};
+std::vector<int> Rebuild::steps;
+esys::CompletionEvent Rebuild::uploaded;
+
+struct DecompressFrame
+{
+  DecompressFrame() : block(0) {}
+
+  int block;
+};
+
+// Decompresses eight blocks, as many per execution as the budget allows.
+class Decompress : public es::BaseSystem,
+                   public esys::BasicResumableSystem<DecompressFrame>
+{
+public:
+  static int blocks;
+
+  void walkComponents(es::ESCoreBase&) override {}
+
+  esys::ResumeWait resume(es::ESCoreBase&, DecompressFrame& frame) override
+  {
+    ++blocks;
+    if (++frame.block == 8)
+      return esys::ResumeWait::done();
+    return esys::ResumeWait::budget(std::chrono::hours(1));
+  }
+
+  static const char* getName() {return "Decompress";}
+};
+int Decompress::blocks = 0;
+
+TEST(EntitySystem, ResumableSystems)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  systems->registerSystem<Rebuild>();
+  systems->registerSystem<Decompress>();
+  systems->addActiveSystemViaType<Rebuild>(1);
+  systems->addActiveSystemViaType<Decompress>(1);
+  systems->renormalize();
+
+  // One chunk per tick, then nothing until the event.
+  for (uint64_t t = 0; t < 6; ++t)
+    systems->runSystems(*core, t);
+  std::vector<int> expected = {0, 1, 2};
+  EXPECT_EQ(expected, Rebuild::steps);
+
+  // The budget lets every block of a frame run in one execution.
+  EXPECT_EQ(6 * 8, Decompress::blocks);
+
+  Rebuild::uploaded.signal();
+  systems->runSystems(*core, 6);
+  expected.push_back(-1);
+  EXPECT_EQ(expected, Rebuild::steps);
+  EXPECT_EQ(1, RebuildFrame::destroyed);
+
+  // The next execution starts over with a fresh frame.
+  systems->runSystems(*core, 7);
+  expected.push_back(0);
+  EXPECT_EQ(expected, Rebuild::steps);
+
+  // Removing the system destroys the frame in progress.
+  systems->removeActiveSystem("Rebuild");
+  systems->renormalize();
+  EXPECT_EQ(2, RebuildFrame::destroyed);
+
+  // Restarting frames does not allocate.
+  systems->setAllocationTracking(true);
+  systems->resetAllocationCounts();
+  for (uint64_t t = 8; t < 100; ++t)
+    systems->runSystems(*core, t);
+  uint64_t count = 1;
+  EXPECT_TRUE(systems->getAllocationCount("Decompress", count));
+  EXPECT_EQ(0u, count);
+}
+
+TEST(EntitySystem, FramePoolBlocks)
+{
+  esys::FramePool pool;
+  EXPECT_EQ(64u, esys::FramePool::blockSize(1));
+  EXPECT_EQ(128u, esys::FramePool::blockSize(65));
+
+  pool.reserve(100, 2);
+  EXPECT_EQ(2u, pool.capacity(128));
+  void* a = pool.allocate(100);
+  void* b = pool.allocate(128);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(2u, pool.capacity(100));
+
+  // Released blocks are reused before the pool grows.
+  pool.release(a, 100);
+  EXPECT_EQ(a, pool.allocate(120));
+  pool.allocate(100);
+  EXPECT_EQ(4u, pool.capacity(100));
+}
+
+}
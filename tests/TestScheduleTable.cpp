@@ -0,0 +1,98 @@
+#include <es-systems/ScheduleTable.hpp>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+extern uint64_t gRandomSeed;
+
+namespace {
+
+// Reference implementation of the per-item due check the schedule table
+// replaces.
+struct RefItem
+{
+  uint64_t interval;
+  uint64_t stagger;
+  uint64_t nextExecutionTime;
+
+  bool shouldExecute(uint64_t referenceTime)
+  {
+    if (nextExecutionTime <= referenceTime)
+    {
+      if (interval != 0 && referenceTime - nextExecutionTime >= interval)
+        nextExecutionTime = esys::ScheduleTable::calcNextExecutionTime(
+            referenceTime + 1, interval, stagger);
+      else
+        nextExecutionTime += interval;
+      return true;
+    }
+    return false;
+  }
+};
+
+void checkAgainstReference()
+{
+  std::mt19937_64 rng(gRandomSeed);
+
+  // Use a count that isn't a multiple of the word or vector width so the
+  // tail paths are exercised.
+  const size_t numItems = 1000 + 3;
+  std::vector<RefItem> ref;
+  esys::ScheduleTable table;
+  for (size_t i = 0; i < numItems; ++i)
+  {
+    RefItem item;
+    item.interval = rng() % 17;
+    item.stagger  = item.interval ? rng() % item.interval : 0;
+    item.nextExecutionTime = esys::ScheduleTable::calcNextExecutionTime(
+        rng() % 8, item.interval, item.stagger);
+    ref.push_back(item);
+    table.push_back(item.interval, item.stagger, item.nextExecutionTime);
+  }
+
+  std::vector<uint64_t> dueMask;
+  uint64_t referenceTime = 0;
+  for (int frame = 0; frame < 200; ++frame)
+  {
+    // Occasionally skip ahead so that systems fall behind.
+    referenceTime += (rng() % 10 == 0) ? 40 : rng() % 3;
+
+    size_t numDue = table.computeDueMask(referenceTime, dueMask);
+
+    size_t expectedDue = 0;
+    for (size_t i = 0; i < numItems; ++i)
+    {
+      bool expected = ref[i].shouldExecute(referenceTime);
+      bool actual = (dueMask[i / 64] >> (i % 64)) & 1;
+      ASSERT_EQ(expected, actual) << "item " << i << " at " << referenceTime;
+      ASSERT_EQ(ref[i].nextExecutionTime, table.nextExecutionTime(i));
+      if (expected) ++expectedDue;
+    }
+    EXPECT_EQ(expectedDue, numDue);
+  }
+}
+
+TEST(ScheduleTable, MatchesScalarReference)
+{
+  // Every kernel this machine can run, whatever the build flags.
+  esys::ScheduleTable::ScanKernel initial = esys::ScheduleTable::scanKernel();
+  const esys::ScheduleTable::ScanKernel kernels[] = {
+    esys::ScheduleTable::SCAN_SCALAR,
+    esys::ScheduleTable::SCAN_SSE42,
+    esys::ScheduleTable::SCAN_AVX2
+  };
+  for (esys::ScheduleTable::ScanKernel kernel : kernels)
+  {
+    if (!esys::ScheduleTable::setScanKernel(kernel))
+      continue;
+    SCOPED_TRACE(kernel);
+    checkAgainstReference();
+  }
+  EXPECT_TRUE(esys::ScheduleTable::setScanKernel(initial));
+  EXPECT_TRUE(esys::ScheduleTable::isScanKernelSupported(esys::ScheduleTable::SCAN_SCALAR));
+}
+
+}
+
@@ -0,0 +1,183 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <glm/glm.hpp>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+// Plain data shared by every shard through the component arena.
+struct SharedCounters
+{
+  uint64_t runs[4];
+  uint64_t ranOn[4];
+};
+
+SharedCounters* counters = nullptr;
+uint32_t currentShard = 0;
+
+template <int N>
+class Part : public es::BaseSystem
+{
+public:
+  void walkComponents(es::ESCoreBase&) override
+  {
+    ++counters->runs[N];
+    counters->ranOn[N] = currentShard + 1;
+  }
+};
+
+// Sorted by name: Alpha, Beta, Delta, Gamma.
+void addParts(esys::SystemCore& systems)
+{
+  systems.registerSystemAs<Part<0> >("Alpha");
+  systems.registerSystemAs<Part<1> >("Beta");
+  systems.registerSystemAs<Part<2> >("Delta");
+  systems.registerSystemAs<Part<3> >("Gamma");
+  systems.addActiveSystem("Alpha", 1);
+  systems.addActiveSystem("Beta", 1);
+  systems.addActiveSystem("Delta", 1);
+  systems.addActiveSystem("Gamma", 1);
+}
+
+int runFollower(const std::string& segment)
+{
+  try
+  {
+    esys::ShardCoordinator follower(segment, 1);
+    counters = static_cast<SharedCounters*>(follower.componentArena());
+    currentShard = follower.shard();
+
+    es::ESCore core;
+    esys::SystemCore systems;
+    addParts(systems);
+    systems.setShardCoordinator(&follower);
+    systems.renormalize();
+
+    int frames = 0;
+    uint64_t referenceTime = 0;
+    while (follower.waitFrame(referenceTime, std::chrono::milliseconds(5000)))
+    {
+      systems.runSystems(core, referenceTime);
+      systems.renormalize();
+      ++frames;
+    }
+    return frames == 10 ? 0 : 2;
+  }
+  catch (...)
+  {
+    return 3;
+  }
+}
+
+TEST(EntitySystem, ShardedProcesses)
+{
+  std::string segment = "/cpm-es-systems-test-" + std::to_string(getpid());
+  EXPECT_THROW(esys::ShardCoordinator(segment, 1), std::runtime_error);
+
+  esys::ShardLayout layout;
+  layout.numShards = 2;
+  layout.maxSystems = 16;
+  layout.arenaBytes = sizeof(SharedCounters);
+  esys::ShardCoordinator leader(segment, layout);
+  ASSERT_GE(leader.componentArenaSize(), sizeof(SharedCounters));
+  counters = static_cast<SharedCounters*>(leader.componentArena());
+  currentShard = leader.shard();
+
+  pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0)
+    _exit(runFollower(segment));
+
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+  addParts(*systems);
+  systems->setSystemShard("Gamma", 0);
+  systems->setShardCoordinator(&leader, std::chrono::milliseconds(5000));
+  systems->renormalize();
+
+  EXPECT_TRUE(systems->isSystemLocal("Alpha"));
+  EXPECT_FALSE(systems->isSystemLocal("Beta"));
+  EXPECT_TRUE(systems->isSystemLocal("Gamma"));
+
+  // Each frame returns once the follower finished its share.
+  for (uint64_t t = 0; t < 10; ++t)
+  {
+    systems->runSystems(*core, t);
+    systems->renormalize();
+    EXPECT_EQ(t + 1, counters->runs[1]);
+  }
+  leader.stop();
+
+  int status = -1;
+  ASSERT_EQ(child, waitpid(child, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+
+  for (int i = 0; i < 4; ++i)
+  {
+    EXPECT_EQ(10u, counters->runs[i]) << i;
+  }
+  EXPECT_EQ(1u, counters->ranOn[0]);
+  EXPECT_EQ(2u, counters->ranOn[1]);
+  EXPECT_EQ(1u, counters->ranOn[2]);
+  EXPECT_EQ(1u, counters->ranOn[3]);
+
+  std::vector<esys::ShardCoordinator::Entry> table;
+  leader.readTable(table);
+  ASSERT_EQ(4u, table.size());
+  EXPECT_STREQ("Beta", table[1].name);
+  EXPECT_EQ(1u, table[1].shard);
+}
+
+TEST(EntitySystem, ShardSegmentOwnership)
+{
+  std::string segment = "/cpm-es-systems-owner-" + std::to_string(getpid());
+  esys::ShardLayout layout;
+
+  // A live leader keeps its segment.
+  {
+    esys::ShardCoordinator leader(segment, layout);
+    EXPECT_THROW(esys::ShardCoordinator(segment, layout), std::runtime_error);
+    esys::ShardCoordinator follower(segment, 1);
+    EXPECT_EQ(2u, follower.numShards());
+  }
+
+  // A leader that died without cleaning up leaves a stale segment, which
+  // the next leader replaces.
+  pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0)
+  {
+    esys::ShardCoordinator* leader = new esys::ShardCoordinator(segment, layout);
+    (void)leader;
+    _exit(0);
+  }
+  int status = -1;
+  ASSERT_EQ(child, waitpid(child, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_THROW(esys::ShardCoordinator(segment, 5), std::runtime_error);
+  EXPECT_NO_THROW(esys::ShardCoordinator(segment, 1));
+
+  layout.numShards = 3;
+  esys::ShardCoordinator leader(segment, layout);
+  EXPECT_EQ(3u, leader.numShards());
+}
+
+}
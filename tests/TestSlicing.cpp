@@ -0,0 +1,112 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <gtest/gtest.h>
+#include <memory>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+// Walks entities whose ID falls in the requested slice.
+class Sliced : public es::GenericSystem<false, CompPosition>,
+               public esys::SliceableSystem
+{
+public:
+  static std::map<uint64_t, int> visits;
+  static std::vector<uint32_t> slices;
+
+  Sliced() : mSlice(0), mNumSlices(1) {}
+
+  void execute(es::ESCoreBase&, uint64_t entityID, const CompPosition*) override
+  {
+    if (entityID % mNumSlices == mSlice)
+      ++visits[entityID];
+  }
+
+  void walkComponentsSlice(es::ESCoreBase& core, uint32_t slice,
+                           uint32_t numSlices) override
+  {
+    slices.push_back(slice);
+    mSlice = slice;
+    mNumSlices = numSlices;
+    walkComponents(core);
+    mSlice = 0;
+    mNumSlices = 1;
+  }
+
+  static const char* getName() {return "Sliced";}
+
+private:
+  uint32_t mSlice;
+  uint32_t mNumSlices;
+};
+std::map<uint64_t, int> Sliced::visits;
+std::vector<uint32_t> Sliced::slices;
+
+TEST(EntitySystem, EntitySlicing)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  systems->registerSystem<Sliced>();
+
+  for (int i = 0; i < 8; ++i)
+  {
+    uint64_t id = core->getNewEntityID();
+    core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  }
+  core->renormalize(true);
+
+  systems->addActiveSystemViaType<Sliced>(8);
+  systems->setSystemSlices(Sliced::getName(), 4);
+  systems->renormalize();
+
+  // Over two full intervals every entity is visited exactly twice, two
+  // entities per sub-tick.
+  for (uint64_t t = 0; t < 16; ++t)
+  {
+    size_t before = 0;
+    for (const auto& v : Sliced::visits) before += v.second;
+
+    systems->runSystems(*core, t);
+
+    size_t after = 0;
+    for (const auto& v : Sliced::visits) after += v.second;
+    EXPECT_EQ((t % 2 == 0) ? 2u : 0u, after - before) << "tick " << t;
+  }
+  ASSERT_EQ(8u, Sliced::visits.size());
+  for (const auto& v : Sliced::visits)
+  {
+    EXPECT_EQ(2, v.second);
+  }
+
+  // The cursor survives serialization.
+  systems->runSystems(*core, 16);
+  Tny* doc = systems->serializeActiveSystems();
+
+  std::shared_ptr<esys::SystemCore> restored(new esys::SystemCore);
+  restored->registerSystem<Sliced>();
+  restored->deserializeActiveSystems(doc->root, 17);
+  restored->renormalize();
+  Tny_free(doc);
+
+  Sliced::slices.clear();
+  restored->runSystems(*core, 18);
+  restored->runSystems(*core, 20);
+  std::vector<uint32_t> expected = {1, 2};
+  EXPECT_EQ(expected, Sliced::slices);
+}
+
+}
+
@@ -0,0 +1,157 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <gtest/gtest.h>
+#include <memory>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+class SysA : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  static const char* getName() {return "SysA";}
+};
+
+class SysB : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  static const char* getName() {return "SysB";}
+};
+
+class SysC : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  static const char* getName() {return "SysC";}
+};
+
+class SysD : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  static const char* getName() {return "SysD";}
+};
+
+void registerAll(esys::SystemCore& systems)
+{
+  systems.registerSystem<SysA>();
+  systems.registerSystem<SysB>();
+  systems.registerSystem<SysC>();
+  systems.registerSystem<SysD>();
+}
+
+esys::SystemSnapshot::RecordMap readRecords(Tny* doc)
+{
+  esys::SystemSnapshot snapshot;
+  snapshot.apply(doc->root);
+  return snapshot.records;
+}
+
+TEST(EntitySystem, DeltaSnapshots)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  esys::SystemCore systems;
+  registerAll(systems);
+
+  systems.addActiveSystemViaType<SysA>(10);
+  systems.addActiveSystemViaType<SysB>(20);
+  systems.addActiveSystemViaType<SysC>(30, 0, 5);
+  systems.renormalize();
+  systems.runSystems(*core, 0);
+
+  Tny* base = systems.serializeActiveSystems();
+
+  // Nothing changed, the delta is empty even though time moved on.
+  systems.runSystems(*core, 12);
+  Tny* empty = systems.serializeActiveSystemsDelta();
+  EXPECT_EQ(nullptr, empty->root->next);
+
+  // Remove B, reschedule C and add D.
+  systems.removeActiveSystemViaType<SysB>();
+  systems.removeActiveSystemViaType<SysC>();
+  systems.renormalize();
+  systems.addActiveSystemViaType<SysC>(40, 0, 7);
+  systems.addActiveSystemViaType<SysD>(50);
+  systems.renormalize();
+
+  Tny* delta = systems.serializeActiveSystemsDelta();
+  esys::SystemSnapshot::RecordMap changes = readRecords(delta);
+  EXPECT_EQ(2u, changes.size());
+  EXPECT_EQ(1u, changes.count(SysC::getName()));
+  EXPECT_EQ(1u, changes.count(SysD::getName()));
+  EXPECT_TRUE(Tny_get(delta->root, SysB::getName()) != NULL);
+  EXPECT_TRUE(Tny_get(delta->root, SysA::getName()) == NULL);
+
+  // Compaction matches a full snapshot taken now.
+  std::vector<Tny*> deltas = {empty->root, delta->root};
+  Tny* compacted = esys::SystemSnapshot::compact(base->root, deltas);
+  Tny* full = systems.serializeActiveSystems();
+  esys::SystemSnapshot::RecordMap expected = readRecords(full);
+  esys::SystemSnapshot::RecordMap actual = readRecords(compacted);
+  ASSERT_EQ(expected.size(), actual.size());
+  for (const auto& entry : expected)
+  {
+    ASSERT_EQ(1u, actual.count(entry.first));
+    EXPECT_TRUE(entry.second.sameSchedule(actual[entry.first])) << entry.first;
+  }
+
+  // Restoring base plus deltas yields the same active set.
+  esys::SystemCore restored;
+  registerAll(restored);
+  restored.restoreActiveSystems(base->root, deltas, 60);
+  restored.renormalize();
+  EXPECT_TRUE(restored.isSystemActive(SysA::getName()));
+  EXPECT_FALSE(restored.isSystemActive(SysB::getName()));
+  EXPECT_TRUE(restored.isSystemActive(SysC::getName()));
+  EXPECT_TRUE(restored.isSystemActive(SysD::getName()));
+
+  Tny* again = restored.serializeActiveSystems();
+  esys::SystemSnapshot::RecordMap restoredRecords = readRecords(again);
+  EXPECT_EQ(40u, restoredRecords[SysC::getName()].interval);
+  EXPECT_EQ(7u, restoredRecords[SysC::getName()].stagger);
+
+  Tny_free(base);
+  Tny_free(empty);
+  Tny_free(delta);
+  Tny_free(compacted);
+  Tny_free(full);
+  Tny_free(again);
+}
+
+TEST(EntitySystem, SnapshotTickValidation)
+{
+  // Tick lengths that are zero or not a supported resolution are rejected
+  // before they are used to convert intervals.
+  const uint64_t invalid[] = {0, 7, 1000000000};
+  for (uint64_t tickNS : invalid)
+  {
+    esys::SystemSnapshot snapshot;
+    esys::SystemSnapshotRecord record;
+    record.interval = 10;
+    record.tickNS = tickNS;
+    snapshot.records[SysA::getName()] = record;
+    Tny* doc = snapshot.write();
+
+    esys::SystemCore systems;
+    registerAll(systems);
+    EXPECT_THROW(systems.deserializeActiveSystems(doc->root, 0), std::runtime_error) << tickNS;
+    Tny_free(doc);
+  }
+}
+
+}
+
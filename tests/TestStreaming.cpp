@@ -0,0 +1,174 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <memory>
+#include <unistd.h>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+class StreamA : public es::GenericSystem<false, CompPosition>
+{
+public:
+  static int32_t numExecutions;
+
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {++numExecutions;}
+  static const char* getName() {return "StreamA";}
+};
+int32_t StreamA::numExecutions = 0;
+
+class StreamB : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  static const char* getName() {return "StreamB";}
+};
+
+class StreamC : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  static const char* getName() {return "StreamC";}
+};
+
+void registerAll(esys::SystemCore& systems)
+{
+  systems.registerSystem<StreamA>();
+  systems.registerSystem<StreamB>();
+  systems.registerSystem<StreamC>();
+}
+
+TEST(EntitySystem, DeserializeStagger)
+{
+  esys::SystemCore systems;
+  registerAll(systems);
+  systems.addActiveSystemViaType<StreamA>(10, 0, 3);
+  systems.renormalize();
+
+  Tny* doc = systems.serializeActiveSystems();
+  esys::SystemCore restored;
+  registerAll(restored);
+  restored.deserializeActiveSystems(doc->root, 0);
+  restored.renormalize();
+  Tny_free(doc);
+
+  doc = restored.serializeActiveSystems();
+  esys::SystemSnapshot snapshot;
+  snapshot.apply(doc->root);
+  Tny_free(doc);
+  EXPECT_EQ(10u, snapshot.records[StreamA::getName()].interval);
+  EXPECT_EQ(3u, snapshot.records[StreamA::getName()].stagger);
+}
+
+TEST(EntitySystem, StreamingLoad)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->renormalize(true);
+
+  esys::SystemCore systems;
+  registerAll(systems);
+  systems.addActiveSystemViaType<StreamA>(10, 0, 3);
+  systems.addActiveSystemViaType<StreamB>(20);
+  systems.addActiveSystemViaType<StreamC>(30);
+  systems.renormalize();
+
+  // Through a file descriptor.
+  FILE* file = std::tmpfile();
+  ASSERT_TRUE(file != nullptr);
+  {
+    esys::SystemRecordWriter writer(fileno(file));
+    systems.writeActiveSystems(writer);
+  }
+  ASSERT_EQ(0, lseek(fileno(file), 0, SEEK_SET));
+
+  esys::SystemCore restored;
+  registerAll(restored);
+  restored.addActiveSystemViaType<StreamB>(20);
+  restored.renormalize();
+  {
+    esys::SystemRecordReader reader(fileno(file));
+    restored.loadActiveSystems(reader, 0, 2);
+  }
+  std::fclose(file);
+
+  // Loaded systems are active immediately.
+  EXPECT_TRUE(restored.isSystemActive(StreamA::getName()));
+  EXPECT_TRUE(restored.isSystemActive(StreamB::getName()));
+  EXPECT_TRUE(restored.isSystemActive(StreamC::getName()));
+
+  // The stagger survived the trip: StreamA runs at 7, 17, 27.
+  for (uint64_t t = 0; t < 30; ++t)
+    restored.runSystems(*core, t);
+  EXPECT_EQ(3, StreamA::numExecutions);
+
+  // Through memory, and rejecting truncated data.
+  std::vector<uint8_t> buffer;
+  {
+    esys::SystemRecordWriter writer(buffer);
+    systems.writeActiveSystems(writer);
+  }
+  esys::SystemRecordReader reader(buffer.data(), buffer.size());
+  std::string name;
+  esys::SystemSnapshotRecord record;
+  std::vector<std::string> names;
+  while (reader.next(name, record))
+    names.push_back(name);
+  std::vector<std::string> expected = {"StreamA", "StreamB", "StreamC"};
+  EXPECT_EQ(expected, names);
+
+  esys::SystemRecordReader truncated(buffer.data(), buffer.size() - 1);
+  esys::SystemCore broken;
+  registerAll(broken);
+  EXPECT_THROW(broken.loadActiveSystems(truncated, 0, 1), std::runtime_error);
+  EXPECT_TRUE(broken.isSystemActive(StreamA::getName()));
+  EXPECT_TRUE(broken.isSystemActive(StreamB::getName()));
+
+  // Records written by hand need not be sorted.
+  std::vector<uint8_t> unsortedBuffer;
+  {
+    esys::SystemRecordWriter writer(unsortedBuffer);
+    esys::SystemSnapshotRecord every;
+    every.interval = 10;
+    writer.write("StreamC", every);
+    writer.write("StreamA", every);
+  }
+  esys::SystemCore unsorted;
+  registerAll(unsorted);
+  unsorted.addActiveSystemViaType<StreamB>(20);
+  unsorted.renormalize();
+  esys::SystemRecordReader unsortedReader(unsortedBuffer.data(), unsortedBuffer.size());
+  unsorted.loadActiveSystems(unsortedReader, 0, 4);
+  EXPECT_TRUE(unsorted.isSystemActive(StreamA::getName()));
+  EXPECT_TRUE(unsorted.isSystemActive(StreamB::getName()));
+  EXPECT_TRUE(unsorted.isSystemActive(StreamC::getName()));
+
+  // A tick length of 0 would divide by zero on restore.
+  esys::SystemSnapshotRecord zeroTick;
+  zeroTick.interval = 10;
+  zeroTick.tickNS = 0;
+  std::vector<uint8_t> zeroBuffer;
+  {
+    esys::SystemRecordWriter writer(zeroBuffer);
+    writer.write("StreamA", zeroTick);
+  }
+  esys::SystemRecordReader zeroReader(zeroBuffer.data(), zeroBuffer.size());
+  EXPECT_THROW(zeroReader.next(name, record), std::runtime_error);
+}
+
+}
+
@@ -0,0 +1,94 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <gtest/gtest.h>
+#include <limits>
+#include <memory>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+class Control : public es::GenericSystem<false, CompPosition>
+{
+public:
+  static int32_t numExecutions;
+
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {++numExecutions;}
+  static const char* getName() {return "Control";}
+};
+int32_t Control::numExecutions = 0;
+
+class Logic : public es::GenericSystem<false, CompPosition>
+{
+public:
+  static int32_t numExecutions;
+
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {++numExecutions;}
+  static const char* getName() {return "Logic";}
+};
+int32_t Logic::numExecutions = 0;
+
+TEST(EntitySystem, MicrosecondTimeBase)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  systems->registerSystem<Control>();
+  systems->registerSystem<Logic>();
+  systems->setTickResolution(esys::SystemCore::TICK_MICROSECONDS);
+  EXPECT_EQ(std::chrono::nanoseconds(1000), systems->getTickDuration());
+
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->renormalize(true);
+
+  // A 4 kHz control loop next to a 100 Hz system using the ms overload.
+  systems->addActiveSystemViaType<Control>(std::chrono::microseconds(250),
+                                           std::chrono::microseconds(0),
+                                           std::chrono::microseconds(100));
+  systems->addActiveSystemViaType<Logic>(10);
+  systems->renormalize();
+
+  // Step through 20ms in 50us increments.
+  for (int64_t us = 0; us < 20000; us += 50)
+  {
+    systems->runSystems(*core, std::chrono::microseconds(us));
+  }
+
+  EXPECT_EQ(80, Control::numExecutions);
+  EXPECT_EQ(2, Logic::numExecutions);
+
+  // The resolution cannot change under active systems.
+  EXPECT_THROW(systems->setTickResolution(esys::SystemCore::TICK_NANOSECONDS),
+               std::runtime_error);
+}
+
+TEST(EntitySystem, NextExecutionTimeOverflow)
+{
+  const uint64_t maxTime = std::numeric_limits<uint64_t>::max();
+  const uint64_t interval = 1000000000;
+
+  // referenceTime + stagger would wrap, the result must still be exact.
+  uint64_t ref = maxTime - 5 * interval;
+  uint64_t next = esys::ScheduleTable::calcNextExecutionTime(ref, interval, interval - 1);
+  EXPECT_GE(next, ref);
+  EXPECT_LT(next - ref, interval);
+  EXPECT_EQ(0u, (next % interval + (interval - 1)) % interval);
+
+  // A stagger point past the end of time saturates instead of wrapping.
+  EXPECT_EQ(maxTime, esys::ScheduleTable::calcNextExecutionTime(maxTime - 1, interval, 0));
+}
+
+}
+
@@ -0,0 +1,159 @@
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+class Fast : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  static const char* getName() {return "Fast";}
+};
+
+class Steady : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  static const char* getName() {return "Steady";}
+};
+
+class EveryFrame : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override {}
+  static const char* getName() {return "EveryFrame";}
+};
+
+class Slow : public es::GenericSystem<false, CompPosition>
+{
+public:
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  static const char* getName() {return "Slow";}
+};
+
+TEST(EntitySystem, LatenessHistogram)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  systems->registerSystem<Fast>();
+  systems->registerSystem<Steady>();
+
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->renormalize(true);
+
+  systems->addActiveSystemViaType<Fast>(2);
+  systems->addActiveSystemViaType<Steady>(4);
+  systems->renormalize();
+  systems->setTimingStatistics(true);
+
+  // Both systems are on time at 0. At 7, Steady is 3 late (scheduled for 4)
+  // and Fast fell more than an interval behind (scheduled for 2).
+  systems->runSystems(*core, 0);
+  systems->runSystems(*core, 7);
+
+  esys::SystemTimingStats stats;
+  ASSERT_TRUE(systems->getTimingStatistics("Steady", stats));
+  EXPECT_EQ(2u, stats.executions);
+  EXPECT_EQ(3u, stats.maxLateness);
+  EXPECT_EQ(1u, stats.latenessHistogram[0]);
+  EXPECT_EQ(1u, stats.latenessHistogram[esys::SystemTimingStats::bucket(3)]);
+
+  ASSERT_TRUE(systems->getTimingStatistics("Fast", stats));
+  EXPECT_EQ(2u, stats.executions);
+  EXPECT_EQ(5u, stats.maxLateness);
+  EXPECT_EQ(1u, stats.latenessHistogram[esys::SystemTimingStats::bucket(5)]);
+
+  EXPECT_FALSE(systems->getTimingStatistics("Unknown", stats));
+}
+
+TEST(EntitySystem, LatenessWithoutInterval)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  systems->registerSystem<EveryFrame>();
+
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->renormalize(true);
+
+  systems->addActiveSystemViaType<EveryFrame>(0);
+  systems->renormalize();
+  systems->setTimingStatistics(true);
+
+  // A system without an interval is due whenever it runs, skipped ticks
+  // included, so it is never late.
+  uint64_t t = 0;
+  for (int frame = 0; frame < 1000; ++frame)
+  {
+    systems->runSystems(*core, t);
+    t += (frame % 10 == 0) ? 3 : 1;
+  }
+
+  esys::SystemTimingStats stats;
+  ASSERT_TRUE(systems->getTimingStatistics("EveryFrame", stats));
+  EXPECT_EQ(1000u, stats.executions);
+  EXPECT_EQ(0u, stats.maxLateness);
+  EXPECT_EQ(1000u, stats.latenessHistogram[0]);
+}
+
+TEST(EntitySystem, OverrunWatchdog)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  systems->registerSystem<Fast>();
+  systems->registerSystem<Slow>();
+
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->renormalize(true);
+
+  systems->addActiveSystemViaType<Fast>();
+  systems->addActiveSystemViaType<Slow>();
+  systems->renormalize();
+
+  std::mutex mutex;
+  std::vector<std::string> overruns;
+  systems->setWatchdog(std::chrono::milliseconds(10),
+                       [&](const char* name, std::chrono::microseconds elapsed)
+                       {
+                         EXPECT_GT(elapsed, std::chrono::microseconds(10000));
+                         std::lock_guard<std::mutex> lock(mutex);
+                         overruns.push_back(name);
+                       });
+
+  systems->runSystems(*core, 0);
+  systems->clearWatchdog();
+
+  // Slow is flagged exactly once for its single execution.
+  ASSERT_EQ(1u, overruns.size());
+  EXPECT_EQ(std::string("Slow"), overruns[0]);
+}
+
+}
+
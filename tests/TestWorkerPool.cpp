@@ -0,0 +1,185 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <entity-system/GenericSystem.hpp>
+#include <entity-system/ESCore.hpp>
+#include <es-systems/SystemCore.hpp>
+#include <gtest/gtest.h>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <glm/glm.hpp>
+
+namespace es = CPM_ES_NS;
+namespace esys = CPM_ES_SYSTEMS_NS;
+
+namespace {
+
+struct CompPosition
+{
+  CompPosition() {}
+  CompPosition(const glm::vec3& pos) {position = pos;}
+
+  glm::vec3 position;
+};
+
+std::mutex gPinMutex;
+std::map<std::thread::id, std::vector<int>> gPinned;
+
+// Records the CPUs each worker asks for instead of pinning it.
+bool fakePin(const std::vector<int>& cpus)
+{
+  std::lock_guard<std::mutex> lock(gPinMutex);
+  gPinned[std::this_thread::get_id()] = cpus;
+  return true;
+}
+
+// Stores the id of the thread it runs on in *context.
+void recordThread(void* context)
+{
+  *static_cast<std::thread::id*>(context) = std::this_thread::get_id();
+}
+
+void writeNode(const std::string& dir, const char* node, const char* cpulist)
+{
+  std::string path = dir + "/" + node;
+  mkdir(path.c_str(), 0700);
+  FILE* file = std::fopen((path + "/cpulist").c_str(), "w");
+  std::fputs(cpulist, file);
+  std::fclose(file);
+}
+
+// Remembers the thread it was constructed and executed on.
+class Physics : public es::GenericSystem<false, CompPosition>
+{
+public:
+  static std::thread::id constructedOn;
+  static std::thread::id executedOn;
+
+  Physics() {constructedOn = std::this_thread::get_id();}
+
+  void execute(es::ESCoreBase&, uint64_t, const CompPosition*) override
+  {
+    executedOn = std::this_thread::get_id();
+  }
+  static const char* getName() {return "Physics";}
+};
+std::thread::id Physics::constructedOn;
+std::thread::id Physics::executedOn;
+
+TEST(EntitySystem, CpuListParsing)
+{
+  std::vector<int> expected = {0, 1, 2, 3, 8, 9, 10, 11};
+  EXPECT_EQ(expected, esys::CpuTopology::parseCpuList("0-3,8-11\n"));
+  EXPECT_TRUE(esys::CpuTopology::parseCpuList("").empty());
+  EXPECT_FALSE(esys::CpuTopology::detect().nodes.empty());
+}
+
+TEST(EntitySystem, NodeAffinity)
+{
+  std::shared_ptr<es::ESCore> core(new es::ESCore());
+  std::shared_ptr<esys::SystemCore> systems(new esys::SystemCore);
+
+  systems->registerSystem<Physics>();
+
+  uint64_t id = core->getNewEntityID();
+  core->addComponent(id, CompPosition(glm::vec3(1.0, 2.0, 3.0)));
+  core->renormalize(true);
+
+  // Two fake nodes with two workers each, pinned per core.
+  esys::WorkerPoolConfig config;
+  config.topology.nodes = {{0, 1}, {2, 3}};
+  config.workersPerNode = 2;
+  config.pinning = esys::PIN_CORE;
+  config.pin = &fakePin;
+  systems->setWorkerPool(config);
+  systems->setPipelinedExecution(true);
+
+  {
+    std::lock_guard<std::mutex> lock(gPinMutex);
+    ASSERT_EQ(4u, gPinned.size());
+    std::set<int> cpus;
+    for (const auto& p : gPinned)
+    {
+      ASSERT_EQ(1u, p.second.size());
+      cpus.insert(p.second[0]);
+    }
+    EXPECT_EQ(4u, cpus.size());
+  }
+
+  systems->setSystemNode(Physics::getName(), 1);
+  systems->addActiveSystemViaType<Physics>(0);
+  systems->renormalize();
+
+  // Constructed on a node 1 worker so its allocations land there.
+  {
+    std::lock_guard<std::mutex> lock(gPinMutex);
+    auto it = gPinned.find(Physics::constructedOn);
+    ASSERT_TRUE(it != gPinned.end());
+    EXPECT_GE(it->second[0], 2);
+  }
+
+  int worker = systems->getSystemWorker(Physics::getName());
+  ASSERT_GE(worker, 0);
+  EXPECT_GE(worker, 2);
+
+  systems->runSystems(*core, 0);
+  systems->renormalize();
+  {
+    std::lock_guard<std::mutex> lock(gPinMutex);
+    auto it = gPinned.find(Physics::executedOn);
+    ASSERT_TRUE(it != gPinned.end());
+    EXPECT_GE(it->second[0], 2);
+  }
+
+  systems->setPipelinedExecution(false);
+  EXPECT_EQ(-1, systems->getSystemWorker(Physics::getName()));
+}
+
+TEST(EntitySystem, SparseNodeTopology)
+{
+  // Node 1 has memory but no CPUs and node 2 does not exist.
+  char dir[] = "/tmp/cpm-es-nodesXXXXXX";
+  ASSERT_TRUE(mkdtemp(dir) != nullptr);
+  writeNode(dir, "node0", "0-1\n");
+  writeNode(dir, "node1", "\n");
+  writeNode(dir, "node3", "4-5\n");
+  writeNode(dir, "nodefoo", "6\n");
+
+  esys::CpuTopology topology = esys::CpuTopology::detect(dir);
+  std::vector<std::vector<int> > expected = {{0, 1}, {}, {}, {4, 5}};
+  EXPECT_EQ(expected, topology.nodes);
+
+  std::system((std::string("rm -rf ") + dir).c_str());
+
+  esys::WorkerPoolConfig config;
+  config.topology = topology;
+  config.workersPerNode = 2;
+  config.pinning = esys::PIN_CORE;
+  config.pin = &fakePin;
+  esys::WorkerPool pool(config);
+
+  // Workers only for the nodes with CPUs.
+  ASSERT_EQ(4u, pool.size());
+  EXPECT_EQ(4u, pool.numNodes());
+  for (size_t n = 0; n < 4; ++n)
+  {
+    size_t worker = pool.worker(3, n);
+    EXPECT_EQ(3u, pool.node(worker));
+
+    std::thread::id thread;
+    pool.run(worker, &recordThread, &thread);
+    std::lock_guard<std::mutex> lock(gPinMutex);
+    auto it = gPinned.find(thread);
+    ASSERT_TRUE(it != gPinned.end());
+    ASSERT_EQ(1u, it->second.size());
+    EXPECT_GE(it->second[0], 4);
+  }
+  EXPECT_EQ(0u, pool.node(pool.worker(0, 1)));
+  EXPECT_LT(pool.worker(1, 5), pool.size());
+}
+
+}